@@ -1,4 +1,9 @@
 TEMPLATE = subdirs
 SUBDIRS = src/ui \
     src/ui-tests
+
+# The benchmarks build the whole UI a second time: only on request, with
+# qmake CONFIG+=benchmarks
+benchmarks: SUBDIRS += src/ui-benchmarks
+
 QMAKE_DISTCLEAN += Makefile && rm -rf out
@@ -2,8 +2,211 @@ var editor;
 var changeGeneration;
 var forceDirty = false;
 
+/*
+    CodeMirror and the addons below are already loaded by index.html. Register
+    them within require.js, so that the language modes (which we load on demand,
+    see loadMode()) reuse them instead of fetching a second copy.
+*/
+define("libs/codemirror/lib/codemirror", [], function() { return CodeMirror; });
+define("libs/codemirror/addon/mode/overlay", ["libs/codemirror/lib/codemirror"], function() {});
+
+/*
+    Returns the urls of the mode files (and mode addons) loaded so far, in the
+    order they have been evaluated, so that dependencies come first.
+*/
+function loadedModeScripts() {
+    var defined = requirejs.s.contexts._.defined;
+    return Object.keys(defined).filter(function(id) {
+        return /^libs\/codemirror\/(mode|addon\/mode)\//.test(id);
+    }).map(function(id) {
+        return new URL(id + ".js", document.baseURI).href;
+    });
+}
+
+/*
+    Sets the mode of the current document. Big documents are highlighted
+    in a Web Worker (see BackgroundHighlighter), the others as usual.
+*/
+function applyMode(spec) {
+    editor.getDoc().nqqModeSpec = spec;
+
+    if (editor.lineCount() >= BackgroundHighlighter.MIN_LINES &&
+            BackgroundHighlighter.enable(editor, spec, loadedModeScripts()))
+        return;
+
+    BackgroundHighlighter.disable(editor);
+    editor.setOption('mode', spec);
+}
+
+/*
+    To be called after the content has been replaced: the document
+    might have become big enough (or small enough) for a different
+    kind of highlighting.
+*/
+function refreshMode() {
+    var spec = editor.getDoc().nqqModeSpec;
+    if (spec !== undefined)
+        applyMode(spec);
+}
+
+/* Incremented at every C_CMD_SET_LANGUAGE (separately for each document),
+   so that a mode that finishes loading late doesn't override the language
+   that has been set after it. */
+var languageRequestIds = {};
+
+/*
+    When the page is shared by several C++ Editors (see EditorHost), each of
+    them owns one of these documents. UiDriver swaps the right one into the
+    editor before handling a message that refers to it.
+*/
+var documents = {};
+var activeDocId = undefined;
+var visibleDocId = undefined;
+var visibleDocRestoreScheduled = false;
+
+/*
+    Options of the addons that scan the document, or part of it, at every
+    change or cursor movement. NORMAL_PROFILE is what every editor starts
+    with; LARGE_DOCUMENT_PROFILE is used for documents that are too big
+    for them (see C_CMD_SET_LARGE_DOCUMENT_MODE).
+*/
+var NORMAL_PROFILE = {
+    highlightSelectionMatches: {style: "selectedHighlight", wordsOnly: true, delay: 25},
+    styleSelectedText: true,
+    styleActiveLine: true,
+    foldGutter: true,
+    gutters: ["CodeMirror-linenumbers", "CodeMirror-foldgutter"],
+    matchBrackets: true,
+    maxHighlightLength: 10000,
+    workTime: 100,
+    workDelay: 100,
+    viewportMargin: 10
+};
+
+var LARGE_DOCUMENT_PROFILE = {
+    highlightSelectionMatches: false,
+    styleSelectedText: false,
+    styleActiveLine: false,
+    foldGutter: false,
+    gutters: ["CodeMirror-linenumbers"],
+    matchBrackets: false,
+    // Don't tokenize very long lines, and highlight in shorter slices
+    // so that typing doesn't have to wait for the highlighter.
+    maxHighlightLength: 1000,
+    workTime: 30,
+    workDelay: 300,
+    viewportMargin: 0
+};
+
+function applyProfile(profile) {
+    editor.operation(function() {
+        for (var name in profile) {
+            editor.setOption(name, profile[name]);
+        }
+    });
+}
+
+// Editor options that belong to a single document
+var DOCUMENT_OPTIONS = ["indentWithTabs", "indentUnit", "tabSize"].concat(Object.keys(NORMAL_PROFILE));
+
+function activateDocument(docId) {
+    if (docId === activeDocId)
+        return;
+
+    var previous = documents[activeDocId];
+    if (previous !== undefined) {
+        previous.forceDirty = forceDirty;
+        previous.changeGeneration = changeGeneration;
+        DOCUMENT_OPTIONS.forEach(function(name) {
+            previous.options[name] = editor.getOption(name);
+        });
+    }
+
+    var state = documents[docId];
+    if (state === undefined) {
+        var doc = CodeMirror.Doc("", "text/plain");
+        state = documents[docId] = {
+            doc: doc,
+            forceDirty: false,
+            changeGeneration: doc.changeGeneration(true),
+            options: $.extend({ indentWithTabs: true, indentUnit: 4, tabSize: 4 }, NORMAL_PROFILE)
+        };
+    }
+
+    editor.swapDoc(state.doc);
+    DOCUMENT_OPTIONS.forEach(function(name) {
+        editor.setOption(name, state.options[name]);
+    });
+    forceDirty = state.forceDirty;
+    changeGeneration = state.changeGeneration;
+    activeDocId = docId;
+
+    // Messages can refer to documents in background tabs: swap the
+    // visible document back in before the page gets repainted.
+    if (docId !== visibleDocId && !visibleDocRestoreScheduled) {
+        visibleDocRestoreScheduled = true;
+        Promise.resolve().then(function() {
+            visibleDocRestoreScheduled = false;
+            if (visibleDocId !== undefined)
+                UiDriver.activateDocument(visibleDocId);
+        });
+    }
+}
+
+/*
+    Loads the CodeMirror mode with the given name, together with the modes
+    it depends on. require.js takes care of loading every file only once.
+    The returned Promise is always resolved: if the mode can't be loaded,
+    CodeMirror will simply fall back to plain text.
+*/
+function loadMode(name) {
+    return new Promise(function(resolve) {
+        if (!name || name === "null" || CodeMirror.modes.hasOwnProperty(name)) {
+            resolve();
+            return;
+        }
+
+        require(["libs/codemirror/mode/" + name + "/" + name], function() {
+            resolve();
+        }, function(err) {
+            console.error("Unable to load mode " + name + ": " + err);
+            resolve();
+        });
+    });
+}
+
 UiDriver.registerEventHandler("C_CMD_SET_VALUE", function(msg, data, prevReturn) {
     editor.setValue(data);
+    refreshMode();
+});
+
+/*
+    Large documents are not sent through the web channel. Instead, data contains
+    an url (served by BulkTransferSchemeHandler) from which we fetch the raw text.
+    Resolves to true if the content has been set, false if C++ has to fall back
+    to C_CMD_SET_VALUE.
+*/
+UiDriver.registerEventHandler("C_CMD_SET_VALUE_BULK", function(msg, data, prevReturn) {
+    var docId = UiDriver.currentDocumentId();
+    return new Promise(function(resolve) {
+        var xhr = new XMLHttpRequest();
+        xhr.open("GET", data, true);
+        xhr.responseType = "text";
+        xhr.onload = function() {
+            if (xhr.status !== 0 && xhr.status !== 200) {
+                resolve(false);
+                return;
+            }
+            UiDriver.activateDocument(docId);
+            editor.setValue(xhr.responseText);
+            refreshMode();
+            resolve(true);
+        };
+        xhr.onerror = function() {
+            resolve(false);
+        };
+        xhr.send();
+    });
 });
 
 UiDriver.registerEventHandler("C_FUN_GET_VALUE", function(msg, data, prevReturn) {
@@ -38,12 +241,27 @@ UiDriver.registerEventHandler("C_FUN_GET_HISTORY_GENERATION", function(msg, data
     return editor.getHistoryGeneration();
 });
 
+/*
+   data: {
+        mode: name of the CodeMirror mode, used to load it
+        mime: mime type (or mode name) to pass to CodeMirror
+   }
+*/
 UiDriver.registerEventHandler("C_CMD_SET_LANGUAGE", function(msg, data, prevReturn) {
-    editor.setOption('mode', data);
+    var docId = UiDriver.currentDocumentId();
+    var requestId = languageRequestIds[docId] = (languageRequestIds[docId] || 0) + 1;
 
-    // If math rendering is enable, refresh the rendering
-    require(['features/latex/latex'], function(math) {
-        math.refresh(editor);
+    return loadMode(data.mode).then(function() {
+        if (requestId !== languageRequestIds[docId])
+            return;
+
+        UiDriver.activateDocument(docId);
+        applyMode(data.mime);
+
+        // If math rendering is enable, refresh the rendering
+        require(['features/latex/latex'], function(math) {
+            math.refresh(editor);
+        });
     });
 });
 
@@ -173,6 +391,49 @@ UiDriver.registerEventHandler("C_CMD_CLEAR_HISTORY", function(msg, data, prevRet
     editor.clearHistory();
 });
 
+/*
+    Brings the editor back to the state of a freshly loaded page, so that it
+    can be reused for another document (see EditorPool). Swapping the document
+    drops content, history and marks without firing any change event.
+*/
+UiDriver.registerEventHandler("C_CMD_RESET", function(msg, data, prevReturn) {
+    BackgroundHighlighter.disable(editor);
+    editor.swapDoc(CodeMirror.Doc("", editor.getDoc().nqqModeSpec));
+    applyProfile(NORMAL_PROFILE);
+    editor.toggleOverwrite(false);
+    forceDirty = false;
+    changeGeneration = editor.changeGeneration(true);
+});
+
+/*
+    The Editor that owns the current document is now displaying the shared page.
+*/
+UiDriver.registerEventHandler("C_CMD_SHOW_DOC", function(msg, data, prevReturn) {
+    visibleDocId = UiDriver.currentDocumentId();
+    editor.refresh();
+});
+
+/*
+    The Editor that owns the current document has been destroyed.
+*/
+UiDriver.registerEventHandler("C_CMD_CLOSE_DOC", function(msg, data, prevReturn) {
+    var docId = UiDriver.currentDocumentId();
+    BackgroundHighlighter.disable(editor);
+    delete documents[docId];
+    delete languageRequestIds[docId];
+    activeDocId = undefined;
+    if (visibleDocId === docId)
+        visibleDocId = undefined;
+});
+
+/*
+    Turns off (or back on) the addons that don't scale to big documents.
+    data: true to use the large document profile
+*/
+UiDriver.registerEventHandler("C_CMD_SET_LARGE_DOCUMENT_MODE", function(msg, data, prevReturn) {
+    applyProfile(data ? LARGE_DOCUMENT_PROFILE : NORMAL_PROFILE);
+});
+
 UiDriver.registerEventHandler("C_CMD_SET_LINE_WRAP", function(msg, data, prevReturn) {
     editor.setOption("lineWrapping", data == true);
 });
@@ -325,48 +586,267 @@ UiDriver.registerEventHandler("C_FUN_REPLACE", function(msg, data, prevReturn) {
     return Search(regexStr, regexModifiers, forward);
 });
 
+/*
+   Parses a replacement string once, instead of once per match.
+   Returns a function that builds the replacement of a match.
+   (Same rules as applyReusedGroups.)
+*/
+function compileReplacement(replacement, useGroups) {
+    if (!useGroups) {
+        return function(groups) { return replacement; };
+    }
+
+    // Odd items are the numbers of the groups to reuse
+    var parts = replacement.split(/\\([1-9])/);
+    return function(groups) {
+        var out = parts[0];
+        for (var i = 1; i < parts.length; i += 2) {
+            var group = groups[Number(parts[i])];
+            out += (group === undefined ? "" : group) + parts[i + 1];
+        }
+        return out;
+    };
+}
+
+// Time (in milliseconds) spent replacing before reporting the progress
+var REPLACE_ALL_SLICE = 100;
+
+/*
+   Replaces every match in a single pass over the text of the document,
+   then applies the result as a single change (and a single undo step).
+   Sends J_EVT_REPLACE_ALL_PROGRESS (a number between 0 and 1) while running.
+
+   data[0]: contains the regex string
+   data[1]: contains the regex modifiers (e.g. "ig")
+   data[2]: string to use as replacement
+   data[3]: the SearchMode
+*/
 UiDriver.registerEventHandler("C_FUN_REPLACE_ALL", function(msg, data, prevReturn) {
-    var regexStr = data[0];
-    var regexModifiers = data[1];
+    var docId = UiDriver.currentDocumentId();
+    var regex = new RegExp(data[0], data[1].replace(/g/g, "") + "g");
     var replacement = data[2];
     var searchMode = Number(data[3]);
-    var searchCursor = editor.getSearchCursor(new RegExp(regexStr, regexModifiers), undefined, false);
+    var replace = compileReplacement(replacement,
+                                     searchMode == SearchMode.Regex && hasGroupReuseTokens(replacement));
+
+    return new Promise(function(resolve) {
+        var version, text, pieces, first, last, count;
+
+        function start() {
+            version = editor.getDoc().nqqVersion || 0;
+            text = editor.getValue("\n");
+            pieces = [];
+            first = -1; // Start of the first match
+            last = 0;   // End of the last match
+            count = 0;
+            regex.lastIndex = 0;
+            step();
+        }
 
-    var count = 0;
-    var id = Math.round(Math.random() * 1000000) + "/" + Date.now();
-    
-    var hasReuseTokens = hasGroupReuseTokens(replacement) && searchMode == SearchMode.Regex;
+        function step() {
+            var deadline = Date.now() + REPLACE_ALL_SLICE;
+            var match;
 
-    while (groups = searchCursor.findNext()) {
-        count++;
-        // Replace
-        if (hasReuseTokens){
-            searchCursor.replace(applyReusedGroups(replacement, groups), "*C_FUN_REPLACE_ALL" + id);
-        } else {
-            searchCursor.replace(replacement, "*C_FUN_REPLACE_ALL" + id);
-        }        
+            while ((match = regex.exec(text)) !== null) {
+                if (first === -1) {
+                    first = match.index;
+                } else {
+                    pieces.push(text.substring(last, match.index));
+                }
+                pieces.push(replace(match));
+                last = match.index + match[0].length;
+                count++;
+
+                if (match[0].length === 0) {
+                    regex.lastIndex++;
+                }
+
+                if ((count & 1023) === 0 && Date.now() > deadline) {
+                    UiDriver.sendMessage("J_EVT_REPLACE_ALL_PROGRESS", regex.lastIndex / text.length, docId);
+                    setTimeout(step, 0);
+                    return;
+                }
+            }
+
+            finish();
+        }
+
+        function finish() {
+            UiDriver.activateDocument(docId);
+            var doc = editor.getDoc();
+
+            if ((doc.nqqVersion || 0) !== version) {
+                // The document has been edited in the meantime
+                start();
+                return;
+            }
+
+            if (count > 0) {
+                // Only the text between the first and the last match changes
+                doc.replaceRange(pieces.join(""), doc.posFromIndex(first), doc.posFromIndex(last), "replaceAll");
+            }
+
+            resolve(count);
+        }
+
+        start();
+    });
+});
+
+/* Sets the selections. data is a flat array made of
+   [anchorLine, anchorCh, headLine, headCh] groups, one for each selection.
+*/
+UiDriver.registerEventHandler("C_CMD_SET_SELECTIONS", function(msg, data, prevReturn) {
+    var selections = [];
+    for (var i = 0; i + 3 < data.length; i += 4) {
+        selections.push({
+            anchor: {line: data[i], ch: data[i + 1]},
+            head: {line: data[i + 2], ch: data[i + 3]}
+        });
     }
 
-    return count;
+    if (selections.length > 0)
+        editor.setSelections(selections);
 });
 
-UiDriver.registerEventHandler("C_FUN_SEARCH_SELECT_ALL", function(msg, data, prevReturn) {
-    var regexStr = data[0];
-    var regexModifiers = data[1];
-    var searchCursor = editor.getSearchCursor(new RegExp(regexStr, regexModifiers), undefined, false);
+/* Change tracking for the match index kept by DocumentSearch on the C++ side.
+   While a document is tracked, every change is sent as J_EVT_SEARCH_CHANGE
+   {seq, from: [line, ch], to: [line, ch], text}, with the positions taken
+   before the change is applied. Inserting more than SEARCH_RESYNC_THRESHOLD
+   characters sends {seq, resync: true} instead, and C++ asks for a new snapshot.
+   The viewport (J_EVT_SEARCH_VIEWPORT) and the primary selection
+   (J_EVT_SEARCH_SELECTION) are sent as they change, so that C++ never has to
+   ask for them.
+*/
+var SEARCH_RESYNC_THRESHOLD = 1024 * 1024;
 
-    var count = 0;
-    var selections = [];
+function searchSelection(doc) {
+    var from = doc.getCursor("from");
+    var to = doc.getCursor("to");
+    return [from.line, from.ch, to.line, to.ch];
+}
 
-    while (searchCursor.findNext()) {
-        count++;
+function clearSearchHighlights(state) {
+    for (var i = 0; i < state.marks.length; i++) {
+        state.marks[i].clear();
+    }
+    state.marks = [];
+}
+
+/* Starts tracking the current document, and returns a snapshot of it:
+   {seq, text, viewport: [fromLine, toLine], selection: [fromLine, fromCh, toLine, toCh]}
+   The changes that follow the snapshot have sequence numbers from seq + 1 on.
+*/
+UiDriver.registerEventHandler("C_FUN_START_SEARCH_TRACKING", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    if (!doc.nqqSearch)
+        doc.nqqSearch = {seq: 0, marks: []};
+
+    var viewport = editor.getViewport();
+    return {
+        seq: doc.nqqSearch.seq,
+        text: doc.getValue("\n"),
+        viewport: [viewport.from, viewport.to],
+        selection: searchSelection(doc)
+    };
+});
+
+UiDriver.registerEventHandler("C_CMD_STOP_SEARCH_TRACKING", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    if (!doc.nqqSearch)
+        return;
 
-        selections.push({anchor: searchCursor.from(), head: searchCursor.to()});
+    editor.operation(function() {
+        clearSearchHighlights(doc.nqqSearch);
+    });
+    delete doc.nqqSearch;
+});
+
+/* Highlights the given matches, replacing the previous ones.
+   data.seq: the last change the ranges are based on. Stale ranges are
+             ignored: C++ sends new ones after processing the newer changes.
+   data.ranges: flat array of [fromLine, fromCh, toLine, toCh] groups
+*/
+UiDriver.registerEventHandler("C_CMD_SET_SEARCH_HIGHLIGHTS", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    var state = doc.nqqSearch;
+    if (!state || state.seq !== data.seq)
+        return;
+
+    var ranges = data.ranges;
+    editor.operation(function() {
+        clearSearchHighlights(state);
+        for (var i = 0; i + 3 < ranges.length; i += 4) {
+            state.marks.push(doc.markText(
+                {line: ranges[i], ch: ranges[i + 1]},
+                {line: ranges[i + 2], ch: ranges[i + 3]},
+                {className: "cm-searching"}));
+        }
+    });
+});
+
+function clearDiffMarks(doc) {
+    var marks = doc.nqqDiff;
+    if (!marks)
+        return;
+
+    for (var i = 0; i + 1 < marks.length; i += 2) {
+        doc.removeLineClass(marks[i], "background", marks[i + 1]);
     }
+    doc.nqqDiff = null;
+}
 
-    editor.setSelections(selections);
+/* Marks the lines that differ from another document, as found by
+   DocumentComparison, with the classes of the merge addon. Replaces the
+   previous marks; empty hunks just clear them.
+   data.side: "a" if this is the document being compared, "b" if it's the
+              one it's compared with.
+   data.hunks: flat array of [fromA, countA, fromB, countB] groups, sorted.
+*/
+UiDriver.registerEventHandler("C_CMD_SET_DIFF_HUNKS", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    var hunks = data.hunks;
+    var offset = data.side === "b" ? 2 : 0;
+    var lastLine = doc.lastLine();
+
+    editor.operation(function() {
+        clearDiffMarks(doc);
+        if (hunks.length === 0)
+            return;
+
+        var marks = [];
+        var mark = function(line, cls) {
+            marks.push(doc.addLineClass(line, "background", cls), cls);
+        };
+
+        for (var i = 0; i + 3 < hunks.length; i += 4) {
+            var from = hunks[i + offset];
+            var count = hunks[i + offset + 1];
+
+            if (count === 0) {
+                // The lines are only on the other side: show where they'd be
+                if (from <= lastLine)
+                    mark(from, "CodeMirror-merge-r-chunk-start");
+                else
+                    mark(lastLine, "CodeMirror-merge-r-chunk-end");
+                continue;
+            }
+
+            var to = Math.min(from + count, lastLine + 1);
+            for (var line = from; line < to; line++) {
+                mark(line, "CodeMirror-merge-r-chunk");
+            }
+            mark(from, "CodeMirror-merge-r-chunk-start");
+            mark(to - 1, "CodeMirror-merge-r-chunk-end");
+        }
 
-    return count;
+        doc.nqqDiff = marks;
+
+        // Go to the first difference
+        var first = Math.min(hunks[offset], lastLine);
+        doc.setCursor({line: first, ch: 0});
+        editor.scrollIntoView({line: first, ch: 0}, editor.getScrollInfo().clientHeight / 3);
+    });
 });
 
 UiDriver.registerEventHandler("C_FUN_GET_LANGUAGES", function(msg, data, prevReturn) {
@@ -458,12 +938,31 @@ UiDriver.registerEventHandler("C_FUN_DETECT_INDENTATION_MODE", function(msg, dat
     return {found: false};
 });
 
-UiDriver.registerEventHandler("C_CMD_DISPLAY_PRINT_STYLE", function(msg, data, prevReturn) {
-    Printer.displayPrintStyle($(".editor")[0], editor);
+/*
+    Starts a print job on a snapshot of the current document (see Printer).
+    Returns {job, lineCount, tabSize}.
+*/
+UiDriver.registerEventHandler("C_FUN_START_PRINT_JOB", function(msg, data, prevReturn) {
+    var doc = editor.getDoc();
+    var options = {indentUnit: editor.getOption("indentUnit"), tabSize: editor.getOption("tabSize")};
+
+    return {
+        job: Printer.startJob(doc, doc.nqqModeSpec, loadedModeScripts(), options),
+        lineCount: doc.lineCount(),
+        tabSize: options.tabSize
+    };
+});
+
+/*
+    data: id of the print job
+    Returns a Promise for the next slice of it: {from, lines, styles, done}
+*/
+UiDriver.registerEventHandler("C_FUN_GET_PRINT_SLICE", function(msg, data, prevReturn) {
+    return Printer.nextSlice(data);
 });
 
-UiDriver.registerEventHandler("C_CMD_DISPLAY_NORMAL_STYLE", function(msg, data, prevReturn) {
-    Printer.displayNormalStyle($(".editor")[0], editor);
+UiDriver.registerEventHandler("C_CMD_END_PRINT_JOB", function(msg, data, prevReturn) {
+    Printer.endJob(data);
 });
 
 /*
@@ -535,18 +1034,6 @@ UiDriver.registerEventHandler("C_CMD_DELETE_LINE", function(msg, data, prevRetur
     editor.changeGeneration(true);
 });
 
-UiDriver.registerEventHandler("C_CMD_TRIM_LEADING_TRAILING_SPACE", function(msg, data, prevReturn) {
-    editLines(function (x) { return x.trim(); });
-});
-
-UiDriver.registerEventHandler("C_CMD_TRIM_TRAILING_SPACE", function(msg, data, prevReturn) {
-    editLines(function (x) { return x.replace(/\s+$/, ""); });
-});
-
-UiDriver.registerEventHandler("C_CMD_TRIM_LEADING_SPACE", function(msg, data, prevReturn) {
-    editLines(function (x) { return x.replace(/^\s+/, ""); });
-});
-
 UiDriver.registerEventHandler("C_CMD_ENABLE_MATH", function(msg, data, prevReturn) {
     require(['features/latex/latex'], function(math) {
         if (data) {
@@ -566,110 +1053,38 @@ UiDriver.registerEventHandler("C_FUN_IS_MATH_ENABLED", function(msg, data, prevR
     return math.isEnabled();
 })
 
-var tabToSpaceCounter = 0;
-function tabToSpaceHelper(match, offset, tabSize) {
-    /*
-        string.replace() does not update the string inbetween invokations of this update function.
-        Since we replace a single tab with multiple spaces we've got to keep track of the extra
-        string length outselves. tabToSpaceCounter holds the number of extra spaces we've added.
-     */
-    var trueOffset = offset + tabToSpaceCounter
-    
-    var numSpaces = tabSize - (trueOffset % tabSize)
-    
-    // Since the original tab is replaced by a space we only need numSpaces-1 new spaces
-    tabToSpaceCounter += numSpaces-1;
-
-    // Generate the whitespace. Sadly " ".repeat(numSpaces) does not work with this js interpreter.
-    var space = "";
-    for (var i = 0; i< numSpaces; i++)
-        space += " ";
-
-    return space;
-}
-
-UiDriver.registerEventHandler("C_CMD_TAB_TO_SPACE", function(msg, data, prevReturn) {
-    editLines(function (x) {
-        tabToSpaceCounter = 0
-        var tabSz = editor.getOption("tabSize")
-
-        return x.replace(/\t/g, function(match, offset) {
-            return tabToSpaceHelper(match, offset, tabSz)
-        });
-
-    });
-});
-
-var spaceToTabCounter = 0;
-function spaceToTabHelper(match, offset, tabSize) {  
-    // Like with tabToSpace, we need to keep track of the inserted/deleted character count.
-    var start = offset + spaceToTabCounter
-    var len = match.length
-    var result = ""
-
-    // Search for the first tab line manually
-    var leading = tabSize - (start % tabSize)
-    if (len >= leading) {
-        result += "\t"
-        len -= leading
-    }
-    
-    // then replace spaces with tabs
-    while(len>=tabSize) {
-        result += "\t"
-        len -= tabSize
-    }
-    
-    // finally add spaces if we can't add tabs anymore
-    while(len>0) {
-        result += " "
-        len -= 1
-    }
-    
-    spaceToTabCounter -= (match.length - result.length)
-    
-    return result
-}
-
-UiDriver.registerEventHandler("C_CMD_SPACE_TO_TAB_ALL", function(msg, data, prevReturn) {
-    editLines(function (x) {
-        spaceToTabCounter = 0
-        var tabSz = editor.getOption("tabSize")
-
-        return x.replace(/ +/g, function(match, offset) {
-            return spaceToTabHelper(match, offset, tabSz)
-        });
-
-    });
-});
-
-UiDriver.registerEventHandler("C_CMD_SPACE_TO_TAB_LEADING", function(msg, data, prevReturn) {
-    editLines(function (x) {
-        spaceToTabCounter = 0
-        var tabSz = editor.getOption("tabSize")
-
-        return x.replace(/^ +/g, function(match, offset) {
-            return spaceToTabHelper(match, offset, tabSz)
-        });
-
-    });
+/*
+    Returns what the line transformations done by the C++ side need:
+    the whole document, and a version number to hand back with the result.
+*/
+UiDriver.registerEventHandler("C_FUN_GET_TRANSFORM_SNAPSHOT", function(msg, data, prevReturn) {
+    return {
+        text: editor.getValue("\n"),
+        tabSize: editor.getOption("tabSize"),
+        version: editor.getDoc().nqqVersion || 0
+    };
 });
 
-function editLines(funct){
-    editor.operation(function(){
-        var len = editor.lineCount();
-        for (var i = 0; i < len; i++) {
-            var line = editor.getLine(i);
-            var from = {line: i, ch: 0};
-            var to = {line: i, ch: line.length};
-            editor.replaceRange(funct(line), from,to);
+/*
+    Applies the result of a line transformation as a single undoable change.
+    data.patches is a list of [fromLine, toLine, text], where text replaces
+    the lines in [fromLine, toLine). Returns false, without touching anything,
+    if the document has been edited since the snapshot.
+*/
+UiDriver.registerEventHandler("C_CMD_APPLY_LINE_PATCHES", function(msg, data, prevReturn) {
+    if ((editor.getDoc().nqqVersion || 0) !== data.version)
+        return false;
+
+    editor.operation(function() {
+        // Bottom-up, so that the line numbers of the next patches stay valid
+        for (var i = data.patches.length - 1; i >= 0; i--) {
+            var patch = data.patches[i];
+            var last = patch[1] - 1;
+            editor.replaceRange(patch[2], {line: patch[0], ch: 0}, {line: last, ch: editor.getLine(last).length});
         }
     });
-}
 
-UiDriver.registerEventHandler("C_CMD_EOL_TO_SPACE", function(msg, data, prevReturn) {
-    var text = editor.getValue("\n");
-    editor.setValue(text.replace(/\n/gm," "));
+    return true;
 });
 
 function getDocumentInfo()
@@ -691,21 +1106,15 @@ UiDriver.registerEventHandler("C_CMD_GET_DOCUMENT_INFO", function(msg, data, pre
 });
 
 $(document).ready(function () {
-    editor = CodeMirror($(".editor")[0], {
+    editor = CodeMirror($(".editor")[0], $.extend({
         lineNumbers: true,
         mode: { name: "" },
-        highlightSelectionMatches: {style: "selectedHighlight", wordsOnly: true, delay: 25},
-        styleSelectedText: true,
-        styleActiveLine: true,
-        foldGutter: true,
-        gutters: ["CodeMirror-linenumbers", "CodeMirror-foldgutter"],
         indentWithTabs: true,
         indentUnit: 4,
         tabSize: 4,
-        matchBrackets: true,
         extraKeys: {"Ctrl-Space": "autocomplete"},
         theme: _defaultTheme
-    });
+    }, NORMAL_PROFILE));
 
     editor.addKeyMap({
         "Tab": function (cm) {
@@ -730,13 +1139,52 @@ $(document).ready(function () {
 
     changeGeneration = editor.changeGeneration(true);
 
+    UiDriver.setDocumentActivator(activateDocument);
+
+    // Reported once the change is applied: before that it may still be canceled, modified
+    // or split around read-only marks. Its from/to are positions before the change either way.
+    editor.on("change", function(instance, change) {
+        var state = instance.getDoc().nqqSearch;
+        if (!state)
+            return;
+
+        state.seq++;
+
+        var size = change.text.length - 1;
+        for (var i = 0; i < change.text.length && size <= SEARCH_RESYNC_THRESHOLD; i++) {
+            size += change.text[i].length;
+        }
+
+        if (size > SEARCH_RESYNC_THRESHOLD) {
+            UiDriver.sendMessage("J_EVT_SEARCH_CHANGE", {seq: state.seq, resync: true});
+        } else {
+            UiDriver.sendMessage("J_EVT_SEARCH_CHANGE", {
+                seq: state.seq,
+                from: [change.from.line, change.from.ch],
+                to: [change.to.line, change.to.ch],
+                text: change.text.join("\n")
+            });
+        }
+    });
+
+    editor.on("viewportChange", function(instance, from, to) {
+        if (instance.getDoc().nqqSearch)
+            UiDriver.sendMessage("J_EVT_SEARCH_VIEWPORT", [from, to]);
+    });
+
     editor.on("change", function(instance, changeObj) {
+        var doc = instance.getDoc();
+        doc.nqqVersion = (doc.nqqVersion || 0) + 1;
         UiDriver.sendMessage("J_EVT_CONTENT_CHANGED");
         UiDriver.sendMessage("J_EVT_CLEAN_CHANGED", isCleanOrForced(changeGeneration));
     });
 
     editor.on("cursorActivity", function(instance) {
         UiDriver.sendMessage("J_EVT_CURSOR_ACTIVITY", getDocumentInfo());
+
+        var doc = instance.getDoc();
+        if (doc.nqqSearch)
+            UiDriver.sendMessage("J_EVT_SEARCH_SELECTION", searchSelection(doc));
     });
 
     editor.on("focus", function() {
@@ -0,0 +1,211 @@
+/*
+    Runs the syntax highlighting of big documents in a Web Worker
+    (TokenizerWorker.js), so that it never blocks typing or scrolling.
+
+    The document is switched to the "nqq-background" mode, which doesn't
+    tokenize anything by itself: it replays the styles computed by the worker.
+    Lines whose styles are not known yet, or have been invalidated by an edit,
+    are shown as plain text until the worker catches up.
+*/
+var BackgroundHighlighter = new function() {
+
+    // Documents with fewer lines are highlighted on the main thread as usual
+    this.MIN_LINES = 20000;
+
+    var WORKER_URL = "classes/TokenizerWorker.js";
+
+    // Minimum delay (in milliseconds) between two repaints caused by new styles
+    var REPAINT_DELAY = 100;
+
+    // Properties of the real mode that make sense without its state
+    var MODE_PROPERTIES = ["lineComment", "blockCommentStart", "blockCommentEnd", "blockCommentLead",
+                           "electricChars", "electricInput", "closeBrackets", "fold"];
+
+    function Session(doc, spec, scripts, options, onError) {
+        var self = this;
+
+        this.doc = doc;
+        this.spec = spec;
+        this.version = 0;
+        this.styles = [];    // Style array of each line, or undefined if not known
+        this.changes = [];   // {version, line} of the edits the worker may not have seen yet
+        this.repaintTimer = null;
+
+        this.worker = new Worker(WORKER_URL);
+
+        this.worker.onmessage = function(e) {
+            if (e.data.type === "styles") {
+                self.receiveStyles(e.data);
+            } else if (e.data.type === "error") {
+                console.error("Background highlighting failed: " + e.data.message);
+                onError();
+            }
+        };
+
+        this.worker.onerror = function(e) {
+            console.error("Background highlighting failed: " + e.message);
+            onError();
+        };
+
+        this.onChange = function(doc, change) {
+            self.version++;
+
+            // Keep the styles of the lines after the edit where they are: most
+            // likely they're still right, and they'll be refreshed anyway.
+            var added = [];
+            added.length = change.text.length;
+            Array.prototype.splice.apply(self.styles, [change.from.line, change.to.line - change.from.line + 1].concat(added));
+
+            self.changes.push({version: self.version, line: change.from.line});
+            self.worker.postMessage({type: "change", version: self.version,
+                                     from: change.from, to: change.to, text: change.text});
+        };
+
+        doc.on("change", this.onChange);
+
+        var lines = [];
+        doc.eachLine(function(line) { lines.push(line.text); });
+        this.worker.postMessage({type: "init", version: this.version, lines: lines,
+                                 scripts: scripts, spec: spec, options: options});
+    }
+
+    Session.prototype.receiveStyles = function(msg) {
+        // Messages come in order: the worker has seen every edit up to msg.version
+        this.changes = this.changes.filter(function(c) { return c.version > msg.version; });
+
+        // Styles computed before the latest edits are only good for the lines before them
+        var limit = Infinity;
+        this.changes.forEach(function(c) { limit = Math.min(limit, c.line); });
+
+        var count = Math.min(msg.styles.length, limit - msg.from);
+        for (var i = 0; i < count; i++) {
+            this.styles[msg.from + i] = msg.styles[i];
+        }
+
+        var cm = this.doc.cm;
+        if (count > 0 && cm) {
+            var viewport = cm.getViewport();
+            if (msg.from < viewport.to && msg.from + count > viewport.from)
+                this.scheduleRepaint();
+        }
+    };
+
+    Session.prototype.scheduleRepaint = function() {
+        if (this.repaintTimer !== null)
+            return;
+
+        var self = this;
+        this.repaintTimer = setTimeout(function() {
+            self.repaintTimer = null;
+            var cm = self.doc.cm;
+            if (cm) {
+                // Resetting the mode makes CodeMirror forget the cached styles.
+                // Cheap, since our mode doesn't need to catch up with anything.
+                cm.setOption("mode", cm.getOption("mode"));
+            }
+        }, REPAINT_DELAY);
+    };
+
+    Session.prototype.close = function() {
+        clearTimeout(this.repaintTimer);
+        this.doc.off("change", this.onChange);
+        this.worker.terminate();
+    };
+
+    CodeMirror.defineMode("nqq-background", function(config, modeConfig) {
+        var mode = {
+            startState: function() {
+                return {line: -1, index: 0};
+            },
+
+            token: function(stream, state) {
+                // The line oracle is the context CodeMirror is highlighting
+                var context = stream.lineOracle;
+                var session = context && context.doc && context.doc.nqqBackgroundHighlighter;
+                var styles = session && session.styles[context.line];
+
+                if (!styles) {
+                    stream.skipToEnd();
+                    return null;
+                }
+
+                if (state.line !== context.line) {
+                    state.line = context.line;
+                    state.index = 0;
+                }
+
+                while (state.index < styles.length && styles[state.index] <= stream.pos)
+                    state.index += 2;
+
+                if (state.index >= styles.length) {
+                    stream.skipToEnd();
+                    return null;
+                }
+
+                stream.pos = Math.min(styles[state.index], stream.string.length);
+                return styles[state.index + 1];
+            }
+        };
+
+        var inner = CodeMirror.getMode(config, modeConfig.inner);
+        MODE_PROPERTIES.forEach(function(name) {
+            if (inner[name] !== undefined)
+                mode[name] = inner[name];
+        });
+
+        return mode;
+    });
+
+    /*
+        Starts highlighting the current document of cm in the background,
+        with the given mode. scripts are the urls of the files that define
+        the mode and its dependencies.
+        Returns false if the document has to be highlighted as usual.
+    */
+    this.enable = function(cm, spec, scripts) {
+        var doc = cm.getDoc();
+        var session = doc.nqqBackgroundHighlighter;
+
+        if (session !== undefined && session.spec === spec)
+            return true;
+
+        this.disable(cm);
+
+        if (!spec || spec === "null" || spec === "text/plain" || typeof Worker === "undefined")
+            return false;
+
+        var options = {indentUnit: cm.getOption("indentUnit"), tabSize: cm.getOption("tabSize")};
+
+        try {
+            doc.nqqBackgroundHighlighter = new Session(doc, spec, scripts, options, function() {
+                // Fall back to the main thread
+                if (doc.nqqBackgroundHighlighter !== undefined) {
+                    doc.nqqBackgroundHighlighter.close();
+                    delete doc.nqqBackgroundHighlighter;
+                    if (doc.cm)
+                        doc.cm.setOption("mode", spec);
+                }
+            });
+        } catch (err) {
+            // E.g. workers are not allowed for this page
+            console.error("Unable to start background highlighting: " + err);
+            delete doc.nqqBackgroundHighlighter;
+            return false;
+        }
+
+        cm.setOption("mode", {name: "nqq-background", inner: spec});
+        return true;
+    };
+
+    /*
+        Stops highlighting the current document of cm in the background.
+        The caller has to set the mode it wants to use instead.
+    */
+    this.disable = function(cm) {
+        var doc = cm.getDoc();
+        if (doc.nqqBackgroundHighlighter !== undefined) {
+            doc.nqqBackgroundHighlighter.close();
+            delete doc.nqqBackgroundHighlighter;
+        }
+    };
+}
@@ -1,12 +1,114 @@
+/*
+    Print jobs feed DocumentPrinter, on the C++ side, with the text and the
+    syntax highlighting of a snapshot of a document. The snapshot is sent one
+    slice at a time, as C++ asks for it, so that neither side ever holds more
+    than a slice of styles. The highlighting runs in a TokenizerWorker: the
+    editor itself is left alone.
+*/
 var Printer = new function() {
 
-    this.displayPrintStyle = function (editorDOM, editor) {
-        editorDOM.classList.add("print");
-        editor.refresh();
-    }
+    var WORKER_URL = "classes/TokenizerWorker.js";
+
+    // Lines per slice, when there's no highlighting to wait for
+    var PLAIN_SLICE_LINES = 2000;
 
-    this.displayNormalStyle = function (editorDOM, editor) {
-        editorDOM.classList.remove("print");
-        editor.refresh();
+    var jobs = {};
+    var nextJobId = 1;
+
+    function Job(lines) {
+        this.lines = lines;
+        this.next = 0;
+        this.worker = null;
+        this.pending = null;   // resolve() of the slice the worker is working on
     }
+
+    Job.prototype.plainSlice = function() {
+        var from = this.next;
+        var lines = this.lines.slice(from, from + PLAIN_SLICE_LINES);
+        this.next = from + lines.length;
+        return {from: from, lines: lines, styles: null, done: this.next >= this.lines.length};
+    };
+
+    Job.prototype.stopWorker = function() {
+        if (this.worker !== null) {
+            this.worker.terminate();
+            this.worker = null;
+        }
+    };
+
+    Job.prototype.onWorkerMessage = function(msg) {
+        var resolve = this.pending;
+        this.pending = null;
+
+        if (msg.type === "styles") {
+            var from = msg.from;
+            this.next = from + msg.styles.length;
+            if (resolve !== null) {
+                resolve({from: from, lines: this.lines.slice(from, this.next), styles: msg.styles,
+                         done: this.next >= this.lines.length});
+            }
+        } else {
+            // Print the rest of the document without highlighting
+            console.error("Highlighting for print failed: " + msg.message);
+            this.stopWorker();
+            if (resolve !== null)
+                resolve(this.plainSlice());
+        }
+    };
+
+    /*
+        Takes a snapshot of doc, to be highlighted with the given mode.
+        scripts are the urls of the files that define the mode and its dependencies.
+        Returns the id of the job.
+    */
+    this.startJob = function(doc, spec, scripts, options) {
+        var lines = [];
+        doc.eachLine(function(line) { lines.push(line.text); });
+
+        var id = nextJobId++;
+        var job = jobs[id] = new Job(lines);
+
+        if (spec && spec !== "null" && spec !== "text/plain" && typeof Worker !== "undefined") {
+            try {
+                job.worker = new Worker(WORKER_URL);
+                job.worker.onmessage = function(e) { job.onWorkerMessage(e.data); };
+                job.worker.onerror = function(e) { job.onWorkerMessage({type: "error", message: e.message}); };
+                job.worker.postMessage({type: "init", version: 0, lines: lines, scripts: scripts,
+                                        spec: spec, options: options, onDemand: true});
+            } catch (err) {
+                console.error("Unable to highlight for print: " + err);
+                job.worker = null;
+            }
+        }
+
+        return id;
+    };
+
+    /*
+        Returns a Promise for the next slice of the job:
+        {from, lines, styles, done}. styles is null if the lines are not
+        highlighted, otherwise it holds a CodeMirror style array
+        ([end, style, end, style, ...]) for each line.
+    */
+    this.nextSlice = function(id) {
+        var job = jobs[id];
+        if (job === undefined)
+            return Promise.reject("No such print job: " + id);
+
+        if (job.worker === null || job.next >= job.lines.length)
+            return Promise.resolve(job.plainSlice());
+
+        return new Promise(function(resolve) {
+            job.pending = resolve;
+            job.worker.postMessage({type: "more"});
+        });
+    };
+
+    this.endJob = function(id) {
+        var job = jobs[id];
+        if (job !== undefined) {
+            job.stopWorker();
+            delete jobs[id];
+        }
+    };
 }
@@ -0,0 +1,222 @@
+/*
+    Web Worker used by BackgroundHighlighter and by the print jobs (see Printer).
+    It keeps a copy of the document, runs the CodeMirror mode over it and sends
+    the style arrays back to the page.
+
+    Messages from the page:
+        { type: "init", version, lines, scripts, spec, options, onDemand }
+        { type: "change", version, from, to, text }   (a CodeMirror change object)
+        { type: "more" }   (with onDemand, tokenize the next slice)
+
+    Messages to the page:
+        { type: "styles", version, from, styles }   (styles of the lines from "from" on)
+        { type: "error", message }
+*/
+
+// runmode-standalone.js expects to be loaded within a window
+self.window = self;
+importScripts("../libs/codemirror/addon/runmode/runmode-standalone.js");
+
+// Number of lines tokenized before checking for new messages
+var SLICE_LINES = 2000;
+
+// A copy of the mode state is kept every CHECKPOINT_INTERVAL lines, so that
+// after an edit we can restart from the closest line before it.
+var CHECKPOINT_INTERVAL = 256;
+
+var tabSize = 4;
+var imported = {};
+var mode = null;
+var lines = [];
+var version = 0;
+var checkpoints = [];
+var state = null;
+var nextLine = 0;
+var scheduled = false;
+
+// If true, a slice is tokenized only when the page asks for it
+var onDemand = false;
+
+/*
+    runmode-standalone.js only provides the bare minimum to run a mode.
+    Add the parts of the CodeMirror API that the modes use.
+*/
+function countColumn(string, end, tabSize) {
+    var n = 0;
+    for (var i = 0; i < end; i++) {
+        n += string.charAt(i) === "\t" ? tabSize - (n % tabSize) : 1;
+    }
+    return n;
+}
+
+CodeMirror.StringStream.prototype.column = function() {
+    return countColumn(this.string, this.start, tabSize) - countColumn(this.string, this.lineStart, tabSize);
+};
+
+CodeMirror.StringStream.prototype.indentation = function() {
+    var end = this.string.search(/[^\s\u00a0]/);
+    if (end === -1) end = this.string.length;
+    return countColumn(this.string, end, tabSize) - countColumn(this.string, this.lineStart, tabSize);
+};
+
+CodeMirror.copyState = function(mode, state) {
+    if (state === true) return state;
+    if (mode.copyState) return mode.copyState(state);
+    var nstate = {};
+    for (var n in state) {
+        var val = state[n];
+        if (val instanceof Array) val = val.concat([]);
+        nstate[n] = val;
+    }
+    return nstate;
+};
+
+CodeMirror.innerMode = function(mode, state) {
+    var info;
+    while (mode.innerMode) {
+        info = mode.innerMode(state);
+        if (!info || info.mode === mode) break;
+        state = info.state;
+        mode = info.mode;
+    }
+    return info || {mode: mode, state: state};
+};
+
+CodeMirror.Pass = {toString: function() { return "CodeMirror.Pass"; }};
+CodeMirror.extendMode = function() {};
+CodeMirror.defineExtension = function() {};
+CodeMirror.defineOption = function() {};
+
+/*
+    Returns the styles of a line in the same format CodeMirror uses
+    internally: [end, style, end, style, ...].
+*/
+function tokenizeLine(text) {
+    var styles = [];
+    var stream = new CodeMirror.StringStream(text);
+
+    if (text === "" && mode.blankLine)
+        mode.blankLine(state);
+
+    var stuck = 0;
+    while (!stream.eol()) {
+        var style = mode.token(stream, state);
+
+        if (stream.pos <= stream.start) {
+            // Like CodeMirror, give the mode a few chances to change
+            // its state before giving up on the rest of the line.
+            if (++stuck < 10)
+                continue;
+            stream.pos = text.length;
+            style = null;
+        }
+        stuck = 0;
+
+        if (styles.length > 0 && styles[styles.length - 1] === style)
+            styles[styles.length - 2] = stream.pos;
+        else
+            styles.push(stream.pos, style);
+
+        stream.start = stream.pos;
+    }
+
+    return styles;
+}
+
+function work() {
+    scheduled = false;
+    if (mode === null)
+        return;
+
+    var from = nextLine;
+    var end = Math.min(lines.length, from + SLICE_LINES);
+    var out = [];
+
+    for (var i = from; i < end; i++) {
+        if (i % CHECKPOINT_INTERVAL === 0)
+            checkpoints[i / CHECKPOINT_INTERVAL] = CodeMirror.copyState(mode, state);
+        out.push(tokenizeLine(lines[i]));
+    }
+
+    nextLine = end;
+
+    // On demand, the page is waiting for an answer even if there's nothing left
+    if (out.length > 0 || onDemand)
+        postMessage({type: "styles", version: version, from: from, styles: out});
+
+    if (nextLine < lines.length && !onDemand)
+        schedule();
+}
+
+function schedule() {
+    if (!scheduled) {
+        scheduled = true;
+        // Yields to the message queue, so that edits are seen as soon as possible
+        setTimeout(work, 0);
+    }
+}
+
+function restartFrom(line) {
+    if (line >= nextLine)
+        return;
+
+    var c = Math.min(Math.floor(line / CHECKPOINT_INTERVAL), checkpoints.length - 1);
+    if (c >= 0) {
+        state = CodeMirror.copyState(mode, checkpoints[c]);
+        checkpoints.length = c;
+        nextLine = c * CHECKPOINT_INTERVAL;
+    } else {
+        state = CodeMirror.startState(mode);
+        checkpoints = [];
+        nextLine = 0;
+    }
+
+    schedule();
+}
+
+function applyChange(change) {
+    var inserted = change.text.slice();
+    inserted[0] = lines[change.from.line].slice(0, change.from.ch) + inserted[0];
+    inserted[inserted.length - 1] += lines[change.to.line].slice(change.to.ch);
+
+    Array.prototype.splice.apply(lines, [change.from.line, change.to.line - change.from.line + 1].concat(inserted));
+}
+
+onmessage = function(e) {
+    var msg = e.data;
+
+    if (msg.type === "init") {
+        try {
+            msg.scripts.forEach(function(url) {
+                if (!imported[url]) {
+                    importScripts(url);
+                    imported[url] = true;
+                }
+            });
+            mode = CodeMirror.getMode(msg.options, msg.spec);
+        } catch (err) {
+            mode = null;
+            postMessage({type: "error", message: String(err)});
+            return;
+        }
+
+        tabSize = msg.options.tabSize;
+        onDemand = !!msg.onDemand;
+        lines = msg.lines;
+        version = msg.version;
+        checkpoints = [];
+        state = CodeMirror.startState(mode);
+        nextLine = 0;
+        if (!onDemand)
+            schedule();
+
+    } else if (msg.type === "more") {
+        schedule();
+
+    } else if (msg.type === "change") {
+        version = msg.version;
+        applyChange(msg);
+        if (mode !== null)
+            restartFrom(msg.from.line);
+    }
+};
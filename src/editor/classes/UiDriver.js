@@ -4,6 +4,13 @@ var UiDriver = new function() {
     var msgQueue = [];
     var cpp_ui_driver = null;
 
+    // When the page is shared by several C++ Editors (see EditorHost), each
+    // message is tagged with the id of the document it refers to. This is the
+    // id of the document being handled right now: undefined if the page
+    // hosts a single document.
+    var currentDocId = undefined;
+    var documentActivator = null;
+
     // Setup the communication channel
     document.addEventListener("DOMContentLoaded", () => {
         new QWebChannel(qt.webChannelTransport, (channel) => {
@@ -17,7 +24,7 @@ var UiDriver = new function() {
 
             // Send the queued messages that were sent while the channel wasn't ready yet.
             for (var i = 0; i < msgQueue.length; i++) {
-                this.sendMessage(msgQueue[i][0], msgQueue[i][1]);
+                this.sendMessage(msgQueue[i][0], msgQueue[i][1], msgQueue[i][2]);
             }
             msgQueue = [];
         
@@ -25,13 +32,19 @@ var UiDriver = new function() {
         });
     });
 
-    // Send a message to C++
-    this.sendMessage = function(msg, data) {
+    // Send a message to C++. docId defaults to the current document.
+    this.sendMessage = function(msg, data, docId) {
+        if (docId === undefined)
+            docId = currentDocId;
+
         if (cpp_ui_driver === null) { // Channel not yet ready: enqueue the message
-            msgQueue.push([msg, data]);
+            msgQueue.push([msg, data, docId]);
             return;
         }
 
+        if (docId !== undefined)
+            msg += "[DOC=" + docId + "]";
+
         if (data !== null && data !== undefined) {
             cpp_ui_driver.receiveMessage(msg, data, function(ret) {  });
         } else {
@@ -39,6 +52,22 @@ var UiDriver = new function() {
         }
     }
 
+    // Sets the function that makes the document with the given id the one
+    // the editor works on, before its messages get handled.
+    this.setDocumentActivator = function(activator) {
+        documentActivator = activator;
+    }
+
+    this.currentDocumentId = function() {
+        return currentDocId;
+    }
+
+    this.activateDocument = function(docId) {
+        currentDocId = docId;
+        if (docId !== undefined && documentActivator !== null)
+            documentActivator(docId);
+    }
+
     this.registerEventHandler = function(msg, handler) {
         if (handlers[msg] === undefined)
             handlers[msg] = [];
@@ -48,6 +77,14 @@ var UiDriver = new function() {
 
     // Invoked whenever we've got an incoming message from C++
     this.messageReceived = function(msg, data) {
+        var docMatch = /^(.*)\[DOC=(\d+)\]$/.exec(msg);
+        var docId = undefined;
+        if (docMatch !== null) {
+            msg = docMatch[1];
+            docId = parseInt(docMatch[2]);
+            this.activateDocument(docId);
+        }
+
         // Check if the message is async
         if (msg.startsWith("[ASYNC_REQUEST]")) {
             
@@ -70,8 +107,21 @@ var UiDriver = new function() {
                     });
                 }
 
-                // Send an asynchronous reply
-                this.sendMessage("[ASYNC_REPLY]" + real_msg + "[ID=" + msg_id + "]", prevReturn);
+                var reply = "[ASYNC_REPLY]" + real_msg + "[ID=" + msg_id + "]";
+
+                if (prevReturn !== undefined && prevReturn !== null && typeof prevReturn.then === "function") {
+                    // The handler returned a Promise (e.g. because it needs to load
+                    // something first): reply as soon as it settles.
+                    prevReturn.then((value) => {
+                        this.sendMessage(reply, value, docId);
+                    }, (error) => {
+                        console.error(real_msg + " failed: " + error);
+                        this.sendMessage(reply, undefined, docId);
+                    });
+                } else {
+                    // Send an asynchronous reply
+                    this.sendMessage(reply, prevReturn, docId);
+                }
             }
 
         } else {
@@ -0,0 +1,390 @@
+#include "include/EditorNS/bulktransferschemehandler.h"
+#include "include/EditorNS/editor.h"
+#include "include/EditorNS/linediff.h"
+#include "include/Search/documentsearch.h"
+#include "include/Search/literalmatcher.h"
+
+#include <QApplication>
+#include <QEventLoop>
+#include <QSettings>
+#include <QString>
+#include <QtTest>
+
+using namespace EditorNS;
+
+/**
+ * @brief Measures the operations that go through the bridge between Editor
+ *        and its page, on synthetic documents of increasing size.
+ */
+class EditorBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    EditorBenchmark();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void timeToReady();
+    void setValue_data();
+    void setValue();
+    void value_data();
+    void value();
+    void lineCount_data();
+    void lineCount();
+    void search_data();
+    void search();
+    void documentSearch_data();
+    void documentSearch();
+    void replaceAll_data();
+    void replaceAll();
+    void selections_data();
+    void selections();
+    void lineDiff_data();
+    void lineDiff();
+    void literalMatcher_data();
+    void literalMatcher();
+
+private:
+    // The last line of every document, so that a search has to go through all of it
+    static const QString NEEDLE;
+
+    Editor *m_editor = nullptr;
+    qint64 m_maxSize;
+    qint64 m_documentSize = -1;
+    QString m_document;
+
+    void addSizes();
+    const QString &document(qint64 size);
+    void loadDocument(qint64 size);
+    static void waitUntilReady(Editor *editor);
+};
+
+const QString EditorBenchmark::NEEDLE = "NEEDLE";
+
+EditorBenchmark::EditorBenchmark()
+{
+    bool ok;
+    const qint64 maxMegabytes = qgetenv("NQQ_BENCHMARK_MAX_MB").toLongLong(&ok);
+    m_maxSize = (ok ? maxMegabytes : 500) * 1024 * 1024;
+}
+
+void EditorBenchmark::initTestCase()
+{
+    m_editor = new Editor();
+    waitUntilReady(m_editor);
+}
+
+void EditorBenchmark::cleanupTestCase()
+{
+    delete m_editor;
+    m_editor = nullptr;
+}
+
+void EditorBenchmark::addSizes()
+{
+    QTest::addColumn<qint64>("size");
+
+    const QList<QPair<const char *, qint64>> sizes {
+        {"1KB", 1024},
+        {"64KB", 64 * 1024},
+        {"1MB", 1024 * 1024},
+        {"16MB", 16 * 1024 * 1024},
+        {"100MB", 100 * 1024 * 1024},
+        {"500MB", 500 * 1024 * 1024}
+    };
+
+    for (const auto &size : sizes) {
+        if (size.second <= m_maxSize) {
+            QTest::newRow(size.first) << size.second;
+        }
+    }
+}
+
+const QString &EditorBenchmark::document(qint64 size)
+{
+    // Only the last document is kept: the big ones take gigabytes.
+    if (m_documentSize != size) {
+        m_document.clear();
+        m_document.reserve(size);
+
+        int i = 0;
+        while (m_document.size() < size - NEEDLE.size()) {
+            m_document += QString("    int value%1 = compute(%2, \"some text\"); // line %1\n").arg(i).arg(i % 97);
+            i++;
+        }
+
+        m_document.truncate(qMax(0LL, size - NEEDLE.size()));
+        m_document += NEEDLE;
+        m_documentSize = size;
+    }
+
+    return m_document;
+}
+
+void EditorBenchmark::loadDocument(qint64 size)
+{
+    m_editor->setValue(document(size)).wait();
+    m_editor->asyncSendMessageWithResultP("C_CMD_CLEAR_HISTORY").wait();
+}
+
+void EditorBenchmark::waitUntilReady(Editor *editor)
+{
+    if (editor->loadTime() >= 0)
+        return;
+
+    QEventLoop loop;
+    QObject::connect(editor, &Editor::editorReady, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+void EditorBenchmark::timeToReady()
+{
+    QBENCHMARK {
+        Editor editor;
+        waitUntilReady(&editor);
+    }
+}
+
+void EditorBenchmark::setValue_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::setValue()
+{
+    QFETCH(qint64, size);
+    const QString &text = document(size);
+
+    QBENCHMARK {
+        m_editor->setValue(text).wait();
+    }
+
+    m_editor->asyncSendMessageWithResultP("C_CMD_CLEAR_HISTORY").wait();
+}
+
+void EditorBenchmark::value_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::value()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    QString result;
+    QBENCHMARK {
+        result = m_editor->value();
+    }
+
+    QCOMPARE(result.size(), document(size).size());
+}
+
+void EditorBenchmark::lineCount_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::lineCount()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    QBENCHMARK {
+        m_editor->lineCount().wait();
+    }
+}
+
+void EditorBenchmark::search_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::search()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    const QVariantList data {NEEDLE, "", true};
+
+    QBENCHMARK {
+        m_editor->setCursorPosition(0, 0);
+        m_editor->asyncSendMessageWithResultP("C_FUN_SEARCH", data).wait();
+    }
+}
+
+void EditorBenchmark::documentSearch_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::documentSearch()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    int count = 0;
+
+    // Taking the copy of the document and building the match index
+    QBENCHMARK {
+        DocumentSearch search(m_editor);
+        search.waitUntilReady();
+        search.setPattern("value", false);
+        count = search.matchCount();
+    }
+
+    QVERIFY(count > 0);
+}
+
+void EditorBenchmark::replaceAll_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::replaceAll()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    // Replacing a word with itself touches every match, but keeps the
+    // document the same for the next runs.
+    const QVariantList data {"value", "", "value", 1};
+    int count = 0;
+
+    // Every run adds an entry to the history as big as the document
+    QBENCHMARK_ONCE {
+        m_editor->asyncSendMessageWithResultP("C_FUN_REPLACE_ALL", data)
+                .then([&](QVariant result) { count = result.toInt(); }).wait();
+    }
+
+    QVERIFY(count > 0);
+    m_editor->asyncSendMessageWithResultP("C_CMD_CLEAR_HISTORY").wait();
+}
+
+void EditorBenchmark::selections_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::selections()
+{
+    QFETCH(qint64, size);
+    loadDocument(size);
+
+    int lines = 0;
+    m_editor->lineCount().then([&](int n) { lines = n; }).wait();
+    // Select everything (CodeMirror clips the end to the last character)
+    m_editor->setSelection(0, 0, lines, 0);
+
+    QBENCHMARK {
+        m_editor->selections();
+        m_editor->selectedTexts().wait();
+    }
+}
+
+void EditorBenchmark::lineDiff_data()
+{
+    addSizes();
+}
+
+void EditorBenchmark::lineDiff()
+{
+    QFETCH(qint64, size);
+    const QString &a = document(size);
+
+    // A line changed every ~1000, and one added in the middle
+    QStringList lines = a.split('\n');
+    for (int i = 500; i < lines.size(); i += 1000) {
+        lines[i] += " // changed";
+    }
+    lines.insert(lines.size() / 2, "added");
+    const QString b = lines.join('\n');
+    lines.clear();
+
+    int hunks = 0;
+
+    QBENCHMARK {
+        hunks = LineDiff::compute(a, b).size();
+    }
+
+    QVERIFY(hunks > 0);
+}
+
+void EditorBenchmark::literalMatcher_data()
+{
+    QTest::addColumn<QByteArray>("needle");
+    QTest::addColumn<bool>("matchCase");
+
+    // How often the needles occur in the document: never, once every 97 lines, on every line
+    const QList<QPair<const char *, QByteArray>> needles {
+        {"short, no matches", "xyzzy"},
+        {"short, sparse", "compute(13,"},
+        {"short, dense", "value"},
+        {"long, no matches", "a needle that is nowhere to be found in the document"},
+        {"long, sparse", "compute(13, \"some text\"); // line"},
+        {"long, dense", "\"some text\"); // line"}
+    };
+
+    for (const auto &needle : needles) {
+        QTest::newRow(QByteArray(needle.first) + ", match case") << needle.second << true;
+        QTest::newRow(QByteArray(needle.first) + ", ignore case") << needle.second << false;
+    }
+}
+
+void EditorBenchmark::literalMatcher()
+{
+    QFETCH(QByteArray, needle);
+    QFETCH(bool, matchCase);
+
+    const QByteArray text = document(qMin(m_maxSize, 16LL * 1024 * 1024)).toUtf8();
+    const LiteralMatcher matcher(needle, matchCase);
+    qDebug() << "Implementation:" << LiteralMatcher::implementationName();
+
+    int matches = 0;
+
+    QBENCHMARK {
+        matches = 0;
+        int offset = 0;
+        while ((offset = matcher.indexIn(text.constData(), text.size(), offset)) != -1) {
+            matches++;
+            offset += needle.size();
+        }
+    }
+
+    const QByteArray expectedText = matchCase ? text : text.toLower();
+    const QByteArray expectedNeedle = matchCase ? needle : needle.toLower();
+    int expected = 0;
+    int offset = 0;
+    while ((offset = expectedText.indexOf(expectedNeedle, offset)) != -1) {
+        expected++;
+        offset += needle.size();
+    }
+
+    QCOMPARE(matches, expected);
+}
+
+int main(int argc, char *argv[])
+{
+    // No display needed
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // Custom url schemes must be known to QtWebEngine before the application starts
+    BulkTransferSchemeHandler::registerUrlScheme();
+
+    QApplication app(argc, argv);
+
+    // Keep the user's settings out of the measurements, and vice versa
+    QCoreApplication::setOrganizationName("Notepadqq");
+    QCoreApplication::setApplicationName("Notepadqq-benchmarks");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+
+    EditorBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "tst_editorbenchmark.moc"
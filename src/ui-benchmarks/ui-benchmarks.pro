@@ -0,0 +1,22 @@
+# Benchmarks for the Editor, driving real editor pages. Runs offscreen.
+#
+# Build notepadqq first, so that the editor files are in place, then run e.g.
+#   out/release/lib/ui-benchmarks -o results.xml,xml
+# Set NQQ_BENCHMARK_MAX_MB to skip the documents bigger than that.
+
+QT += testlib
+TEMPLATE = app
+TARGET = ui-benchmarks
+
+# Same location as notepadqq-bin, so that Notepadqq::editorPath() finds the editor
+CONFIG(debug, debug|release): DESTDIR = ../../out/debug/lib
+CONFIG(release, debug|release): DESTDIR = ../../out/release/lib
+
+RCC_DIR = ../../out/build_benchmarks
+UI_DIR = ../../out/build_benchmarks
+MOC_DIR = ../../out/build_benchmarks
+OBJECTS_DIR = ../../out/build_benchmarks
+
+include(../ui/ui.pri)
+
+SOURCES += tst_editorbenchmark.cpp
@@ -1,9 +1,46 @@
 #include <QString>
 #include <QtTest>
 #include "include/notepadqq.h"
+#include "include/EditorNS/texttransform.h"
+#include "include/EditorNS/linediff.h"
+#include "include/Search/linecounter.h"
+#include "include/Search/literalmatcher.h"
+#include "include/Search/multitermmatcher.h"
+#include "include/Search/regexliterals.h"
+#include "include/Search/regexprefilter.h"
+#include "include/Search/trigramindex.h"
+#include "include/Search/utf8search.h"
 #include "nqqsettings.cpp"
 #include "notepadqq.cpp"
 
+using EditorNS::TextTransform;
+using EditorNS::LineDiff;
+
+namespace {
+
+    QString hunksToString(const QVector<LineDiff::Hunk> &hunks)
+    {
+        QStringList out;
+        for (const LineDiff::Hunk &h : hunks) {
+            out.append(QString("%1,%2>%3,%4").arg(h.fromA).arg(h.countA).arg(h.fromB).arg(h.countB));
+        }
+        return out.join(' ');
+    }
+
+    bool writeFile(const QString &path, const QByteArray &contents)
+    {
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(contents) == contents.size();
+    }
+
+    void updateIndex(TrigramIndex &index, const QString &path, const QByteArray &contents)
+    {
+        const QFileInfo info(path);
+        index.update(path, info.lastModified().toMSecsSinceEpoch(), info.size(), contents.constData(), contents.size());
+    }
+
+}
+
 class NotepadqqTest : public QObject
 {
     Q_OBJECT
@@ -12,7 +49,46 @@ public:
     NotepadqqTest();
 
 private Q_SLOTS:
+    void initTestCase();
+
     void editorPathIsHtml();
+
+    void tabToSpaceStopsAtTabStops();
+    void spaceToTabStopsAtTabStops();
+    void spaceToTabLeadingKeepsInnerSpaces();
+    void trimSpace();
+    void transformPatchesOnlyChangedLines();
+    void eolToSpaceJoinsLines();
+
+    void diffOfEqualTexts();
+    void diffInsertionsAndDeletions();
+    void diffReplacements();
+    void diffRepeatedLines();
+
+    void utf8Payload();
+    void utf8SearchCountsUtf16Offsets();
+    void utf8SearchMatchesWholeWords();
+    void utf8SearchRejectsNonAsciiFolding();
+
+    void literalMatcherFindsEveryPosition();
+    void literalMatcherFoldsAsciiCase();
+    void literalMatcherSkipsHalfCodeUnits();
+
+    void multiTermFirstThenLongest();
+    void multiTermFoldsCase();
+    void multiTermShorterMatch();
+
+    void regexLiteralsRequired();
+    void trigramIndexSkipsFilesThatCantMatch();
+    void trigramIndexReindexesChangedFiles();
+
+    void regexLiteralsSingleLine();
+    void regexPrefilterRulesOutText();
+    void regexPrefilterFoldsCase();
+    void regexPrefilterNarrowsToLines();
+
+    void lineCounterEndsLinesAtEveryBreak();
+    void lineCounterCountsAcrossBlocks();
 };
 
 NotepadqqTest::NotepadqqTest()
@@ -20,11 +96,530 @@ NotepadqqTest::NotepadqqTest()
     //QApplication a();
 }
 
+void NotepadqqTest::initTestCase()
+{
+    // The search indexes are saved next to the settings
+    QStandardPaths::setTestModeEnabled(true);
+}
+
 void NotepadqqTest::editorPathIsHtml()
 {
     QVERIFY(Notepadqq::editorPath().endsWith(".html"));
 }
 
+void NotepadqqTest::tabToSpaceStopsAtTabStops()
+{
+    QCOMPARE(TextTransform::transformLine("\tx", TextTransform::TabToSpace, 4), QString("    x"));
+    QCOMPARE(TextTransform::transformLine("a\tb", TextTransform::TabToSpace, 4), QString("a   b"));
+    QCOMPARE(TextTransform::transformLine("abcd\te", TextTransform::TabToSpace, 4), QString("abcd    e"));
+    QCOMPARE(TextTransform::transformLine("a\t\tb", TextTransform::TabToSpace, 2), QString("a   b"));
+    QCOMPARE(TextTransform::transformLine("no tabs", TextTransform::TabToSpace, 4), QString("no tabs"));
+}
+
+void NotepadqqTest::spaceToTabStopsAtTabStops()
+{
+    QCOMPARE(TextTransform::transformLine("    x", TextTransform::SpaceToTabAll, 4), QString("\tx"));
+    QCOMPARE(TextTransform::transformLine("ab  c", TextTransform::SpaceToTabAll, 4), QString("ab\tc"));
+    QCOMPARE(TextTransform::transformLine("ab   c", TextTransform::SpaceToTabAll, 4), QString("ab\t c"));
+    QCOMPARE(TextTransform::transformLine("          x", TextTransform::SpaceToTabAll, 4), QString("\t\t  x"));
+    // Not enough spaces to reach the next tab stop
+    QCOMPARE(TextTransform::transformLine("a b", TextTransform::SpaceToTabAll, 4), QString("a b"));
+}
+
+void NotepadqqTest::spaceToTabLeadingKeepsInnerSpaces()
+{
+    QCOMPARE(TextTransform::transformLine("        a    b", TextTransform::SpaceToTabLeading, 4),
+             QString("\t\ta    b"));
+    QCOMPARE(TextTransform::transformLine("a    b", TextTransform::SpaceToTabLeading, 4), QString("a    b"));
+}
+
+void NotepadqqTest::trimSpace()
+{
+    QCOMPARE(TextTransform::transformLine(" \ta b \t", TextTransform::TrimTrailingSpace, 4), QString(" \ta b"));
+    QCOMPARE(TextTransform::transformLine(" \ta b \t", TextTransform::TrimLeadingSpace, 4), QString("a b \t"));
+    QCOMPARE(TextTransform::transformLine(" \ta b \t", TextTransform::TrimLeadingTrailingSpace, 4), QString("a b"));
+}
+
+void NotepadqqTest::transformPatchesOnlyChangedLines()
+{
+    const QStringList lines = QStringList() << "a " << "b " << "c" << "d " << "e";
+    const QList<TextTransform::Patch> patches =
+            TextTransform::apply(lines, TextTransform::TrimTrailingSpace, 4);
+
+    QCOMPARE(patches.size(), 2);
+    QCOMPARE(patches.at(0).fromLine, 0);
+    QCOMPARE(patches.at(0).toLine, 2);
+    QCOMPARE(patches.at(0).lines, QStringList() << "a" << "b");
+    QCOMPARE(patches.at(1).fromLine, 3);
+    QCOMPARE(patches.at(1).toLine, 4);
+    QCOMPARE(patches.at(1).lines, QStringList() << "d");
+
+    QVERIFY(TextTransform::apply(lines, TextTransform::TabToSpace, 4).isEmpty());
+}
+
+void NotepadqqTest::eolToSpaceJoinsLines()
+{
+    const QList<TextTransform::Patch> patches =
+            TextTransform::apply(QStringList() << "a" << "b" << "c", TextTransform::EolToSpace, 4);
+
+    QCOMPARE(patches.size(), 1);
+    QCOMPARE(patches.at(0).fromLine, 0);
+    QCOMPARE(patches.at(0).toLine, 3);
+    QCOMPARE(patches.at(0).lines, QStringList() << "a b c");
+
+    QVERIFY(TextTransform::apply(QStringList() << "a", TextTransform::EolToSpace, 4).isEmpty());
+}
+
+void NotepadqqTest::diffOfEqualTexts()
+{
+    QVERIFY(LineDiff::compute(QString("a\nb\nc"), QString("a\nb\nc")).isEmpty());
+    QVERIFY(LineDiff::compute(QString(""), QString("")).isEmpty());
+}
+
+void NotepadqqTest::diffInsertionsAndDeletions()
+{
+    QCOMPARE(hunksToString(LineDiff::compute(QString("x\ny\nz"), QString("x\nq\ny\nz\n"))),
+             QString("1,0>1,1 3,0>4,1"));
+    QCOMPARE(hunksToString(LineDiff::compute(QString("x\nq\ny\nz\n"), QString("x\ny\nz"))),
+             QString("1,1>1,0 4,1>3,0"));
+    QCOMPARE(hunksToString(LineDiff::compute(QString(""), QString("a\nb"))), QString("0,1>0,2"));
+}
+
+void NotepadqqTest::diffReplacements()
+{
+    QCOMPARE(hunksToString(LineDiff::compute(QString("a\nb\nc\nd"), QString("a\nB\nC\nd"))),
+             QString("1,2>1,2"));
+    QCOMPARE(hunksToString(LineDiff::compute(QString("a\nb\nc"), QString("c\nb\na"))),
+             QString("0,2>0,0 3,0>1,2"));
+}
+
+void NotepadqqTest::diffRepeatedLines()
+{
+    // No line is rare enough to split the region around
+    QVector<int> a, b;
+    a << 1;
+    b << 2;
+    for (int i = 0; i < 200; i++) {
+        a << 0;
+        b << 0;
+        if (i == 99)
+            b << 3;
+    }
+    a << 4;
+    b << 5;
+
+    QCOMPARE(hunksToString(LineDiff::compute(a, b)), QString("0,1>0,1 101,0>101,1 201,1>202,1"));
+}
+
+void NotepadqqTest::utf8Payload()
+{
+    QCOMPARE(Utf8Search::utf8Payload("abc", 3), 0);
+    QCOMPARE(Utf8Search::utf8Payload("\xEF\xBB\xBF" "abc", 6), 3);
+    QCOMPARE(Utf8Search::utf8Payload("a\xC3\xA9" "b", 4), 0);
+    QCOMPARE(Utf8Search::utf8Payload("\xFF\xFE" "a\0", 4), -1);
+    QCOMPARE(Utf8Search::utf8Payload("a\xC3(b", 4), -1);
+}
+
+void NotepadqqTest::utf8SearchCountsUtf16Offsets()
+{
+    // The emoji is a surrogate pair in UTF-16
+    const QByteArray text("\xF0\x9F\x98\x80 FOO\r\nbar foo\rfoo");
+    DocResult doc;
+
+    QVERIFY(Utf8Search("foo", false, false).search(text.constData(), text.size(), doc));
+    QCOMPARE(doc.results.size(), 3);
+
+    QCOMPARE(doc.results.at(0).lineNumber, 1);
+    QCOMPARE(doc.results.at(0).positionInFile, 3);
+    QCOMPARE(doc.results.at(0).positionInLine, 3);
+    QCOMPARE(doc.results.at(0).matchLength, 3);
+    QCOMPARE(doc.getLineString(doc.results.at(0)), QString::fromUtf8("\xF0\x9F\x98\x80 FOO"));
+    QCOMPARE(doc.getMatchString(doc.results.at(0)), QString("FOO"));
+
+    QCOMPARE(doc.results.at(1).lineNumber, 2);
+    QCOMPARE(doc.results.at(1).positionInFile, 12);
+    QCOMPARE(doc.results.at(1).positionInLine, 4);
+
+    QCOMPARE(doc.results.at(2).lineNumber, 3);
+    QCOMPARE(doc.results.at(2).positionInFile, 16);
+    QCOMPARE(doc.results.at(2).positionInLine, 0);
+
+    DocResult caseSensitive;
+    QVERIFY(Utf8Search("FOO", true, false).search(text.constData(), text.size(), caseSensitive));
+    QCOMPARE(caseSensitive.results.size(), 1);
+}
+
+void NotepadqqTest::utf8SearchMatchesWholeWords()
+{
+    const QByteArray text("foobar foo.xfoo \xC3\xA9" "foo");
+    DocResult doc;
+
+    QVERIFY(Utf8Search("foo", true, true).search(text.constData(), text.size(), doc));
+    QCOMPARE(doc.results.size(), 1);
+    QCOMPARE(doc.results.at(0).positionInFile, 7);
+}
+
+void NotepadqqTest::utf8SearchRejectsNonAsciiFolding()
+{
+    // The Kelvin sign folds to 'k' and the long s to 's'
+    const QByteArray kelvin("1 \xE2\x84\xAA");
+    const QByteArray longS("\xC5\xBF" "ome");
+    DocResult doc;
+
+    QVERIFY(!Utf8Search("k", false, false).search(kelvin.constData(), kelvin.size(), doc));
+    QVERIFY(!Utf8Search("some", false, false).search(longS.constData(), longS.size(), doc));
+
+    // Nothing to fold when the case matters, or when the needle can't be folded to
+    QVERIFY(Utf8Search("k", true, false).search(kelvin.constData(), kelvin.size(), doc));
+    QVERIFY(Utf8Search("1", false, false).search(kelvin.constData(), kelvin.size(), doc));
+
+    // Non-ASCII needles can't be searched as bytes without matching the case
+    QVERIFY(!Utf8Search(QString::fromUtf8("\xC3\xA9"), false, false).isValid());
+    QVERIFY(Utf8Search(QString::fromUtf8("\xC3\xA9"), true, false).isValid());
+}
+
+void NotepadqqTest::literalMatcherFindsEveryPosition()
+{
+    // Across the 16 and 32 byte blocks of the vectorized implementations
+    const LiteralMatcher bytes(QByteArray("needle"), true);
+    const LiteralMatcher chars(QString("needle"), true);
+
+    for (int size = 6; size <= 100; size++) {
+        for (int pos = 0; pos + 6 <= size; pos++) {
+            QByteArray text(size, 'e');
+            text.replace(pos, 6, "needle");
+            const QString string = QString::fromLatin1(text);
+
+            QCOMPARE(bytes.indexIn(text.constData(), text.size()), pos);
+            QCOMPARE(chars.indexIn(string), pos);
+            QCOMPARE(bytes.indexIn(text.constData(), text.size(), pos + 1), -1);
+            QCOMPARE(chars.indexIn(string, pos + 1), -1);
+        }
+    }
+
+    QCOMPARE(bytes.indexIn("needl", 5), -1);
+}
+
+void NotepadqqTest::literalMatcherFoldsAsciiCase()
+{
+    const QByteArray text("Hello World, hello world");
+
+    const LiteralMatcher insensitive(QByteArray("WORLD"), false);
+    QCOMPARE(insensitive.indexIn(text.constData(), text.size()), 6);
+    QCOMPARE(insensitive.indexIn(text.constData(), text.size(), 7), 19);
+
+    const LiteralMatcher sensitive(QByteArray("world"), true);
+    QCOMPARE(sensitive.indexIn(text.constData(), text.size()), 19);
+
+    QCOMPARE(LiteralMatcher(QString("hELLO"), false).indexIn(QString(text), 1), 13);
+
+    // Only letters are folded: '@' is 0x40, '`' is 0x60
+    QCOMPARE(LiteralMatcher(QByteArray("`"), false).indexIn("@", 1), -1);
+}
+
+void NotepadqqTest::literalMatcherSkipsHalfCodeUnits()
+{
+    // The bytes of "ab", one byte into the text
+    const QString needle("ab");
+    QByteArray bytes(1, 'x');
+    bytes.append(reinterpret_cast<const char*>(needle.utf16()), 4);
+    bytes.append('x');
+    const QString text = QString::fromUtf16(reinterpret_cast<const ushort*>(bytes.constData()), 3);
+
+    QCOMPARE(LiteralMatcher(needle, true).indexIn(text), -1);
+    QCOMPARE(LiteralMatcher(needle, true).indexIn(text + needle), 3);
+}
+
+void NotepadqqTest::multiTermFirstThenLongest()
+{
+    const MultiTermMatcher matcher(QStringList() << "bc" << "abcd" << "abc" << "x", true);
+    const QString text("zabcdxbc");
+
+    MultiTermMatcher::Match match = matcher.indexIn(text);
+    QCOMPARE(match.position, 1);
+    QCOMPARE(match.length, 4);
+    QCOMPARE(match.term, 1);
+
+    match = matcher.indexIn(text, match.position + match.length);
+    QCOMPARE(match.position, 5);
+    QCOMPARE(match.term, 3);
+
+    match = matcher.indexIn(text, match.position + match.length);
+    QCOMPARE(match.position, 6);
+    QCOMPARE(match.term, 0);
+
+    QCOMPARE(matcher.indexIn(text, 8).position, -1);
+
+    // "she" starts before "he" and "hers"
+    match = MultiTermMatcher(QStringList() << "he" << "she" << "hers", true).indexIn("ushers");
+    QCOMPARE(match.position, 1);
+    QCOMPARE(match.term, 1);
+
+    QVERIFY(MultiTermMatcher(QStringList() << "", true).isEmpty());
+}
+
+void NotepadqqTest::multiTermFoldsCase()
+{
+    const MultiTermMatcher matcher(QStringList() << "Foo" << QString::fromUtf8("\xC3\x89T\xC3\x89"), false);
+    const QString text = QString::fromUtf8("fOO \xC3\xA9t\xC3\xA9");
+
+    QCOMPARE(matcher.indexIn(text).term, 0);
+    QCOMPARE(matcher.indexIn(text, 1).position, 4);
+    QCOMPARE(matcher.indexIn(text, 1).term, 1);
+    QCOMPARE(MultiTermMatcher(QStringList() << "Foo", true).indexIn(text).position, -1);
+
+    // Same folding as QString::indexOf(): the Kelvin sign is a 'k'
+    QCOMPARE(MultiTermMatcher(QStringList() << "k", false).indexIn(QString(QChar(0x212A))).position, 0);
+}
+
+void NotepadqqTest::multiTermShorterMatch()
+{
+    const MultiTermMatcher matcher(QStringList() << "foo" << "fo" << "foobar", true);
+    const QString text("foobarx");
+
+    MultiTermMatcher::Match match = matcher.indexIn(text);
+    QCOMPARE(match.term, 2);
+
+    match = matcher.shorterMatch(text, match);
+    QCOMPARE(match.position, 0);
+    QCOMPARE(match.length, 3);
+    QCOMPARE(match.term, 0);
+
+    match = matcher.shorterMatch(text, match);
+    QCOMPARE(match.term, 1);
+
+    QCOMPARE(matcher.shorterMatch(text, match).position, -1);
+}
+
+void NotepadqqTest::regexLiteralsRequired()
+{
+    QCOMPARE(RegexLiterals::required("foo\\w+bar"), QStringList() << "foo" << "bar");
+    QCOMPARE(RegexLiterals::required("foo\\.bar"), QStringList() << "foo.bar");
+
+    // Quantifiers that allow no repetition drop what they apply to
+    QCOMPARE(RegexLiterals::required("ab?cd"), QStringList() << "a" << "cd");
+    QCOMPARE(RegexLiterals::required("abc*d"), QStringList() << "ab" << "d");
+    QCOMPARE(RegexLiterals::required("a{0,3}bcd"), QStringList() << "bcd");
+    QCOMPARE(RegexLiterals::required("(abc)?xyz"), QStringList() << "xyz");
+
+    // Alternations
+    QVERIFY(RegexLiterals::required("foo|bar").isEmpty());
+    QCOMPARE(RegexLiterals::required("(foo|bar)baz"), QStringList() << "baz");
+
+    // Quoted text is taken as it is
+    QCOMPARE(RegexLiterals::required("\\Qa.b*c\\E"), QStringList() << "a.b*c");
+    QCOMPARE(RegexLiterals::required("x\\Qa|b\\Ey"), QStringList() << "xa|by");
+}
+
+void NotepadqqTest::trigramIndexSkipsFilesThatCantMatch()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.path() + "/a.txt";
+    const QByteArray contents("Hello World");
+    QVERIFY(writeFile(path, contents));
+
+    std::shared_ptr<TrigramIndex> index = TrigramIndex::forDirectory(dir.path());
+    auto status = [&](const TrigramIndex::Query& query) {
+        return index->check(path, QFileInfo(path), index->match(query));
+    };
+
+    const TrigramIndex::Query world = TrigramIndex::literalQuery(QStringList("world"), false);
+    const TrigramIndex::Query absent = TrigramIndex::literalQuery(QStringList("absent"), false);
+
+    QCOMPARE(status(world), TrigramIndex::FileStatus::Reindex);
+
+    updateIndex(*index, path, contents);
+    QCOMPARE(status(world), TrigramIndex::FileStatus::Search);
+    QCOMPARE(status(absent), TrigramIndex::FileStatus::Skip);
+    QCOMPARE(status(TrigramIndex::literalQuery(QStringList() << "absent" << "hello", false)),
+             TrigramIndex::FileStatus::Search);
+    QCOMPARE(status(TrigramIndex::regexQuery("hel+o\\s+absent")), TrigramIndex::FileStatus::Skip);
+    QCOMPARE(status(TrigramIndex::regexQuery("wor.d")), TrigramIndex::FileStatus::Search);
+
+    // Shorter than a trigram
+    QVERIFY(TrigramIndex::literalQuery(QStringList("ab"), false).matchesAll());
+    QCOMPARE(status(TrigramIndex::literalQuery(QStringList("ab"), false)), TrigramIndex::FileStatus::Search);
+
+    // Files that can't be indexed are searched every time
+    const QFileInfo info(path);
+    index->update(path, info.lastModified().toMSecsSinceEpoch(), info.size(), nullptr, 0);
+    QCOMPARE(status(absent), TrigramIndex::FileStatus::Search);
+
+    QVERIFY(index->save());
+}
+
+void NotepadqqTest::trigramIndexReindexesChangedFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.path() + "/a.txt";
+    QVERIFY(writeFile(path, "hello world"));
+
+    std::shared_ptr<TrigramIndex> index = TrigramIndex::forDirectory(dir.path());
+    const TrigramIndex::Query absent = TrigramIndex::literalQuery(QStringList("absent"), true);
+    auto status = [&]() {
+        return index->check(path, QFileInfo(path), index->match(absent));
+    };
+
+    updateIndex(*index, path, "hello world");
+    QCOMPARE(status(), TrigramIndex::FileStatus::Skip);
+
+    // Reported by the file watcher
+    TrigramIndex::invalidate(path);
+    QCOMPARE(status(), TrigramIndex::FileStatus::Reindex);
+    updateIndex(*index, path, "hello world");
+    QCOMPARE(status(), TrigramIndex::FileStatus::Skip);
+
+    // Another modification time
+    const QFileInfo info(path);
+    index->update(path, info.lastModified().toMSecsSinceEpoch() - 2000, info.size(), "hello world", 11);
+    QCOMPARE(status(), TrigramIndex::FileStatus::Reindex);
+    updateIndex(*index, path, "hello world");
+    QCOMPARE(status(), TrigramIndex::FileStatus::Skip);
+
+    // Another size
+    QVERIFY(writeFile(path, "hello absent world"));
+    QCOMPARE(status(), TrigramIndex::FileStatus::Reindex);
+    updateIndex(*index, path, "hello absent world");
+    QCOMPARE(status(), TrigramIndex::FileStatus::Search);
+
+    QCOMPARE(index->relativePath(path), QString("a.txt"));
+}
+
+void NotepadqqTest::regexLiteralsSingleLine()
+{
+    QVERIFY(RegexLiterals::singleLine("foo\\w+bar"));
+    QVERIFY(RegexLiterals::singleLine("a.*b"));
+    QVERIFY(RegexLiterals::singleLine("^[a-z]+\\d$"));
+
+    QVERIFY(!RegexLiterals::singleLine("a\\sb"));
+    QVERIFY(!RegexLiterals::singleLine("a\\nb"));
+    QVERIFY(!RegexLiterals::singleLine("a[^x]b"));
+}
+
+void NotepadqqTest::regexPrefilterRulesOutText()
+{
+    const RegexPrefilter prefilter(QRegularExpression("foo\\w+bar"));
+    QVERIFY(!prefilter.isEmpty());
+
+    QVERIFY(prefilter.canMatch("a foo_bar", 9));
+    QVERIFY(!prefilter.canMatch("a foo_baz", 9));
+    QVERIFY(prefilter.appliesTo("a foo_bar"));
+    QVERIFY(prefilter.canMatch(QString("a foo_bar")));
+    QVERIFY(!prefilter.canMatch(QString("a FOO_BAR")));
+
+    // Nothing every match has to contain
+    const RegexPrefilter alternation(QRegularExpression("foo|bar"));
+    QVERIFY(alternation.isEmpty());
+    QVERIFY(alternation.canMatch("", 0));
+    QVERIFY(!alternation.appliesTo(""));
+}
+
+void NotepadqqTest::regexPrefilterFoldsCase()
+{
+    QVERIFY(RegexPrefilter(QRegularExpression("FOO\\d", QRegularExpression::CaseInsensitiveOption))
+            .canMatch("foo1", 4));
+    QVERIFY(RegexPrefilter(QRegularExpression("(?i)FOO\\d")).canMatch("foo1", 4));
+    QVERIFY(!RegexPrefilter(QRegularExpression("FOO\\d")).canMatch("foo1", 4));
+
+    // The Kelvin sign matches 'k' and the long s matches 's' in case-insensitive regexes
+    const RegexPrefilter kelvin(QRegularExpression("kelvin", QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(!kelvin.canMatch("Celsius", 7));
+    QVERIFY(kelvin.canMatch("\xE2\x84\xAA" "elvin", 8));
+    QVERIFY(!kelvin.appliesTo(QString(QChar(0x212A)) + "elvin"));
+
+    const RegexPrefilter longS(QRegularExpression("sum", QRegularExpression::CaseInsensitiveOption));
+    QVERIFY(longS.canMatch("\xC5\xBF" "um", 4));
+    QVERIFY(!longS.appliesTo(QString(QChar(0x017F)) + "um"));
+}
+
+void NotepadqqTest::regexPrefilterNarrowsToLines()
+{
+    const QString text("first line\nsay needle7 twice needle8\r\nlast line");
+    const int lineStart = text.indexOf("say");
+    const int lineEnd = text.indexOf("last");
+    int end;
+
+    const RegexPrefilter lines(QRegularExpression("needle\\d", QRegularExpression::MultilineOption));
+    QCOMPARE(lines.nextRegion(text, 0, end), lineStart);
+    QCOMPARE(end, lineEnd);
+    QCOMPARE(lines.nextRegion(text, lineStart + 5, end), lineStart + 5);
+    QCOMPARE(end, lineEnd);
+    QCOMPARE(lines.nextRegion(text, lineEnd, end), -1);
+
+    // Matches may span lines
+    const RegexPrefilter spanning(QRegularExpression("needle\\s\\d", QRegularExpression::MultilineOption));
+    QCOMPARE(spanning.nextRegion(text, 3, end), 3);
+    QCOMPARE(end, text.size());
+
+    const RegexPrefilter dotAll(QRegularExpression("needle.", QRegularExpression::MultilineOption |
+                                                              QRegularExpression::DotMatchesEverythingOption));
+    QCOMPARE(dotAll.nextRegion(text, 3, end), 3);
+    QCOMPARE(end, text.size());
+}
+
+void NotepadqqTest::lineCounterEndsLinesAtEveryBreak()
+{
+    const QString text("one\r\ntwo\rthree\nfour");
+    LineCounter counter(text);
+
+    counter.moveTo(1);
+    QCOMPARE(counter.line(), 1);
+    QCOMPARE(counter.lineStart(), 0);
+    QCOMPARE(counter.lineEnd(), 3);
+
+    // Between the '\r' and the '\n'
+    counter.moveTo(4);
+    QCOMPARE(counter.line(), 1);
+
+    counter.moveTo(text.indexOf("two"));
+    QCOMPARE(counter.line(), 2);
+    QCOMPARE(counter.lineStart(), 5);
+    QCOMPARE(counter.lineEnd(), 8);
+
+    counter.moveTo(text.indexOf("three") + 2);
+    QCOMPARE(counter.line(), 3);
+    QCOMPARE(counter.lineStart(), 9);
+    QCOMPARE(counter.lineEnd(), 14);
+
+    counter.moveTo(text.size());
+    QCOMPARE(counter.line(), 4);
+    QCOMPARE(counter.lineStart(), 15);
+    QCOMPARE(counter.lineEnd(), text.size());
+
+    // Positions before the current one are ignored
+    counter.moveTo(0);
+    QCOMPARE(counter.line(), 4);
+}
+
+void NotepadqqTest::lineCounterCountsAcrossBlocks()
+{
+    // Line breaks at every offset of the 16 character blocks, and "\r\n" split between two of them
+    for (int offset = 0; offset < 40; offset++) {
+        const QString text = QString(offset, 'x') + "\r\n" + QString(offset, 'y') + "\n\r" + QString(40, 'z');
+        const int y = offset + 2;
+        const int z = 2 * offset + 4;
+
+        LineCounter counter(text);
+        counter.moveTo(y);
+        QCOMPARE(counter.line(), 2);
+        QCOMPARE(counter.lineStart(), y);
+        QCOMPARE(counter.lineEnd(), y + offset);
+
+        counter.moveTo(z);
+        QCOMPARE(counter.line(), 4);
+        QCOMPARE(counter.lineStart(), z);
+
+        LineCounter skipping(text);
+        skipping.moveTo(text.size());
+        QCOMPARE(skipping.line(), 4);
+        QCOMPARE(skipping.lineStart(), z);
+    }
+}
+
 QTEST_GUILESS_MAIN(NotepadqqTest)
 
 #include "tst_notepadqqtest.moc"
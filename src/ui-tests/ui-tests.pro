@@ -3,7 +3,7 @@
 ######################################################################
 
 QT += testlib
-QT += core gui svg widgets printsupport network webenginewidgets webchannel websockets
+QT += core gui svg widgets printsupport network webenginewidgets webchannel websockets concurrent
 CONFIG += c++11
 TEMPLATE = app
 TARGET = ui-tests
@@ -12,4 +12,15 @@ INCLUDEPATH += ../ui/
 include(../ui/libs/qtpromise/qtpromise.pri)
 
 # Input
-SOURCES += tst_notepadqqtest.cpp
+SOURCES += tst_notepadqqtest.cpp \
+    ../ui/EditorNS/texttransform.cpp \
+    ../ui/EditorNS/linediff.cpp \
+    ../ui/Search/linecounter.cpp \
+    ../ui/Search/literalmatcher.cpp \
+    ../ui/Search/multitermmatcher.cpp \
+    ../ui/Search/regexliterals.cpp \
+    ../ui/Search/regexprefilter.cpp \
+    ../ui/Search/searchobjects.cpp \
+    ../ui/Search/trigramindex.cpp \
+    ../ui/Search/utf8search.cpp \
+    ../ui/Sessions/persistentcache.cpp
@@ -0,0 +1,174 @@
+#include "include/EditorNS/bridgestatistics.h"
+
+#include <QJsonArray>
+#include <QStringList>
+#include <QtMath>
+
+namespace EditorNS
+{
+
+    const int BridgeStatistics::HISTOGRAM_BUCKETS = 14;
+
+    qint64 BridgeStatistics::Entry::averageLatency() const
+    {
+        return replies == 0 ? 0 : totalLatency / replies;
+    }
+
+    qint64 BridgeStatistics::Entry::latencyPercentile(double fraction) const
+    {
+        const int wanted = qCeil(replies * fraction);
+        int seen = 0;
+
+        for (int i = 0; i < histogram.size(); i++) {
+            seen += histogram[i];
+            if (seen >= wanted && seen > 0)
+                return qint64(1) << i;
+        }
+
+        return 0;
+    }
+
+    BridgeStatistics::BridgeStatistics()
+    {
+        m_clock.start();
+    }
+
+    BridgeStatistics &BridgeStatistics::getInstance()
+    {
+        static BridgeStatistics instance;
+        return instance;
+    }
+
+    qint64 BridgeStatistics::now() const
+    {
+        return m_clock.nsecsElapsed() / 1000;
+    }
+
+    void BridgeStatistics::recordRequest(const QString &message, const QVariant &data, bool sync)
+    {
+        Entry &entry = m_entries[message];
+        entry.requests++;
+        entry.requestBytes += estimateSize(data);
+
+        if (sync) {
+            entry.syncRequests++;
+            if (m_blockingDepth > 0) {
+                entry.nestedRequests++;
+            }
+        }
+    }
+
+    void BridgeStatistics::recordReply(const QString &message, const QVariant &data, qint64 latency)
+    {
+        Entry &entry = m_entries[message];
+        entry.replies++;
+        entry.replyBytes += estimateSize(data);
+        entry.totalLatency += latency;
+        entry.maxLatency = qMax(entry.maxLatency, latency);
+        entry.histogram[bucketFor(latency)]++;
+    }
+
+    void BridgeStatistics::beginBlockingWait()
+    {
+        m_blockingDepth++;
+    }
+
+    void BridgeStatistics::endBlockingWait(const QString &message, qint64 blockedTime)
+    {
+        m_blockingDepth--;
+        m_entries[message].blockedTime += blockedTime;
+    }
+
+    const QMap<QString, BridgeStatistics::Entry> &BridgeStatistics::entries() const
+    {
+        return m_entries;
+    }
+
+    void BridgeStatistics::reset()
+    {
+        m_entries.clear();
+    }
+
+    QJsonObject BridgeStatistics::toJson() const
+    {
+        QJsonObject messages;
+
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            const Entry &e = it.value();
+
+            QJsonArray histogram;
+            for (int count : e.histogram) {
+                histogram.append(count);
+            }
+
+            QJsonObject obj;
+            obj["requests"] = e.requests;
+            obj["replies"] = e.replies;
+            obj["syncRequests"] = e.syncRequests;
+            obj["nestedRequests"] = e.nestedRequests;
+            obj["requestBytes"] = e.requestBytes;
+            obj["replyBytes"] = e.replyBytes;
+            obj["averageLatencyUsec"] = e.averageLatency();
+            obj["maxLatencyUsec"] = e.maxLatency;
+            obj["blockedUsec"] = e.blockedTime;
+            obj["latencyHistogramMsec"] = histogram;
+            messages[it.key()] = obj;
+        }
+
+        QJsonObject out;
+        out["histogramBuckets"] = QJsonArray::fromStringList(
+                    QStringList() << "<1" << "<2" << "<4" << "<8" << "<16" << "<32" << "<64" << "<128"
+                                  << "<256" << "<512" << "<1024" << "<2048" << "<4096" << ">=4096");
+        out["messages"] = messages;
+        return out;
+    }
+
+    qint64 BridgeStatistics::estimateSize(const QVariant &data)
+    {
+        switch (data.type()) {
+        case QVariant::Invalid:
+            return 0;
+        case QVariant::String:
+            return data.toString().size() * 2;
+        case QVariant::ByteArray:
+            return data.toByteArray().size();
+        case QVariant::StringList: {
+            qint64 size = 0;
+            for (const QString &s : data.toStringList()) {
+                size += s.size() * 2;
+            }
+            return size;
+        }
+        case QVariant::List: {
+            qint64 size = 0;
+            for (const QVariant &v : data.toList()) {
+                size += estimateSize(v);
+            }
+            return size;
+        }
+        case QVariant::Map: {
+            const QVariantMap map = data.toMap();
+            qint64 size = 0;
+            for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+                size += it.key().size() * 2 + estimateSize(it.value());
+            }
+            return size;
+        }
+        default:
+            return 8;
+        }
+    }
+
+    int BridgeStatistics::bucketFor(qint64 latency)
+    {
+        const qint64 msec = latency / 1000;
+        int bucket = 0;
+
+        while (bucket < HISTOGRAM_BUCKETS - 1 && (qint64(1) << bucket) <= msec) {
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+}
@@ -0,0 +1,81 @@
+#include "include/EditorNS/bulktransferschemehandler.h"
+
+#include <QApplication>
+#include <QBuffer>
+#include <QWebEngineProfile>
+#include <QWebEngineUrlRequestJob>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QWebEngineUrlScheme>
+#endif
+
+namespace EditorNS
+{
+
+    const QByteArray BulkTransferSchemeHandler::SCHEME_NAME = "nqq-bulk";
+
+    BulkTransferSchemeHandler::BulkTransferSchemeHandler(QObject *parent) :
+        QWebEngineUrlSchemeHandler(parent)
+    {
+    }
+
+    BulkTransferSchemeHandler& BulkTransferSchemeHandler::getInstance()
+    {
+        static BulkTransferSchemeHandler *instance = nullptr;
+
+        if (instance == nullptr) {
+            instance = new BulkTransferSchemeHandler(qApp);
+            QWebEngineProfile::defaultProfile()->installUrlSchemeHandler(SCHEME_NAME, instance);
+        }
+
+        return *instance;
+    }
+
+    void BulkTransferSchemeHandler::registerUrlScheme()
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        QWebEngineUrlScheme scheme(SCHEME_NAME);
+        scheme.setSyntax(QWebEngineUrlScheme::Syntax::Path);
+        QWebEngineUrlScheme::Flags flags = QWebEngineUrlScheme::LocalScheme | QWebEngineUrlScheme::LocalAccessAllowed;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        flags |= QWebEngineUrlScheme::CorsEnabled;
+#endif
+        scheme.setFlags(flags);
+        QWebEngineUrlScheme::registerScheme(scheme);
+#endif
+    }
+
+    QUrl BulkTransferSchemeHandler::publish(const QByteArray &data)
+    {
+        const QString id = QString::number(++m_lastId);
+        m_payloads.insert(id, data);
+
+        QUrl handle;
+        handle.setScheme(QString::fromLatin1(SCHEME_NAME));
+        handle.setPath(id);
+        return handle;
+    }
+
+    void BulkTransferSchemeHandler::revoke(const QUrl &handle)
+    {
+        m_payloads.remove(handle.path());
+    }
+
+    void BulkTransferSchemeHandler::requestStarted(QWebEngineUrlRequestJob *job)
+    {
+        auto it = m_payloads.find(job->requestUrl().path());
+        if (it == m_payloads.end()) {
+            job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+            return;
+        }
+
+        // The buffer is owned by the job, so it lives exactly as long as the request.
+        QBuffer *buffer = new QBuffer(job);
+        buffer->setData(it.value());
+        buffer->open(QIODevice::ReadOnly);
+        m_payloads.erase(it);
+
+        job->reply("text/plain;charset=utf-8", buffer);
+    }
+
+}
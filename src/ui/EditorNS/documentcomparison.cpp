@@ -0,0 +1,119 @@
+#include "include/EditorNS/documentcomparison.h"
+
+#include "include/EditorNS/editor.h"
+
+#include <QVariant>
+#include <QtConcurrent>
+
+namespace EditorNS
+{
+
+    DocumentComparison::DocumentComparison(Editor *editor, Editor *other, QObject *parent) :
+        QObject(parent),
+        m_editor(editor),
+        m_other(other)
+    {
+        connect(&m_watcher, &QFutureWatcher<QVector<LineDiff::Hunk>>::finished,
+                this, &DocumentComparison::onDiffFinished);
+
+        for (Editor *e : {editor, other}) {
+            connect(e, &QObject::destroyed, this, [this]() {
+                finish(false, 0);
+            });
+        }
+    }
+
+    DocumentComparison::~DocumentComparison()
+    {
+        // The worker only uses its own copy of the texts, but still has to
+        // be done before the watcher goes away.
+        m_watcher.waitForFinished();
+    }
+
+    void DocumentComparison::start()
+    {
+        m_pendingTexts = 2;
+
+        QPointer<DocumentComparison> self(this);
+        m_editor->asyncSendMessageWithResultP("C_FUN_GET_VALUE").then([self](QVariant text) {
+            if (self) {
+                self->m_text = text.toString();
+                self->onTextReceived();
+            }
+        });
+        m_other->asyncSendMessageWithResultP("C_FUN_GET_VALUE").then([self](QVariant text) {
+            if (self) {
+                self->m_otherText = text.toString();
+                self->onTextReceived();
+            }
+        });
+    }
+
+    void DocumentComparison::clear(Editor *editor)
+    {
+        QVariantMap data;
+        data.insert("side", "a");
+        data.insert("hunks", QVariantList());
+        editor->asyncSendMessageWithResultP("C_CMD_SET_DIFF_HUNKS", data);
+    }
+
+    void DocumentComparison::onTextReceived()
+    {
+        if (--m_pendingTexts > 0 || m_finished)
+            return;
+
+        if (!m_editor || !m_other) {
+            finish(false, 0);
+            return;
+        }
+
+        const QString a = m_text;
+        const QString b = m_otherText;
+        m_text.clear();
+        m_otherText.clear();
+
+        m_watcher.setFuture(QtConcurrent::run([a, b]() {
+            return LineDiff::compute(a, b);
+        }));
+    }
+
+    void DocumentComparison::onDiffFinished()
+    {
+        if (m_finished)
+            return;
+
+        if (!m_editor || !m_other) {
+            finish(false, 0);
+            return;
+        }
+
+        const QVector<LineDiff::Hunk> hunks = m_watcher.result();
+
+        QVariantList encoded;
+        encoded.reserve(hunks.size() * 4);
+        for (const LineDiff::Hunk &hunk : hunks) {
+            encoded << hunk.fromA << hunk.countA << hunk.fromB << hunk.countB;
+        }
+
+        QVariantMap data;
+        data.insert("hunks", encoded);
+
+        data.insert("side", "a");
+        m_editor->asyncSendMessageWithResultP("C_CMD_SET_DIFF_HUNKS", data);
+        data.insert("side", "b");
+        m_other->asyncSendMessageWithResultP("C_CMD_SET_DIFF_HUNKS", data);
+
+        finish(true, hunks.size());
+    }
+
+    void DocumentComparison::finish(bool success, int hunkCount)
+    {
+        if (m_finished)
+            return;
+
+        m_finished = true;
+        emit finished(success, hunkCount);
+        deleteLater();
+    }
+
+}
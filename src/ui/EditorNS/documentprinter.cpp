@@ -0,0 +1,373 @@
+#include "include/EditorNS/documentprinter.h"
+
+#include "include/EditorNS/editor.h"
+
+#include <QFontMetricsF>
+#include <QStringList>
+
+namespace EditorNS
+{
+
+    // The colors of CodeMirror's default theme
+    static const QHash<QString, QColor> &tokenColors()
+    {
+        static const QHash<QString, QColor> colors {
+            {"keyword", QColor("#770088")},
+            {"atom", QColor("#221199")},
+            {"number", QColor("#116644")},
+            {"def", QColor("#0000ff")},
+            {"variable-2", QColor("#0055aa")},
+            {"variable-3", QColor("#008855")},
+            {"type", QColor("#008855")},
+            {"comment", QColor("#aa5500")},
+            {"string", QColor("#aa1111")},
+            {"string-2", QColor("#ff5500")},
+            {"meta", QColor("#555555")},
+            {"qualifier", QColor("#555555")},
+            {"builtin", QColor("#3300aa")},
+            {"bracket", QColor("#999977")},
+            {"tag", QColor("#117700")},
+            {"attribute", QColor("#0000cc")},
+            {"hr", QColor("#999999")},
+            {"link", QColor("#0000cc")},
+            {"header", QColor("#0000ff")},
+            {"quote", QColor("#009900")},
+            {"negative", QColor("#dd4444")},
+            {"positive", QColor("#229922")},
+            {"error", QColor("#ff0000")}
+        };
+        return colors;
+    }
+
+    PageWriter::PageWriter(std::shared_ptr<QPagedPaintDevice> device, int tabSize) :
+        m_device(device),
+        m_tabSize(qMax(1, tabSize))
+    {
+    }
+
+    void PageWriter::begin()
+    {
+        if (!m_painter.begin(m_device.get())) {
+            fail(tr("Unable to start printing."));
+            return;
+        }
+
+        m_font = QFont("Monospace", 9);
+        m_font.setStyleHint(QFont::TypeWriter);
+        m_painter.setFont(m_font);
+
+        // The metrics depend on the resolution of the device
+        const QFontMetricsF metrics(m_font, m_device.get());
+        m_charWidth = metrics.width('M');
+        m_lineHeight = metrics.lineSpacing();
+        m_ascent = metrics.ascent();
+        m_columns = qMax(1, int(m_device->width() / m_charWidth));
+        m_rowsPerPage = qMax(1, int(m_device->height() / m_lineHeight));
+        m_row = 0;
+
+        m_defaultStyle.font = m_font;
+        m_defaultStyle.color = Qt::black;
+        m_styles.clear();
+
+        m_ok = true;
+    }
+
+    void PageWriter::writeSlice(const QVariantMap &slice)
+    {
+        const QVariantList lines = slice.value("lines").toList();
+        const QVariantList styles = slice.value("styles").toList();
+
+        for (int i = 0; i < lines.size() && m_ok; i++) {
+            writeLine(lines[i].toString(), i < styles.size() ? styles[i].toList() : QVariantList());
+        }
+
+        emit sliceWritten();
+    }
+
+    void PageWriter::end()
+    {
+        if (!m_ok)
+            return;
+
+        m_ok = false;
+
+        if (!m_painter.end()) {
+            emit finished(false, tr("Unable to complete the printing."));
+            return;
+        }
+
+        emit finished(true, QString());
+    }
+
+    void PageWriter::writeLine(const QString &text, const QVariantList &styles)
+    {
+        // Expand the tabs, keeping track of where each token ends up.
+        // styles is a CodeMirror style array: [end, style, end, style, ...]
+        QString expanded;
+        expanded.reserve(text.size());
+        QVector<Span> spans;
+
+        int pos = 0;
+        for (int i = 0; i <= styles.size() - 2 || pos < text.size(); i += 2) {
+            const bool hasStyle = i <= styles.size() - 2;
+            const int end = hasStyle ? qBound(pos, styles[i].toInt(), text.size()) : text.size();
+            const Style *style = hasStyle ? styleFor(styles[i + 1].toString()) : &m_defaultStyle;
+            const int start = expanded.size();
+
+            for (; pos < end; pos++) {
+                const QChar c = text[pos];
+                if (c == '\t') {
+                    expanded.append(QString(m_tabSize - expanded.size() % m_tabSize, ' '));
+                } else {
+                    expanded.append(c);
+                }
+            }
+
+            if (expanded.size() > start) {
+                spans.append(Span{start, expanded.size(), style});
+            }
+        }
+
+        // Wrap at the width of the page. An empty line still takes a row.
+        int span = 0;
+        int rowStart = 0;
+        do {
+            if (!nextRow())
+                return;
+
+            const int rowEnd = qMin(rowStart + m_columns, expanded.size());
+            const qreal y = (m_row - 1) * m_lineHeight + m_ascent;
+
+            for (; span < spans.size() && spans[span].start < rowEnd; span++) {
+                const Span &s = spans[span];
+                const int from = qMax(s.start, rowStart);
+                const int to = qMin(s.end, rowEnd);
+                const QString segment = expanded.mid(from, to - from);
+
+                if (!segment.trimmed().isEmpty()) {
+                    m_painter.setFont(s.style->font);
+                    m_painter.setPen(s.style->color);
+                    m_painter.drawText(QPointF((from - rowStart) * m_charWidth, y), segment);
+                }
+
+                // The rest of the span goes on the next row
+                if (s.end > rowEnd)
+                    break;
+            }
+
+            rowStart = rowEnd;
+        } while (rowStart < expanded.size());
+    }
+
+    bool PageWriter::nextRow()
+    {
+        if (m_row >= m_rowsPerPage) {
+            if (!m_device->newPage()) {
+                fail(tr("Unable to add a new page."));
+                return false;
+            }
+            m_row = 0;
+        }
+
+        m_row++;
+        return true;
+    }
+
+    const PageWriter::Style *PageWriter::styleFor(const QString &style)
+    {
+        if (style.isEmpty())
+            return &m_defaultStyle;
+
+        auto it = m_styles.constFind(style);
+        if (it != m_styles.constEnd())
+            return &it.value();
+
+        Style s = m_defaultStyle;
+        bool hasColor = false;
+
+        for (const QString &token : style.split(' ', QString::SkipEmptyParts)) {
+            // Line styles only apply to the background of the editor
+            if (token.startsWith("line-"))
+                continue;
+
+            if (token == "strong" || token == "header") {
+                s.font.setBold(true);
+            } else if (token == "em") {
+                s.font.setItalic(true);
+            } else if (token == "link") {
+                s.font.setUnderline(true);
+            } else if (token == "strikethrough") {
+                s.font.setStrikeOut(true);
+            }
+
+            if (!hasColor && tokenColors().contains(token)) {
+                s.color = tokenColors().value(token);
+                hasColor = true;
+            }
+        }
+
+        return &m_styles.insert(style, s).value();
+    }
+
+    void PageWriter::fail(const QString &errorString)
+    {
+        if (m_painter.isActive()) {
+            m_painter.end();
+        }
+
+        m_ok = false;
+        emit finished(false, errorString);
+    }
+
+    DocumentPrinter::DocumentPrinter(Editor *editor, std::shared_ptr<QPagedPaintDevice> device, QObject *parent) :
+        QObject(parent),
+        m_editor(editor),
+        m_device(device)
+    {
+        connect(editor, &QObject::destroyed, this, [this]() {
+            // Too late to tell the page
+            m_job = -1;
+            finish(false, tr("The document has been closed."));
+        });
+    }
+
+    DocumentPrinter::~DocumentPrinter()
+    {
+        m_thread.quit();
+        m_thread.wait();
+        delete m_writer;
+    }
+
+    void DocumentPrinter::start()
+    {
+        QPointer<DocumentPrinter> self(this);
+        m_editor->asyncSendMessageWithResultP("C_FUN_START_PRINT_JOB").then([self](QVariant job) {
+            if (self) {
+                self->onJobStarted(job.toMap());
+            }
+        });
+    }
+
+    void DocumentPrinter::cancel()
+    {
+        m_canceled = true;
+
+        if (!m_writerBusy) {
+            endWriter();
+        }
+    }
+
+    void DocumentPrinter::onJobStarted(const QVariantMap &job)
+    {
+        if (m_finished)
+            return;
+
+        if (!job.contains("job")) {
+            finish(false, tr("Unable to read the document."));
+            return;
+        }
+
+        m_job = job.value("job").toInt();
+        m_lineCount = job.value("lineCount").toInt();
+
+        m_writer = new PageWriter(m_device, job.value("tabSize").toInt());
+        m_writer->moveToThread(&m_thread);
+        connect(m_writer, &PageWriter::sliceWritten, this, &DocumentPrinter::onSliceWritten);
+        connect(m_writer, &PageWriter::finished, this, &DocumentPrinter::finish);
+        m_thread.start();
+
+        QMetaObject::invokeMethod(m_writer, "begin", Qt::QueuedConnection);
+        requestSlice();
+    }
+
+    void DocumentPrinter::requestSlice()
+    {
+        if (!m_editor)
+            return;
+
+        QPointer<DocumentPrinter> self(this);
+        m_editor->asyncSendMessageWithResultP("C_FUN_GET_PRINT_SLICE", m_job).then([self](QVariant slice) {
+            if (self) {
+                self->onSliceReceived(slice.toMap());
+            }
+        });
+    }
+
+    void DocumentPrinter::onSliceReceived(const QVariantMap &slice)
+    {
+        if (m_finished || m_canceled)
+            return;
+
+        if (!slice.contains("lines")) {
+            finish(false, tr("Unable to read the document."));
+            return;
+        }
+
+        m_lastSliceReceived = slice.value("done").toBool();
+
+        if (m_writerBusy) {
+            m_queuedSlice = slice;
+            m_hasQueuedSlice = true;
+        } else {
+            writeSlice(slice);
+        }
+    }
+
+    void DocumentPrinter::writeSlice(const QVariantMap &slice)
+    {
+        m_writerBusy = true;
+        QMetaObject::invokeMethod(m_writer, "writeSlice", Qt::QueuedConnection, Q_ARG(QVariantMap, slice));
+
+        if (m_lineCount > 0) {
+            const int written = slice.value("from").toInt() + slice.value("lines").toList().size();
+            emit progress(qMin(1.0, double(written) / m_lineCount));
+        }
+
+        // Fetch the next slice while this one is painted
+        if (!slice.value("done").toBool()) {
+            requestSlice();
+        }
+    }
+
+    void DocumentPrinter::onSliceWritten()
+    {
+        m_writerBusy = false;
+
+        if (m_finished)
+            return;
+
+        if (m_hasQueuedSlice && !m_canceled) {
+            m_hasQueuedSlice = false;
+            writeSlice(m_queuedSlice);
+            m_queuedSlice.clear();
+        } else if (m_canceled || (m_lastSliceReceived && !m_hasQueuedSlice)) {
+            endWriter();
+        }
+    }
+
+    void DocumentPrinter::endWriter()
+    {
+        if (m_writer == nullptr) {
+            finish(false, QString());
+            return;
+        }
+
+        QMetaObject::invokeMethod(m_writer, "end", Qt::QueuedConnection);
+    }
+
+    void DocumentPrinter::finish(bool success, const QString &errorString)
+    {
+        if (m_finished)
+            return;
+
+        m_finished = true;
+
+        if (m_editor && m_job >= 0) {
+            m_editor->asyncSendMessageWithResultP("C_CMD_END_PRINT_JOB", m_job);
+        }
+
+        emit finished(success && !m_canceled, errorString);
+        deleteLater();
+    }
+
+}
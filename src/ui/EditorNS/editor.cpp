@@ -1,5 +1,10 @@
 #include "include/EditorNS/editor.h"
 
+#include "include/EditorNS/bridgestatistics.h"
+#include "include/EditorNS/bulktransferschemehandler.h"
+#include "include/EditorNS/documentprinter.h"
+#include "include/EditorNS/editorhost.h"
+#include "include/EditorNS/editorpool.h"
 #include "include/notepadqq.h"
 #include "include/nqqsettings.h"
 
@@ -17,7 +22,7 @@
 namespace EditorNS
 {
 
-    QQueue<Editor*> Editor::m_editorBuffer = QQueue<Editor*>();
+    const int Editor::BULK_TRANSFER_THRESHOLD = 1024 * 1024;
 
     Editor::Editor(QWidget *parent) :
         QWidget(parent)
@@ -34,15 +39,69 @@ namespace EditorNS
         fullConstructor(theme);
     }
 
+    Editor::Editor(const QSharedPointer<EditorHost> &host, QWidget *parent) :
+        QWidget(parent),
+        m_host(host)
+    {
+        fullConstructor(Theme());
+    }
+
+    Editor::~Editor()
+    {
+        if (!m_host.isNull()) {
+            // Takes the shared web view away from us, if we're showing it
+            m_host->detach(this);
+        }
+    }
+
     void Editor::fullConstructor(const Theme &theme)
     {
-        m_jsToCppProxy = new JsToCppProxy(this);
-        connect(m_jsToCppProxy,
-                &JsToCppProxy::messageReceived,
-                this,
-                &Editor::on_proxyMessageReceived);
+        m_loadTimer.start();
+
+        m_layout = new QVBoxLayout(this);
+        m_layout->setContentsMargins(0, 0, 0, 0);
+        m_layout->setSpacing(0);
+        setLayout(m_layout);
+
+        if (m_host.isNull()) {
+            m_jsToCppProxy = new JsToCppProxy(this);
+            connect(m_jsToCppProxy,
+                    &JsToCppProxy::messageReceived,
+                    this,
+                    &Editor::on_proxyMessageReceived);
+
+            m_webView = createWebView(theme, m_jsToCppProxy);
+            m_layout->addWidget(m_webView, 1);
+
+            connect(m_webView, &CustomQWebView::mouseWheel, this, &Editor::mouseWheel);
+            connect(m_webView, &CustomQWebView::urlsDropped, this, &Editor::urlsDropped);
+            connect(m_webView, &CustomQWebView::gotFocus, this, &Editor::gotFocus);
+        } else {
+            // The page belongs to the host: we only own a document within it. The
+            // host moves the web view into our layout whenever we get shown.
+            m_jsToCppProxy = m_host->proxy();
+            m_webView = m_host->webView();
+            m_docId = m_host->attach(this);
+
+            if (m_host->isLoaded()) {
+                m_loaded = true;
+                m_loadTime = m_loadTimer.elapsed();
+                BridgeStatistics::getInstance().recordReply("J_EVT_READY", QVariant(), m_loadTime * 1000);
+            }
+        }
+
+        setLanguage(nullptr);
+        // TODO Display a message if a javascript error gets triggered.
+        // Right now, if there's an error in the javascript code, we
+        // get stuck waiting a J_EVT_READY that will never come.
+    }
+
+    CustomQWebView *Editor::createWebView(const Theme &theme, JsToCppProxy *proxy)
+    {
+        // Make sure the page can fetch bulk payloads as soon as it's loaded
+        BulkTransferSchemeHandler::getInstance();
 
-        m_webView = new CustomQWebView(this);
+        CustomQWebView *webView = new CustomQWebView();
 
         QUrlQuery query;
         query.addQueryItem("themePath", theme.path);
@@ -51,75 +110,124 @@ namespace EditorNS
         QUrl url = QUrl("file://" + Notepadqq::editorPath());
         url.setQuery(query);
 
-        QWebChannel * channel = new QWebChannel(this);
-        m_webView->page()->setWebChannel(channel);
-        channel->registerObject(QStringLiteral("cpp_ui_driver"), m_jsToCppProxy);
+        QWebChannel * channel = new QWebChannel(webView);
+        webView->page()->setWebChannel(channel);
+        channel->registerObject(QStringLiteral("cpp_ui_driver"), proxy);
 
-        m_webView->page()->setBackgroundColor(qApp->palette().color(QPalette::Background));
-        m_webView->setUrl(url);
+        webView->page()->setBackgroundColor(qApp->palette().color(QPalette::Background));
+        webView->setUrl(url);
 
         // To load the page in the background (http://stackoverflow.com/a/10520029):
         // (however, no noticeable improvement here on an i5, september 2014)
         //QString content = QString("<html><body onload='setTimeout(function() { window.location=\"%1\"; }, 1);'>Loading...</body></html>").arg("file://" + Notepadqq::editorPath());
-        //m_webView->setContent(content.toUtf8());
+        //webView->setContent(content.toUtf8());
 
-        m_webView->pageAction(QWebEnginePage::InspectElement)->setVisible(false);
+        webView->pageAction(QWebEnginePage::InspectElement)->setVisible(false);
 
-        //m_webView->page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
+        //webView->page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
 
-        QWebEngineSettings *pageSettings = m_webView->page()->settings();
+        QWebEngineSettings *pageSettings = webView->page()->settings();
         #ifdef QT_DEBUG
         //pageSettings->setAttribute(QWebEngineSettings::DeveloperExtrasEnabled, true);
         #endif
         pageSettings->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, true);
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+        // Needed by the page to fetch bulk payloads (see BulkTransferSchemeHandler).
+        // Newer versions register the scheme as CorsEnabled instead.
+        pageSettings->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, true);
+#endif
 
-        m_layout = new QVBoxLayout(this);
-        m_layout->setContentsMargins(0, 0, 0, 0);
-        m_layout->setSpacing(0);
-        m_layout->addWidget(m_webView, 1);
-        setLayout(m_layout);
+        return webView;
+    }
 
-        connect(m_webView, &CustomQWebView::mouseWheel, this, &Editor::mouseWheel);
-        connect(m_webView, &CustomQWebView::urlsDropped, this, &Editor::urlsDropped);
-        connect(m_webView, &CustomQWebView::gotFocus, this, &Editor::gotFocus);
-        setLanguage(nullptr);
-        // TODO Display a message if a javascript error gets triggered.
-        // Right now, if there's an error in the javascript code, we
-        // get stuck waiting a J_EVT_READY that will never come.
+    void Editor::showEvent(QShowEvent *event)
+    {
+        if (!m_host.isNull()) {
+            m_host->show(this);
+        }
+
+        QWidget::showEvent(event);
     }
 
-    QSharedPointer<Editor> Editor::getNewEditor(QWidget *parent)
+    QString Editor::addressMessage(const QString &msg) const
     {
-        return QSharedPointer<Editor>(getNewEditorUnmanagedPtr(parent), &Editor::deleteLater);
+        if (m_host.isNull())
+            return msg;
+
+        return msg + "[DOC=" + QString::number(m_docId) + "]";
     }
 
-    Editor *Editor::getNewEditorUnmanagedPtr(QWidget *parent)
+    QSharedPointer<Editor> Editor::getNewEditor(QWidget *parent)
     {
-        Editor *out;
+        return QSharedPointer<Editor>(getNewEditorUnmanagedPtr(parent), [](Editor *editor) {
+            EditorPool::getInstance().release(editor);
+        });
+    }
 
-        if (m_editorBuffer.length() == 0) {
-            m_editorBuffer.enqueue(new Editor());
-            out = new Editor();
-        } else if (m_editorBuffer.length() == 1) {
-            m_editorBuffer.enqueue(new Editor());
-            out = m_editorBuffer.dequeue();
-        } else {
-            out = m_editorBuffer.dequeue();
-        }
+    QSharedPointer<Editor> Editor::getNewEditor(const QSharedPointer<EditorHost> &host, QWidget *parent)
+    {
+        // A document within a shared page is cheap to create, so there's no need to pool it
+        return QSharedPointer<Editor>(new Editor(host, parent), &Editor::deleteLater);
+    }
 
-        out->setParent(parent);
-        return out;
+    Editor *Editor::getNewEditorUnmanagedPtr(QWidget *parent)
+    {
+        return EditorPool::getInstance().acquire(parent);
     }
 
     void Editor::addEditorToBuffer(const int howMany)
     {
-        for (int i = 0; i < howMany; i++)
-            m_editorBuffer.enqueue(new Editor());
+        EditorPool::getInstance().add(howMany);
     }
 
     void Editor::invalidateEditorBuffer()
     {
-        m_editorBuffer.clear();
+        EditorPool::getInstance().invalidate();
+    }
+
+    void Editor::resetForReuse()
+    {
+        hide();
+
+        // Drop the connections made by the previous owner. asyncReplyReceived
+        // and editorReady are left alone: they deliver the replies to the
+        // messages that are still in flight.
+        disconnect(this, &Editor::messageReceived, nullptr, nullptr);
+        disconnect(this, &Editor::gotFocus, nullptr, nullptr);
+        disconnect(this, &Editor::mouseWheel, nullptr, nullptr);
+        disconnect(this, &Editor::urlsDropped, nullptr, nullptr);
+        disconnect(this, &Editor::bannerRemoved, nullptr, nullptr);
+        disconnect(this, &Editor::contentChanged, nullptr, nullptr);
+        disconnect(this, &Editor::cursorActivity, nullptr, nullptr);
+        disconnect(this, &Editor::documentInfoRequested, nullptr, nullptr);
+        disconnect(this, &Editor::cleanChanged, nullptr, nullptr);
+        disconnect(this, &Editor::fileNameChanged, nullptr, nullptr);
+        disconnect(this, &Editor::currentLanguageChanged, nullptr, nullptr);
+        disconnect(this, &Editor::largeDocumentModeChanged, nullptr, nullptr);
+
+        // Remove the banners left by the previous document
+        for (int i = m_layout->count() - 1; i >= 0; i--) {
+            QWidget *banner = m_layout->itemAt(i)->widget();
+            if (banner != nullptr && banner != m_webView) {
+                m_layout->removeWidget(banner);
+                banner->deleteLater();
+            }
+        }
+
+        m_filePath = QUrl();
+        m_tabName = QString();
+        m_fileOnDiskChanged = false;
+        m_endOfLineSequence = "\n";
+        m_codec = QTextCodec::codecForName("UTF-8");
+        m_bom = false;
+        m_customIndentationMode = false;
+        m_largeDocumentMode = false;
+        m_hasDetectedIndentation = false;
+
+        asyncSendMessageWithResultP("C_CMD_RESET");
+
+        m_currentLanguage = nullptr;
+        setLanguage(nullptr);
     }
 
     void Editor::waitAsyncLoad()
@@ -153,6 +261,9 @@ namespace EditorNS
                 for (auto it = this->asyncReplies.begin(); it != this->asyncReplies.end(); ++it) {
                     if (it->id == id) {
                         AsyncReply r = *it;
+                        BridgeStatistics &stats = BridgeStatistics::getInstance();
+                        stats.recordReply(r.message, data, stats.now() - r.sentAt);
+
                         if (r.value) {
                             r.value->set_value(data);
                         }
@@ -171,10 +282,17 @@ namespace EditorNS
 
             } else if(msg == "J_EVT_READY") {
                 m_loaded = true;
+                m_loadTime = m_loadTimer.elapsed();
+                BridgeStatistics::getInstance().recordReply("J_EVT_READY", QVariant(), m_loadTime * 1000);
+#ifdef QT_DEBUG
+                qDebug() << QString("Editor ready in " + QString::number(m_loadTime) + "msec").toStdString().c_str();
+#endif
                 emit editorReady();
-            } else if(msg == "J_EVT_CONTENT_CHANGED")
+            } else if(msg == "J_EVT_CONTENT_CHANGED") {
+                // The indentation detected so far may not hold anymore
+                m_hasDetectedIndentation = false;
                 emit contentChanged();
-            else if(msg == "J_EVT_CLEAN_CHANGED")
+            } else if(msg == "J_EVT_CLEAN_CHANGED")
                 emit cleanChanged(data.toBool());
             else if (msg == "J_EVT_CURSOR_ACTIVITY") {
                 emit cursorActivity(data.toMap());
@@ -269,7 +387,10 @@ namespace EditorNS
             setIndentationMode(lang);
         }
         m_currentLanguage = lang;
-        asyncSendMessageWithResultP("C_CMD_SET_LANGUAGE", lang->mime.isEmpty() ? lang->mode : lang->mime).then([=](){
+
+        // The page loads modes lazily, so it needs the mode name too
+        QVariantMap data{{"mode", lang->mode}, {"mime", lang->mime.isEmpty() ? lang->mode : lang->mime}};
+        asyncSendMessageWithResultP("C_CMD_SET_LANGUAGE", data).then([=](){
             emit currentLanguageChanged(m_currentLanguage->id, m_currentLanguage->name);
         });
     }
@@ -369,11 +490,30 @@ namespace EditorNS
 
     QPromise<void> Editor::setValue(const QString &value)
     {
+        m_hasDetectedIndentation = false;
+
         auto lang = LanguageService::getInstance().lookupByContent(value);
         if (lang != nullptr) {
             setLanguage(lang);
         }
-        return asyncSendMessageWithResultP("C_CMD_SET_VALUE", value).then([](){})
+
+        if (value.length() < BULK_TRANSFER_THRESHOLD) {
+            return asyncSendMessageWithResultP("C_CMD_SET_VALUE", value).then([](){})
+                    .wait(); // FIXME Remove
+        }
+
+        // Large documents don't go through the web channel: the page receives
+        // a handle and fetches the raw bytes from BulkTransferSchemeHandler.
+        // If that fails for any reason, fall back to the regular message.
+        const QUrl handle = BulkTransferSchemeHandler::getInstance().publish(value.toUtf8());
+        return asyncSendMessageWithResultP("C_CMD_SET_VALUE_BULK", handle.toString())
+                .then([=](QVariant fetched) {
+                    BulkTransferSchemeHandler::getInstance().revoke(handle);
+                    if (fetched.toBool()) {
+                        return QPromise<void>::resolve();
+                    }
+                    return asyncSendMessageWithResultP("C_CMD_SET_VALUE", value).then([](){});
+                })
                 .wait(); // FIXME Remove
     }
 
@@ -409,7 +549,7 @@ namespace EditorNS
 #endif
         waitAsyncLoad();
 
-        emit m_jsToCppProxy->messageReceivedByJs(msg, data);
+        emit m_jsToCppProxy->messageReceivedByJs(addressMessage(msg), data);
     }
 
     void Editor::sendMessage(const QString &msg)
@@ -443,9 +583,12 @@ namespace EditorNS
         asyncmsg.message = msg;
         asyncmsg.value = nullptr;
         asyncmsg.callback = nullptr;
+        asyncmsg.sentAt = BridgeStatistics::getInstance().now();
         this->asyncReplies.push_back((asyncmsg));
 
-        QString message_id = "[ASYNC_REQUEST]" + msg + "[ID=" + QString::number(currentMsgIdentifier) + "]";
+        BridgeStatistics::getInstance().recordRequest(msg, data, false);
+
+        QString message_id = addressMessage("[ASYNC_REQUEST]" + msg + "[ID=" + QString::number(currentMsgIdentifier) + "]");
 
         if (m_loaded) {
             // Send it right now
@@ -479,19 +622,30 @@ namespace EditorNS
         asyncmsg.message = msg;
         asyncmsg.value = resultPromise;
         asyncmsg.callback = callback;
+        asyncmsg.sentAt = BridgeStatistics::getInstance().now();
         this->asyncReplies.push_back((asyncmsg));
 
+        BridgeStatistics &stats = BridgeStatistics::getInstance();
+        stats.recordRequest(msg, data, true);
+
         QString message_id = "[ASYNC_REQUEST]" + msg + "[ID=" + QString::number(currentMsgIdentifier) + "]";
 
         this->sendMessage(message_id, data);
 
         std::shared_future<QVariant> fut = resultPromise->get_future().share();
 
+        // Everything that runs in the nested loop, including other blocking
+        // requests, counts as time spent waiting for this one.
+        const qint64 waitStart = stats.now();
+        stats.beginBlockingWait();
+
         while (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
             QCoreApplication::processEvents(QEventLoop::AllEvents);
             QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
         }
 
+        stats.endBlockingWait(msg, stats.now() - waitStart);
+
         return fut;
     }
 
@@ -615,6 +769,16 @@ namespace EditorNS
         asyncSendMessageWithResultP("C_CMD_SET_SELECTION", QVariant(arg));
     }
 
+    void Editor::setSelections(const QList<Selection> &selections)
+    {
+        QVariantList arg;
+        arg.reserve(selections.size() * 4);
+        for (const Selection &sel : selections) {
+            arg << sel.from.line << sel.from.column << sel.to.line << sel.to.column;
+        }
+        asyncSendMessageWithResultP("C_CMD_SET_SELECTIONS", QVariant(arg));
+    }
+
     QPair<int, int> Editor::scrollPosition()
     {
         QVariantList scroll = asyncSendMessageWithResult("C_FUN_GET_SCROLL_POS").get().toList();
@@ -739,6 +903,61 @@ namespace EditorNS
         asyncSendMessageWithResultP("C_CMD_SET_OVERWRITE", overwrite);
     }
 
+    QPromise<bool> Editor::transformLines(TextTransform::Operation operation)
+    {
+        return asyncSendMessageWithResultP("C_FUN_GET_TRANSFORM_SNAPSHOT").then([=](QVariant result) {
+            const QVariantMap snapshot = result.toMap();
+            const QStringList lines = snapshot.value("text").toString().split('\n');
+            const int tabSize = qMax(1, snapshot.value("tabSize", 4).toInt());
+
+#ifdef QT_DEBUG
+            QElapsedTimer timer;
+            timer.start();
+#endif
+
+            const QList<TextTransform::Patch> patches = TextTransform::apply(lines, operation, tabSize);
+
+#ifdef QT_DEBUG
+            qDebug() << QString("Transformed %1 lines in %2 msec, %3 ranges changed")
+                        .arg(lines.size())
+                        .arg(timer.elapsed())
+                        .arg(patches.size()).toStdString().c_str();
+#endif
+
+            if (patches.isEmpty()) {
+                return QPromise<bool>::resolve(true);
+            }
+
+            QVariantList encoded;
+            for (const TextTransform::Patch &patch : patches) {
+                encoded.append(QVariant(QVariantList{patch.fromLine, patch.toLine, patch.lines.join('\n')}));
+            }
+
+            QVariantMap data;
+            data.insert("version", snapshot.value("version"));
+            data.insert("patches", encoded);
+
+            return asyncSendMessageWithResultP("C_CMD_APPLY_LINE_PATCHES", data).then([](QVariant applied) {
+                return applied.toBool();
+            });
+        });
+    }
+
+    void Editor::setLargeDocumentMode(bool enabled)
+    {
+        if (m_largeDocumentMode == enabled)
+            return;
+
+        m_largeDocumentMode = enabled;
+        asyncSendMessageWithResultP("C_CMD_SET_LARGE_DOCUMENT_MODE", enabled);
+        emit largeDocumentModeChanged(enabled);
+    }
+
+    bool Editor::isLargeDocumentMode() const
+    {
+        return m_largeDocumentMode;
+    }
+
     void Editor::setTabsVisible(bool visible)
     {
         asyncSendMessageWithResultP("C_CMD_SET_TABS_VISIBLE", visible);
@@ -746,6 +965,10 @@ namespace EditorNS
 
     QPromise<std::pair<Editor::IndentationMode, bool>> Editor::detectDocumentIndentation()
     {
+        if (m_hasDetectedIndentation) {
+            return QPromise<std::pair<IndentationMode, bool>>::resolve(m_detectedIndentation);
+        }
+
         return asyncSendMessageWithResultP("C_FUN_DETECT_INDENTATION_MODE").then([](QVariant result){
             QVariantMap indent = result.toMap();
             IndentationMode out;
@@ -761,75 +984,17 @@ namespace EditorNS
         });
     }
 
-    void Editor::print(std::shared_ptr<QPrinter> printer)
-    {
-        // 1. Set theme to default because dark themes would force the printer to color the entire
-        //    document in the background color. Default theme has white background.
-        // 2. Set WebView's bg-color to white to prevent visual artifacts when printing less than one page.
-        // 3. Set C_CMD_DISPLAY_PRINT_STYLE to hide UI elements like the gutter.
-
-#if QT_VERSION >= QT_VERSION_CHECK(5,8,0)
-        QColor prevBackgroundColor = m_webView->page()->backgroundColor();
-        QString prevStylesheet = m_webView->styleSheet();
-
-        this->setLineWrap(true);
-        setTheme(themeFromName("default"));
-        m_webView->page()->setBackgroundColor(Qt::transparent);
-        m_webView->setStyleSheet("background-color: white");
-        sendMessage("C_CMD_DISPLAY_PRINT_STYLE");
-        m_webView->page()->print(printer.get(), [=](bool /*success*/) {
-            // Note: it is important to capture "printer" in order to keep the shared_ptr alive.
-            sendMessage("C_CMD_DISPLAY_NORMAL_STYLE");
-            m_webView->setStyleSheet(prevStylesheet);
-            m_webView->page()->setBackgroundColor(prevBackgroundColor);
-            setTheme(themeFromName(NqqSettings::getInstance().Appearance.getColorScheme()));
-            this->setLineWrap(NqqSettings::getInstance().General.getWordWrap());
-        });
-#endif
+    void Editor::setDetectedIndentation(const std::pair<IndentationMode, bool> &detected)
+    {
+        m_detectedIndentation = detected;
+        m_hasDetectedIndentation = true;
     }
 
-    QPromise<QByteArray> Editor::printToPdf(const QPageLayout& pageLayout)
-    {
-        // 1. Set theme to default because dark themes would force the printer to color the entire
-        //    document in the background color. Default theme has white background.
-        // 2. Set WebView's bg-color to white to prevent visual artifacts when printing less than one page.
-        // 3. Set C_CMD_DISPLAY_PRINT_STYLE to hide UI elements like the gutter.
-
-        return QPromise<QByteArray>(
-            [&](const QPromiseResolve<QByteArray>& resolve, const QPromiseReject<QByteArray>& reject) {
-
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                QColor prevBackgroundColor = m_webView->page()->backgroundColor();
-                QString prevStylesheet = m_webView->styleSheet();
-
-                this->setLineWrap(true);
-                setTheme(themeFromName("default"));
-                m_webView->page()->setBackgroundColor(Qt::transparent);
-                m_webView->setStyleSheet("background-color: white");
-                asyncSendMessageWithResultP("C_CMD_DISPLAY_PRINT_STYLE").wait();
-
-                m_webView->page()->printToPdf(
-                    [=](const QByteArray& data) {
-                        QTimer::singleShot(0, [=]() {
-                            asyncSendMessageWithResultP("C_CMD_DISPLAY_NORMAL_STYLE").wait();
-                            m_webView->setStyleSheet(prevStylesheet);
-                            m_webView->page()->setBackgroundColor(prevBackgroundColor);
-                            setTheme(themeFromName(NqqSettings::getInstance().Appearance.getColorScheme()));
-                            this->setLineWrap(NqqSettings::getInstance().General.getWordWrap());
-                        });
-
-                        if (data.isEmpty() || data.isNull()) {
-                            reject(QByteArray());
-                        } else {
-                            resolve(data);
-                        }
-                    },
-                    pageLayout);
-
-#else
-                reject(QByteArray());
-#endif
-            });
+    DocumentPrinter *Editor::print(std::shared_ptr<QPagedPaintDevice> device)
+    {
+        DocumentPrinter *printer = new DocumentPrinter(this, device);
+        printer->start();
+        return printer;
     }
 
     QPromise<QString> Editor::getCurrentWord()
@@ -843,4 +1008,9 @@ namespace EditorNS
         return asyncSendMessageWithResultP("C_FUN_GET_LINE_COUNT")
                 .then([](QVariant v){ return v.toInt(); });
     }
+
+    qint64 Editor::loadTime() const
+    {
+        return m_loadTime;
+    }
 }
@@ -0,0 +1,121 @@
+#include "include/EditorNS/editorhost.h"
+
+#include <QRegularExpression>
+
+namespace EditorNS
+{
+
+    EditorHost::EditorHost(const Editor::Theme &theme, QObject *parent) :
+        QObject(parent)
+    {
+        m_jsToCppProxy = new JsToCppProxy(this);
+        connect(m_jsToCppProxy,
+                &JsToCppProxy::messageReceived,
+                this,
+                &EditorHost::on_proxyMessageReceived);
+
+        m_webView = Editor::createWebView(theme, m_jsToCppProxy);
+
+        // These are forwarded to the Editor that is currently displaying the page
+        connect(m_webView, &CustomQWebView::mouseWheel, this, [=](QWheelEvent *ev) {
+            if (m_currentEditor != nullptr)
+                emit m_currentEditor->mouseWheel(ev);
+        });
+        connect(m_webView, &CustomQWebView::urlsDropped, this, [=](QList<QUrl> urls) {
+            if (m_currentEditor != nullptr)
+                emit m_currentEditor->urlsDropped(urls);
+        });
+        connect(m_webView, &CustomQWebView::gotFocus, this, [=]() {
+            if (m_currentEditor != nullptr)
+                emit m_currentEditor->gotFocus();
+        });
+    }
+
+    EditorHost::~EditorHost()
+    {
+        delete m_webView;
+    }
+
+    CustomQWebView *EditorHost::webView() const
+    {
+        return m_webView;
+    }
+
+    JsToCppProxy *EditorHost::proxy() const
+    {
+        return m_jsToCppProxy;
+    }
+
+    bool EditorHost::isLoaded() const
+    {
+        return m_loaded;
+    }
+
+    unsigned int EditorHost::attach(Editor *editor)
+    {
+        const unsigned int docId = ++m_lastDocId;
+        m_editors.insert(docId, editor);
+        return docId;
+    }
+
+    void EditorHost::detach(Editor *editor)
+    {
+        m_editors.remove(editor->m_docId);
+
+        if (m_webView->parentWidget() == editor) {
+            editor->m_layout->removeWidget(m_webView);
+            m_webView->hide();
+            m_webView->setParent(nullptr);
+        }
+
+        if (m_currentEditor == editor) {
+            m_currentEditor = nullptr;
+        }
+
+        if (m_loaded) {
+            emit m_jsToCppProxy->messageReceivedByJs(editor->addressMessage("C_CMD_CLOSE_DOC"), 0);
+        }
+    }
+
+    void EditorHost::show(Editor *editor)
+    {
+        if (m_currentEditor == editor && m_webView->parentWidget() == editor)
+            return;
+
+        Editor *previous = qobject_cast<Editor *>(m_webView->parentWidget());
+        if (previous != nullptr) {
+            previous->m_layout->removeWidget(m_webView);
+        }
+
+        m_currentEditor = editor;
+        editor->m_layout->addWidget(m_webView, 1);
+        m_webView->show();
+
+        editor->asyncSendMessageWithResultP("C_CMD_SHOW_DOC");
+    }
+
+    void EditorHost::on_proxyMessageReceived(QString msg, QVariant data)
+    {
+        static const QRegularExpression docTag("\\[DOC=(\\d+)\\]$");
+
+        QRegularExpressionMatch match = docTag.match(msg);
+
+        if (!match.hasMatch()) {
+            // Messages about the page itself concern every document
+            if (msg == "J_EVT_READY") {
+                m_loaded = true;
+            }
+
+            for (Editor *editor : m_editors) {
+                editor->on_proxyMessageReceived(msg, data);
+            }
+            return;
+        }
+
+        Editor *editor = m_editors.value(match.captured(1).toUInt(), nullptr);
+        if (editor != nullptr) {
+            editor->on_proxyMessageReceived(msg.left(match.capturedStart()), data);
+        }
+    }
+
+}
@@ -0,0 +1,168 @@
+#include "include/EditorNS/editorpool.h"
+
+#include "include/EditorNS/editor.h"
+#include "include/nqqsettings.h"
+
+#include <QApplication>
+#include <QDebug>
+
+namespace EditorNS
+{
+
+    const int EditorPool::ESTIMATED_EDITOR_MEMORY = 40;
+    const qint64 EditorPool::REQUEST_RATE_WINDOW = 30000;
+    const int EditorPool::WARM_UP_INTERVAL = 250;
+
+    double EditorPool::Statistics::hitRate() const
+    {
+        const int requests = hits + misses;
+        return requests == 0 ? 0 : static_cast<double>(hits) / requests;
+    }
+
+    EditorPool::EditorPool(QObject *parent) :
+        QObject(parent)
+    {
+        m_clock.start();
+
+        m_warmUpTimer.setSingleShot(true);
+        m_warmUpTimer.setInterval(WARM_UP_INTERVAL);
+        connect(&m_warmUpTimer, &QTimer::timeout, this, &EditorPool::on_warmUpTimeout);
+    }
+
+    EditorPool& EditorPool::getInstance()
+    {
+        static EditorPool *instance = nullptr;
+
+        if (instance == nullptr) {
+            instance = new EditorPool(qApp);
+        }
+
+        return *instance;
+    }
+
+    Editor *EditorPool::acquire(QWidget *parent)
+    {
+        m_recentRequests.enqueue(m_clock.elapsed());
+
+        Editor *out;
+
+        if (m_editors.isEmpty()) {
+            m_statistics.misses++;
+            out = new Editor();
+        } else {
+            m_statistics.hits++;
+            out = m_editors.dequeue();
+        }
+
+        out->setParent(parent);
+        scheduleWarmUp();
+
+#ifdef QT_DEBUG
+        qDebug() << QString("Editor pool: %1 hits, %2 misses, %3 pooled, target %4")
+                    .arg(m_statistics.hits)
+                    .arg(m_statistics.misses)
+                    .arg(m_editors.size())
+                    .arg(targetSize()).toStdString().c_str();
+#endif
+
+        return out;
+    }
+
+    void EditorPool::release(Editor *editor)
+    {
+        if (editor == nullptr)
+            return;
+
+        // Editors that are still loading, or that somebody else still owns,
+        // are not worth recycling.
+        if (QCoreApplication::closingDown() || !editor->m_loaded || editor->parent() != nullptr ||
+                m_editors.size() >= maximumSize()) {
+            m_statistics.discarded++;
+            editor->deleteLater();
+            return;
+        }
+
+        editor->resetForReuse();
+        m_editors.enqueue(editor);
+        m_statistics.recycled++;
+        scheduleWarmUp();
+    }
+
+    void EditorPool::add(const int howMany)
+    {
+        for (int i = 0; i < howMany; i++)
+            m_editors.enqueue(new Editor());
+    }
+
+    void EditorPool::invalidate()
+    {
+        while (!m_editors.isEmpty()) {
+            m_editors.dequeue()->deleteLater();
+        }
+
+        scheduleWarmUp();
+    }
+
+    int EditorPool::size() const
+    {
+        return m_editors.size();
+    }
+
+    int EditorPool::targetSize() const
+    {
+        return qMin(qMax(1, m_recentRequests.size()), maximumSize());
+    }
+
+    int EditorPool::maximumSize() const
+    {
+        const int limit = NqqSettings::getInstance().General.getEditorPoolMemoryLimit();
+        return qMax(0, limit / ESTIMATED_EDITOR_MEMORY);
+    }
+
+    const EditorPool::Statistics &EditorPool::statistics() const
+    {
+        return m_statistics;
+    }
+
+    void EditorPool::forgetOldRequests()
+    {
+        const qint64 now = m_clock.elapsed();
+
+        while (!m_recentRequests.isEmpty() && now - m_recentRequests.head() > REQUEST_RATE_WINDOW) {
+            m_recentRequests.dequeue();
+        }
+    }
+
+    void EditorPool::scheduleWarmUp()
+    {
+        if (!m_warmUpTimer.isActive()) {
+            m_warmUpTimer.start();
+        }
+    }
+
+    void EditorPool::on_warmUpTimeout()
+    {
+        forgetOldRequests();
+
+        const int target = targetSize();
+
+        // Only one Editor is added or removed at each tick, so that
+        // the UI stays responsive while the pool gets resized.
+        if (m_editors.size() > target) {
+            // The Editor at the head is the one that has been idle for the longest time
+            m_editors.dequeue()->deleteLater();
+        } else if (m_editors.size() < target) {
+            // Don't load several pages at the same time: wait for the last one to be ready.
+            if (m_editors.isEmpty() || m_editors.last()->m_loaded) {
+                m_editors.enqueue(new Editor());
+            }
+        }
+
+        // Keep going while the pool has to be resized, or while the
+        // target may still shrink because of old requests.
+        if (m_editors.size() != target || !m_recentRequests.isEmpty()) {
+            scheduleWarmUp();
+        }
+    }
+
+}
@@ -0,0 +1,268 @@
+#include "include/EditorNS/linediff.h"
+
+#include <QHash>
+
+namespace EditorNS
+{
+
+    const int LineDiff::MAX_OCCURRENCES = 64;
+    const int LineDiff::MAX_EDIT_COST = 1024;
+
+    QVector<LineDiff::Hunk> LineDiff::compute(const QString &a, const QString &b)
+    {
+        const QVector<QStringRef> linesA = splitLines(a);
+        const QVector<QStringRef> linesB = splitLines(b);
+
+        // Skip the common prefix and suffix before hashing anything: with
+        // two versions of the same file, that's usually most of it.
+        int prefix = 0;
+        const int maxPrefix = qMin(linesA.size(), linesB.size());
+        while (prefix < maxPrefix && linesA[prefix] == linesB[prefix]) {
+            prefix++;
+        }
+
+        int suffix = 0;
+        const int maxSuffix = maxPrefix - prefix;
+        while (suffix < maxSuffix &&
+               linesA[linesA.size() - 1 - suffix] == linesB[linesB.size() - 1 - suffix]) {
+            suffix++;
+        }
+
+        // Give the same id to the same lines
+        QHash<QStringRef, int> ids;
+        auto toIds = [&](const QVector<QStringRef> &lines) {
+            QVector<int> out;
+            out.reserve(lines.size() - prefix - suffix);
+            for (int i = prefix; i < lines.size() - suffix; i++) {
+                auto it = ids.constFind(lines[i]);
+                if (it == ids.constEnd()) {
+                    it = ids.insert(lines[i], ids.size());
+                }
+                out.append(it.value());
+            }
+            return out;
+        };
+
+        const QVector<int> idsA = toIds(linesA);
+        const QVector<int> idsB = toIds(linesB);
+
+        QVector<Hunk> hunks = compute(idsA, idsB);
+        for (Hunk &hunk : hunks) {
+            hunk.fromA += prefix;
+            hunk.fromB += prefix;
+        }
+
+        return hunks;
+    }
+
+    QVector<LineDiff::Hunk> LineDiff::compute(const QVector<int> &a, const QVector<int> &b)
+    {
+        QVector<Hunk> hunks;
+
+        // Regions still to be diffed. The left one is always pushed last,
+        // so that the hunks come out in order.
+        QVector<Region> stack;
+        stack.append(Region{0, a.size(), 0, b.size()});
+
+        struct Occurrences {
+            int first;
+            int count;
+        };
+        QHash<int, Occurrences> occurrences;
+        QVector<int> next;
+
+        while (!stack.isEmpty()) {
+            Region r = stack.takeLast();
+
+            while (r.aBegin < r.aEnd && r.bBegin < r.bEnd && a[r.aBegin] == b[r.bBegin]) {
+                r.aBegin++;
+                r.bBegin++;
+            }
+            while (r.aBegin < r.aEnd && r.bBegin < r.bEnd && a[r.aEnd - 1] == b[r.bEnd - 1]) {
+                r.aEnd--;
+                r.bEnd--;
+            }
+
+            if (r.aBegin == r.aEnd || r.bBegin == r.bEnd) {
+                appendHunk(hunks, r);
+                continue;
+            }
+
+            // Index the lines of A: where each one first occurs, how many
+            // times, and the chain of its next occurrences.
+            occurrences.clear();
+            next.fill(-1, r.aEnd - r.aBegin);
+            for (int i = r.aEnd - 1; i >= r.aBegin; i--) {
+                auto it = occurrences.find(a[i]);
+                if (it == occurrences.end()) {
+                    occurrences.insert(a[i], Occurrences{i, 1});
+                } else {
+                    next[i - r.aBegin] = it->first;
+                    it->first = i;
+                    it->count++;
+                }
+            }
+
+            // Look for the longest run of common lines, preferring the runs
+            // around the lines that occur the least.
+            int bestA = 0;
+            int bestB = 0;
+            int bestLength = 0;
+            int bestCount = MAX_OCCURRENCES;
+
+            for (int bi = r.bBegin; bi < r.bEnd; ) {
+                int nextBi = bi + 1;
+                auto it = occurrences.constFind(b[bi]);
+
+                if (it != occurrences.constEnd() && it->count <= bestCount) {
+                    for (int ai = it->first; ai >= 0; ai = next[ai - r.aBegin]) {
+                        int as = ai;
+                        int bs = bi;
+                        while (as > r.aBegin && bs > r.bBegin && a[as - 1] == b[bs - 1]) {
+                            as--;
+                            bs--;
+                        }
+
+                        int ae = ai + 1;
+                        int be = bi + 1;
+                        while (ae < r.aEnd && be < r.bEnd && a[ae] == b[be]) {
+                            ae++;
+                            be++;
+                        }
+
+                        if (it->count < bestCount || (it->count == bestCount && ae - as > bestLength)) {
+                            bestA = as;
+                            bestB = bs;
+                            bestLength = ae - as;
+                            bestCount = it->count;
+                        }
+
+                        // The rest of the run has been looked at already
+                        nextBi = qMax(nextBi, be);
+                    }
+                }
+
+                bi = nextBi;
+            }
+
+            if (bestLength == 0) {
+                // Nothing in common but lines that are everywhere
+                if (!myers(a, b, r, hunks)) {
+                    appendHunk(hunks, r);
+                }
+                continue;
+            }
+
+            stack.append(Region{bestA + bestLength, r.aEnd, bestB + bestLength, r.bEnd});
+            stack.append(Region{r.aBegin, bestA, r.bBegin, bestB});
+        }
+
+        return hunks;
+    }
+
+    bool LineDiff::myers(const QVector<int> &a, const QVector<int> &b, const Region &region, QVector<Hunk> &hunks)
+    {
+        const int n = region.aEnd - region.aBegin;
+        const int m = region.bEnd - region.bBegin;
+        const int maxCost = qMin(n + m, MAX_EDIT_COST);
+
+        // v[k + offset] is how far along A the furthest path on diagonal
+        // k = x - y gets. trace[d] keeps v for diagonals -d..d after d edits.
+        const int offset = maxCost + 1;
+        QVector<int> v(2 * maxCost + 3, 0);
+        QVector<QVector<int>> trace;
+
+        int cost = -1;
+        for (int d = 0; d <= maxCost && cost == -1; d++) {
+            for (int k = -d; k <= d; k += 2) {
+                int x;
+                if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                    x = v[offset + k + 1];      // Line added from B
+                } else {
+                    x = v[offset + k - 1] + 1;  // Line removed from A
+                }
+                int y = x - k;
+
+                while (x < n && y < m && a[region.aBegin + x] == b[region.bBegin + y]) {
+                    x++;
+                    y++;
+                }
+                v[offset + k] = x;
+
+                if (x >= n && y >= m) {
+                    cost = d;
+                    break;
+                }
+            }
+            trace.append(v.mid(offset - d, 2 * d + 1));
+        }
+
+        if (cost == -1)
+            return false;
+
+        // Walk back from the end to find the edits, last one first
+        struct Edit {
+            int x;
+            int y;
+            bool added;
+        };
+        QVector<Edit> edits;
+        edits.reserve(cost);
+
+        int x = n;
+        int y = m;
+        for (int d = cost; d > 0; d--) {
+            const QVector<int> &prev = trace[d - 1];    // Diagonals -(d-1)..(d-1)
+            const int k = x - y;
+            const bool added = k == -d || (k != d && prev[k - 1 + d - 1] < prev[k + 1 + d - 1]);
+            const int prevK = added ? k + 1 : k - 1;
+            const int prevX = prev[prevK + d - 1];
+
+            edits.append(Edit{prevX, prevX - prevK, added});
+            x = prevX;
+            y = prevX - prevK;
+        }
+
+        for (int i = edits.size() - 1; i >= 0; i--) {
+            const Edit &e = edits[i];
+            const int aBegin = region.aBegin + e.x;
+            const int bBegin = region.bBegin + e.y;
+            appendHunk(hunks, Region{aBegin, e.added ? aBegin : aBegin + 1, bBegin, e.added ? bBegin + 1 : bBegin});
+        }
+
+        return true;
+    }
+
+    QVector<QStringRef> LineDiff::splitLines(const QString &text)
+    {
+        QVector<QStringRef> lines;
+        int from = 0;
+        int eol;
+        while ((eol = text.indexOf('\n', from)) != -1) {
+            lines.append(text.midRef(from, eol - from));
+            from = eol + 1;
+        }
+        lines.append(text.midRef(from));
+        return lines;
+    }
+
+    void LineDiff::appendHunk(QVector<Hunk> &hunks, const Region &region)
+    {
+        const int countA = region.aEnd - region.aBegin;
+        const int countB = region.bEnd - region.bBegin;
+        if (countA == 0 && countB == 0)
+            return;
+
+        if (!hunks.isEmpty()) {
+            Hunk &last = hunks.last();
+            if (last.fromA + last.countA == region.aBegin && last.fromB + last.countB == region.bBegin) {
+                last.countA += countA;
+                last.countB += countB;
+                return;
+            }
+        }
+
+        hunks.append(Hunk{region.aBegin, countA, region.bBegin, countB});
+    }
+
+}
@@ -0,0 +1,162 @@
+#include "include/EditorNS/texttransform.h"
+
+#include <QVector>
+#include <QtConcurrent>
+
+#include <functional>
+
+namespace EditorNS
+{
+
+    const int TextTransform::CHUNK_SIZE = 4096;
+
+    QList<TextTransform::Patch> TextTransform::apply(const QStringList &lines, Operation operation, int tabSize)
+    {
+        QList<Patch> patches;
+
+        if (operation == EolToSpace) {
+            // Every line ends up in the first one
+            if (lines.size() > 1) {
+                patches.append(Patch{0, lines.size(), QStringList(lines.join(' '))});
+            }
+            return patches;
+        }
+
+        QVector<int> chunks;
+        for (int i = 0; i < lines.size(); i += CHUNK_SIZE) {
+            chunks.append(i);
+        }
+
+        // Each chunk gives the runs of consecutive lines that changed within it.
+        // QtConcurrent needs a result_type, which lambdas don't have.
+        const std::function<QList<Patch>(int)> transformChunk = [&](int from) {
+            QList<Patch> out;
+            const int to = qMin(from + CHUNK_SIZE, lines.size());
+
+            for (int i = from; i < to; i++) {
+                const QString &line = lines.at(i);
+                QString transformed = transformLine(line, operation, tabSize);
+
+                if (transformed == line)
+                    continue;
+
+                if (!out.isEmpty() && out.last().toLine == i) {
+                    out.last().toLine++;
+                    out.last().lines.append(transformed);
+                } else {
+                    out.append(Patch{i, i + 1, QStringList(transformed)});
+                }
+            }
+
+            return out;
+        };
+
+        const QList<QList<Patch>> chunkPatches =
+                QtConcurrent::blockingMapped<QList<QList<Patch>>>(chunks, transformChunk);
+
+        // Join the runs that span two chunks
+        for (const QList<Patch> &chunk : chunkPatches) {
+            for (const Patch &patch : chunk) {
+                if (!patches.isEmpty() && patches.last().toLine == patch.fromLine) {
+                    patches.last().toLine = patch.toLine;
+                    patches.last().lines.append(patch.lines);
+                } else {
+                    patches.append(patch);
+                }
+            }
+        }
+
+        return patches;
+    }
+
+    QString TextTransform::transformLine(const QString &line, Operation operation, int tabSize)
+    {
+        switch (operation) {
+        case TrimTrailingSpace: {
+            int end = line.length();
+            while (end > 0 && line.at(end - 1).isSpace())
+                end--;
+            return line.left(end);
+        }
+        case TrimLeadingSpace: {
+            int start = 0;
+            while (start < line.length() && line.at(start).isSpace())
+                start++;
+            return line.mid(start);
+        }
+        case TrimLeadingTrailingSpace:
+            return line.trimmed();
+        case TabToSpace:
+            return tabToSpace(line, tabSize);
+        case SpaceToTabAll:
+            return spaceToTab(line, false, tabSize);
+        case SpaceToTabLeading:
+            return spaceToTab(line, true, tabSize);
+        case EolToSpace:
+            break;
+        }
+
+        return line;
+    }
+
+    QString TextTransform::tabToSpace(const QString &line, int tabSize)
+    {
+        if (!line.contains('\t'))
+            return line;
+
+        QString out;
+        out.reserve(line.length() + tabSize * 4);
+
+        for (const QChar &c : line) {
+            if (c == '\t') {
+                // Up to the next tab stop
+                out.append(QString(tabSize - (out.length() % tabSize), ' '));
+            } else {
+                out.append(c);
+            }
+        }
+
+        return out;
+    }
+
+    QString TextTransform::spaceToTab(const QString &line, bool leadingOnly, int tabSize)
+    {
+        if (!line.contains(' '))
+            return line;
+
+        QString out;
+        out.reserve(line.length());
+
+        int i = 0;
+        while (i < line.length()) {
+            if (line.at(i) != ' ' || (leadingOnly && i > 0)) {
+                out.append(line.at(i));
+                i++;
+                continue;
+            }
+
+            int len = 0;
+            while (i + len < line.length() && line.at(i + len) == ' ')
+                len++;
+            i += len;
+
+            // The first tab only goes up to the next tab stop
+            const int leading = tabSize - (out.length() % tabSize);
+            if (len >= leading) {
+                out.append('\t');
+                len -= leading;
+            }
+
+            while (len >= tabSize) {
+                out.append('\t');
+                len -= tabSize;
+            }
+
+            // What's left can't make a whole tab
+            out.append(QString(len, ' '));
+        }
+
+        return out;
+    }
+
+}
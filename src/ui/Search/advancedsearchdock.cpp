@@ -15,6 +15,7 @@
 #include <QFormLayout>
 #include <QFrame>
 #include <QHBoxLayout>
+#include <QInputDialog>
 #include <QLabel>
 #include <QLayout>
 #include <QLineEdit>
@@ -362,28 +363,50 @@ QWidget* AdvancedSearchDock::buildSearchPanelWidget() {
     m_chkUseRegex = new QCheckBox(tr("Use Regular Expressions"));
     m_chkUseSpecialChars = new QCheckBox(tr("Use Special Characters ('\\t', '\\n', ...)"));
     m_chkUseSpecialChars->setToolTip(tr("If set, character sequences like '\\t' will be replaced by their respective special characters."));
+    m_chkMultiTerm = new QCheckBox(tr("Search for a List of Terms"));
+    m_chkMultiTerm->setToolTip(tr("If set, every line of the search string is a term of its own, and all of them are searched for at once."));
     m_chkIncludeSubdirs = new QCheckBox(tr("Include Subdirectories"));
     m_chkIncludeSubdirs->setChecked(true);
+    m_chkUseIndex = new QCheckBox(tr("Index Searched Directories"));
+    m_chkUseIndex->setToolTip(tr("If set, the contents of the directories searched are remembered, so that searching them again only reads the files that can match."));
+    m_chkUseIndex->setChecked(settings.Search.getUseSearchIndex());
 
     m_chkMatchCase->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkMatchWords->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkUseRegex->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkUseSpecialChars->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
+    m_chkMultiTerm->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
     m_chkIncludeSubdirs->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
+    m_chkUseIndex->setSizePolicy(QSizePolicy::Fixed,QSizePolicy::Fixed);
 
     QGridLayout* mini = new QGridLayout;
     mini->addWidget(m_chkMatchCase, 0, 0);
     mini->addWidget(m_chkMatchWords, 1, 0);
     mini->addWidget(m_chkUseRegex, 2, 0);
     mini->addWidget(m_chkUseSpecialChars, 3, 0);
-    mini->addWidget(makeDivider(QFrame::HLine, 180), 4, 0);
-    mini->addWidget(m_chkIncludeSubdirs, 5, 0);
-    mini->addItem(new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding), 6, 0);
+    mini->addWidget(m_chkMultiTerm, 4, 0);
+    mini->addWidget(makeDivider(QFrame::HLine, 180), 5, 0);
+    mini->addWidget(m_chkIncludeSubdirs, 6, 0);
+    mini->addWidget(m_chkUseIndex, 7, 0);
+    mini->addItem(new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding), 8, 0);
 
     QLabel* regexInfo = new QLabel("(<a href='info'>?</a>)");
     QObject::connect(regexInfo, &QLabel::linkActivated, &showRegexInfo);
     mini->addWidget(regexInfo, 2, 1);
 
+    // The search box only holds one line: the list of terms is edited in a dialog
+    QLabel* editTerms = new QLabel(QString("(<a href='edit'>%1</a>)").arg(tr("Edit")));
+    QObject::connect(editTerms, &QLabel::linkActivated, [this](){
+        bool ok;
+        const QString terms = QInputDialog::getMultiLineText(QApplication::activeWindow(), tr("Search for a List of Terms"),
+                                                             tr("One term per line:"), m_cmbSearchTerm->currentText(), &ok);
+        if (ok) {
+            m_cmbSearchTerm->setCurrentText(terms);
+            m_chkMultiTerm->setChecked(true);
+        }
+    });
+    mini->addWidget(editTerms, 4, 1);
+
     gl->addWidget(srl, 0,0);
     gl->addWidget(scl, 1,0);
     gl->addWidget(srd, 2,0);
@@ -505,6 +528,7 @@ void AdvancedSearchDock::onChangeSearchScope(int index)
         m_btnSelectSearchDirectory->setEnabled(false);
         m_btnSelectCurrentDirectory->setEnabled(false);
         m_chkIncludeSubdirs->setVisible(false);
+        m_chkUseIndex->setVisible(false);
         break;
     case 2: // Search in file system
         m_cmbSearchPattern->setEnabled(true);
@@ -512,6 +536,7 @@ void AdvancedSearchDock::onChangeSearchScope(int index)
         m_btnSelectSearchDirectory->setEnabled(true);
         m_btnSelectCurrentDirectory->setEnabled(true);
         m_chkIncludeSubdirs->setVisible(true);
+        m_chkUseIndex->setVisible(true);
         break;
     }
     onUserInput();
@@ -542,16 +567,10 @@ void AdvancedSearchDock::onUserInput()
 
 void AdvancedSearchDock::updateSearchInProgressUi()
 {
-    // Some actions are only available when the search is finished
+    // The results can be browsed while they come in, but only replaced once they're all there
     const bool progress = m_currentSearchInstance->isSearchInProgress();
 
-    m_actExpandAll->setEnabled(!progress);
-    m_actCopyContents->setEnabled(!progress);
-    m_actShowFullLines->setEnabled(!progress);
     m_btnToggleReplaceOptions->setVisible(!progress);
-
-    m_btnPrevResult->setVisible(!progress);
-    m_btnNextResult->setVisible(!progress);
 }
 
 void AdvancedSearchDock::startReplace()
@@ -608,7 +627,10 @@ SearchConfig AdvancedSearchDock::getConfigFromInputs()
         config.searchMode = SearchConfig::ModePlainTextSpecialChars;
     else if (m_chkUseRegex->isChecked())
         config.searchMode = SearchConfig::ModeRegex;
+    else if (m_chkMultiTerm->isChecked())
+        config.searchMode = SearchConfig::ModeMultiTerm;
     config.includeSubdirs = m_chkIncludeSubdirs->isChecked();
+    config.useIndex = m_chkUseIndex->isChecked();
     config.targetWindow = m_mainWindow;
 
     return config;
@@ -625,7 +647,9 @@ void AdvancedSearchDock::setInputsFromConfig(const SearchConfig& config)
     m_chkMatchWords->setChecked(config.matchWord);
     m_chkUseRegex->setChecked(config.searchMode == SearchConfig::ModeRegex);
     m_chkUseSpecialChars->setChecked(config.searchMode == SearchConfig::ModePlainTextSpecialChars);
+    m_chkMultiTerm->setChecked(config.searchMode == SearchConfig::ModeMultiTerm);
     m_chkIncludeSubdirs->setChecked(config.includeSubdirs);
+    m_chkUseIndex->setChecked(config.useIndex);
 }
 
 void AdvancedSearchDock::onSearchHistorySizeChange()
@@ -729,11 +753,24 @@ AdvancedSearchDock::AdvancedSearchDock(MainWindow* mainWindow)
     });
     connect(m_chkUseRegex, &QCheckBox::toggled, [this](bool checked){
         m_chkUseSpecialChars->setEnabled(!checked);
+        m_chkMultiTerm->setEnabled(!checked);
         if(checked) m_chkUseSpecialChars->setChecked(false);
+        if(checked) m_chkMultiTerm->setChecked(false);
     });
     connect(m_chkUseSpecialChars, &QCheckBox::toggled, [this](bool checked){
         m_chkUseRegex->setEnabled(!checked);
+        m_chkMultiTerm->setEnabled(!checked);
         if(checked) m_chkUseRegex->setChecked(false);
+        if(checked) m_chkMultiTerm->setChecked(false);
+    });
+    connect(m_chkMultiTerm, &QCheckBox::toggled, [this](bool checked){
+        m_chkUseRegex->setEnabled(!checked);
+        m_chkUseSpecialChars->setEnabled(!checked);
+        if(checked) m_chkUseRegex->setChecked(false);
+        if(checked) m_chkUseSpecialChars->setChecked(false);
+    });
+    connect(m_chkUseIndex, &QCheckBox::toggled, [](bool checked){
+        NqqSettings::getInstance().Search.setUseSearchIndex(checked);
     });
 
     // "More Options" menu connections
@@ -857,6 +894,8 @@ void AdvancedSearchDock::startSearch(SearchConfig cfg)
 {
     if (cfg.searchString.isEmpty())
         return;
+    if (cfg.searchMode == SearchConfig::ModeMultiTerm && cfg.getTerms().isEmpty())
+        return;
 
     const SearchConfig::SearchScope scope = cfg.searchScope;
 
@@ -884,7 +923,9 @@ void AdvancedSearchDock::startSearch(SearchConfig cfg)
 
     m_searchInstances.push_back( std::unique_ptr<SearchInstance>(new SearchInstance(cfg)) );
 
-    m_cmbSearchHistory->addItem( cfg.getScopeAsString() + ": \"" + cfg.searchString + "\"" );
+    const QString searchText = (cfg.searchMode == SearchConfig::ModeMultiTerm) ?
+                cfg.getTerms().join("\", \"") : cfg.searchString;
+    m_cmbSearchHistory->addItem( cfg.getScopeAsString() + ": \"" + searchText + "\"" );
     m_cmbSearchHistory->setCurrentIndex( m_cmbSearchHistory->count()-1 );
 
     onSearchHistorySizeChange();
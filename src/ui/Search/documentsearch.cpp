@@ -0,0 +1,486 @@
+#include "include/Search/documentsearch.h"
+
+#include <QEventLoop>
+
+#ifdef QT_DEBUG
+#include <QDebug>
+#include <QElapsedTimer>
+#endif
+
+#include <algorithm>
+
+using EditorNS::Editor;
+
+// Enough for any screen: it only matters for long lines with lots of matches
+const int DocumentSearch::MAX_HIGHLIGHTS = 2000;
+const int DocumentSearch::HIGHLIGHT_DELAY = 20;
+
+DocumentSearch::DocumentSearch(Editor *editor, QObject *parent) :
+    QObject(parent),
+    m_editor(editor)
+{
+    m_selection.from.line = m_selection.from.column = 0;
+    m_selection.to = m_selection.from;
+
+    // Scrolling and typing send lots of events: highlight once they settle
+    m_highlightTimer.setSingleShot(true);
+    m_highlightTimer.setInterval(HIGHLIGHT_DELAY);
+    connect(&m_highlightTimer, &QTimer::timeout, this, &DocumentSearch::sendHighlights);
+
+    connect(editor, &Editor::messageReceived, this, &DocumentSearch::onMessageReceived);
+    requestSnapshot();
+}
+
+DocumentSearch::~DocumentSearch()
+{
+    if (m_editor) {
+        m_editor->asyncSendMessageWithResultP("C_CMD_STOP_SEARCH_TRACKING");
+    }
+}
+
+Editor *DocumentSearch::editor() const
+{
+    return m_editor;
+}
+
+bool DocumentSearch::setPattern(const QString &regex, bool caseSensitive)
+{
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (!caseSensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+
+    if (regex == m_regex.pattern() && options == m_regex.patternOptions())
+        return m_regex.isValid();
+
+    m_regex = QRegularExpression(regex, options);
+    m_regex.optimize();
+
+    // The same test CodeMirror's search cursor uses to tell whether a regex
+    // might match across lines.
+    static const QRegularExpression spansLines("\\\\s|\\\\n|\\n|\\\\W|\\\\D|\\[\\^");
+    m_spansLines = spansLines.match(regex).hasMatch();
+
+    rescan();
+    emit matchesChanged();
+    m_highlightTimer.start();
+
+    return m_regex.isValid();
+}
+
+QString DocumentSearch::pattern() const
+{
+    return m_regex.pattern();
+}
+
+bool DocumentSearch::isValid() const
+{
+    return m_regex.isValid();
+}
+
+bool DocumentSearch::caseSensitive() const
+{
+    return !m_regex.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption);
+}
+
+bool DocumentSearch::isReady() const
+{
+    return m_ready;
+}
+
+void DocumentSearch::waitUntilReady()
+{
+    if (m_ready || !m_editor)
+        return;
+
+    QEventLoop loop;
+    connect(this, &DocumentSearch::ready, &loop, &QEventLoop::quit);
+    connect(m_editor, &QObject::destroyed, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+int DocumentSearch::matchCount() const
+{
+    return m_matches.size();
+}
+
+int DocumentSearch::currentMatch() const
+{
+    const int from = offsetOf(m_selection.from);
+    const int to = offsetOf(m_selection.to);
+    if (from < 0 || to <= from)
+        return -1;
+
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), from,
+                               [](const Match &m, int offset) { return m.start < offset; });
+
+    if (it != m_matches.cend() && it->start == from && it->length == to - from)
+        return it - m_matches.cbegin();
+
+    return -1;
+}
+
+int DocumentSearch::findNext(bool forward, Origin origin)
+{
+    waitUntilReady();
+
+    if (m_matches.isEmpty() || !m_editor)
+        return -1;
+
+    int index;
+
+    if (origin == DocumentStart) {
+        index = forward ? 0 : m_matches.size() - 1;
+    } else if (forward) {
+        const Editor::Cursor &cursor = origin == SelectionStart ? m_selection.from : m_selection.to;
+        const int offset = qMax(0, offsetOf(cursor));
+
+        // The first match that starts after the cursor
+        index = std::lower_bound(m_matches.cbegin(), m_matches.cend(), offset,
+                                 [](const Match &m, int value) { return m.start < value; })
+                - m_matches.cbegin();
+
+        if (index == m_matches.size())
+            index = 0;
+    } else {
+        int offset = offsetOf(m_selection.from);
+        if (offset < 0)
+            offset = m_text.size();
+
+        // The last match that ends before the cursor. The matches don't
+        // overlap, so they are sorted by their end too.
+        index = std::partition_point(m_matches.cbegin(), m_matches.cend(),
+                                     [offset](const Match &m) { return m.start + m.length <= offset; })
+                - m_matches.cbegin() - 1;
+
+        if (index < 0)
+            index = m_matches.size() - 1;
+    }
+
+    const Match &match = m_matches[index];
+    const Editor::Cursor start = cursorAt(match.start);
+    const Editor::Cursor end = cursorAt(match.start + match.length);
+
+    if (forward)
+        m_editor->setSelection(start.line, start.column, end.line, end.column);
+    else
+        m_editor->setSelection(end.line, end.column, start.line, start.column);
+
+    // Don't wait for the page to report the new selection: the next
+    // findNext() might come first.
+    m_selection.from = start;
+    m_selection.to = end;
+    emit matchesChanged();
+
+    return index;
+}
+
+int DocumentSearch::selectAll()
+{
+    waitUntilReady();
+
+    if (m_matches.isEmpty() || !m_editor)
+        return 0;
+
+    QList<Editor::Selection> selections;
+    selections.reserve(m_matches.size());
+
+    for (const Match &match : m_matches) {
+        Editor::Selection sel;
+        sel.from = cursorAt(match.start);
+        sel.to = cursorAt(match.start + match.length);
+        selections.append(sel);
+    }
+
+    m_editor->setSelections(selections);
+    return m_matches.size();
+}
+
+bool DocumentSearch::hasPattern() const
+{
+    return m_regex.isValid() && !m_regex.pattern().isEmpty();
+}
+
+void DocumentSearch::requestSnapshot()
+{
+    if (m_snapshotPending || !m_editor)
+        return;
+
+    m_ready = false;
+    m_snapshotPending = true;
+
+    QPointer<DocumentSearch> self(this);
+    m_editor->asyncSendMessageWithResultP("C_FUN_START_SEARCH_TRACKING").then([self](QVariant result) {
+        if (self) {
+            self->onSnapshotReceived(result.toMap());
+        }
+    });
+}
+
+void DocumentSearch::onSnapshotReceived(const QVariantMap &snapshot)
+{
+    m_snapshotPending = false;
+    m_text = snapshot.value("text").toString();
+    m_seq = snapshot.value("seq").toLongLong();
+    m_selection = selectionFromData(snapshot.value("selection").toList());
+
+    const QVariantList viewport = snapshot.value("viewport").toList();
+    if (viewport.size() == 2) {
+        m_viewportFrom = viewport[0].toInt();
+        m_viewportTo = viewport[1].toInt();
+    }
+
+    rebuildLineStarts();
+    rescan();
+    m_ready = true;
+
+    // The changes that arrived before the snapshot. Those already part of it
+    // are skipped by processChange().
+    const QList<QVariantMap> pending = m_pendingChanges;
+    m_pendingChanges.clear();
+    for (const QVariantMap &change : pending) {
+        processChange(change);
+    }
+
+    if (m_ready) {
+        emit ready();
+        emit matchesChanged();
+        m_highlightTimer.start();
+    }
+}
+
+void DocumentSearch::onMessageReceived(QString msg, QVariant data)
+{
+    if (msg == "J_EVT_SEARCH_CHANGE") {
+        processChange(data.toMap());
+        if (m_ready) {
+            emit matchesChanged();
+            m_highlightTimer.start();
+        }
+    } else if (msg == "J_EVT_SEARCH_VIEWPORT") {
+        const QVariantList viewport = data.toList();
+        if (viewport.size() == 2) {
+            m_viewportFrom = viewport[0].toInt();
+            m_viewportTo = viewport[1].toInt();
+            m_highlightTimer.start();
+        }
+    } else if (msg == "J_EVT_SEARCH_SELECTION") {
+        m_selection = selectionFromData(data.toList());
+        emit matchesChanged();
+    }
+}
+
+void DocumentSearch::processChange(const QVariantMap &change)
+{
+    if (!m_ready) {
+        m_pendingChanges.append(change);
+        return;
+    }
+
+    const qint64 seq = change.value("seq").toLongLong();
+    if (seq <= m_seq)
+        return;
+
+    // A missing change, or one that doesn't fit the text we have, means that
+    // the copy can't be trusted anymore.
+    if (seq != m_seq + 1 || change.value("resync").toBool() || !applyChange(change)) {
+        requestSnapshot();
+        return;
+    }
+
+    m_seq = seq;
+}
+
+bool DocumentSearch::applyChange(const QVariantMap &change)
+{
+    const QVariantList from = change.value("from").toList();
+    const QVariantList to = change.value("to").toList();
+    if (from.size() != 2 || to.size() != 2)
+        return false;
+
+    const int fromLine = from[0].toInt();
+    const int toLine = to[0].toInt();
+    const int start = offsetOf(fromLine, from[1].toInt());
+    const int end = offsetOf(toLine, to[1].toInt());
+    if (start < 0 || end < start)
+        return false;
+
+    const QString text = change.value("text").toString();
+    const int delta = text.size() - (end - start);
+
+    m_text.replace(start, end - start, text);
+
+    // Replace the starts of the lines after fromLine, up to toLine, with those
+    // of the inserted lines, and move the following ones.
+    QVector<int> inserted;
+    for (int i = text.indexOf('\n'); i != -1; i = text.indexOf('\n', i + 1)) {
+        inserted.append(start + i + 1);
+    }
+
+    m_lineStarts.erase(m_lineStarts.begin() + fromLine + 1, m_lineStarts.begin() + toLine + 1);
+    m_lineStarts.insert(fromLine + 1, inserted.size(), 0);
+    std::copy(inserted.cbegin(), inserted.cend(), m_lineStarts.begin() + fromLine + 1);
+    for (int i = fromLine + 1 + inserted.size(); i < m_lineStarts.size(); i++) {
+        m_lineStarts[i] += delta;
+    }
+
+    if (!hasPattern())
+        return true;
+
+    if (m_spansLines) {
+        rescan();
+        return true;
+    }
+
+    // The matches can't span lines: search again only the lines touched by
+    // the change, and move the matches that follow them.
+    const int windowStart = m_lineStarts[fromLine];
+    int windowEnd = m_text.indexOf('\n', start + text.size());
+    if (windowEnd == -1)
+        windowEnd = m_text.size();
+    const int oldWindowEnd = windowEnd - delta;
+
+    auto byStart = [](const Match &m, int offset) { return m.start < offset; };
+    const int first = std::lower_bound(m_matches.cbegin(), m_matches.cend(), windowStart, byStart)
+                      - m_matches.cbegin();
+    const int last = std::lower_bound(m_matches.cbegin() + first, m_matches.cend(), oldWindowEnd, byStart)
+                     - m_matches.cbegin();
+
+    QVector<Match> found;
+    scan(windowStart, windowEnd, found);
+
+    for (int i = last; i < m_matches.size(); i++) {
+        m_matches[i].start += delta;
+    }
+
+    if (found.size() != last - first) {
+        m_matches.erase(m_matches.begin() + first, m_matches.begin() + last);
+        m_matches.insert(first, found.size(), Match());
+    }
+    std::copy(found.cbegin(), found.cend(), m_matches.begin() + first);
+
+    return true;
+}
+
+void DocumentSearch::rebuildLineStarts()
+{
+    m_lineStarts.clear();
+    m_lineStarts.append(0);
+
+    for (int i = m_text.indexOf('\n'); i != -1; i = m_text.indexOf('\n', i + 1)) {
+        m_lineStarts.append(i + 1);
+    }
+}
+
+void DocumentSearch::rescan()
+{
+    m_matches.clear();
+
+    if (!hasPattern())
+        return;
+
+#ifdef QT_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    scan(0, m_text.size(), m_matches);
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Indexed %1 matches of \"%2\" in %3 msec")
+                .arg(m_matches.size())
+                .arg(m_regex.pattern())
+                .arg(timer.elapsed()).toStdString().c_str();
+#endif
+}
+
+void DocumentSearch::scan(int from, int to, QVector<Match> &out) const
+{
+    // The window always starts and ends at line boundaries, so anchors and
+    // word boundaries work as they would on the whole text.
+    QRegularExpressionMatchIterator it = m_regex.globalMatch(m_text.midRef(from, to - from));
+
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+
+        // Empty matches (e.g. "^") can be neither selected nor highlighted
+        if (match.capturedLength() > 0) {
+            Match m;
+            m.start = from + match.capturedStart();
+            m.length = match.capturedLength();
+            out.append(m);
+        }
+    }
+}
+
+void DocumentSearch::sendHighlights()
+{
+    if (!m_editor || !m_ready)
+        return;
+
+    QVariantList ranges;
+
+    if (m_viewportFrom >= 0 && m_viewportFrom < m_lineStarts.size()) {
+        const int from = m_lineStarts[m_viewportFrom];
+        const int to = m_viewportTo < m_lineStarts.size() ? m_lineStarts[m_viewportTo] : m_text.size();
+
+        // The first match that ends within the viewport
+        auto it = std::partition_point(m_matches.cbegin(), m_matches.cend(),
+                                       [from](const Match &m) { return m.start + m.length <= from; });
+
+        for (int n = 0; it != m_matches.cend() && it->start < to && n < MAX_HIGHLIGHTS; ++it, ++n) {
+            const Editor::Cursor start = cursorAt(it->start);
+            const Editor::Cursor end = cursorAt(it->start + it->length);
+            ranges << start.line << start.column << end.line << end.column;
+        }
+    }
+
+    QVariantMap data;
+    data.insert("seq", m_seq);
+    data.insert("ranges", ranges);
+    m_editor->asyncSendMessageWithResultP("C_CMD_SET_SEARCH_HIGHLIGHTS", data);
+}
+
+int DocumentSearch::offsetOf(int line, int column) const
+{
+    if (line < 0 || line >= m_lineStarts.size() || column < 0)
+        return -1;
+
+    const int lineStart = m_lineStarts[line];
+    const int lineEnd = line + 1 < m_lineStarts.size() ? m_lineStarts[line + 1] - 1 : m_text.size();
+    if (column > lineEnd - lineStart)
+        return -1;
+
+    return lineStart + column;
+}
+
+int DocumentSearch::offsetOf(const Editor::Cursor &cursor) const
+{
+    return offsetOf(cursor.line, cursor.column);
+}
+
+Editor::Cursor DocumentSearch::cursorAt(int offset) const
+{
+    const int line = std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), offset)
+                     - m_lineStarts.cbegin() - 1;
+
+    Editor::Cursor cursor;
+    cursor.line = line;
+    cursor.column = offset - m_lineStarts[line];
+    return cursor;
+}
+
+Editor::Selection DocumentSearch::selectionFromData(const QVariantList &data)
+{
+    Editor::Selection sel;
+    sel.from.line = sel.from.column = 0;
+    sel.to = sel.from;
+
+    if (data.size() == 4) {
+        sel.from.line = data[0].toInt();
+        sel.from.column = data[1].toInt();
+        sel.to.line = data[2].toInt();
+        sel.to.column = data[3].toInt();
+    }
+
+    return sel;
+}
@@ -75,9 +75,9 @@ void FileReplacer::replaceAll(const DocResult& doc, QString& content, const QStr
             }
 
             // backreference itself
-            len = result.regexMatch.capturedLength(backReference.num);
+            len = doc.capturedLength(result, backReference.num);
             if (len > 0) {
-                chunks << copy.midRef(result.regexMatch.capturedStart(backReference.num),
+                chunks << copy.midRef(doc.capturedStart(result, backReference.num),
                                       len);
                 newLength += len;
             }
@@ -1,11 +1,22 @@
 #include "include/Search/filesearcher.h"
 
+#include "include/Search/linecounter.h"
+#include "include/Search/literalmatcher.h"
 #include "include/Search/searchstring.h"
+#include "include/Search/trigramindex.h"
+#include "include/Search/utf8search.h"
 #include "include/docengine.h"
 
 #include <QDirIterator>
+#include <QElapsedTimer>
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 
@@ -33,50 +44,167 @@ bool matchesWholeWord(int index, int matchLength, const QString &data)
 }
 
 /**
- * @brief getLinePositions Returns a vector with the positions of all line beginnings of the given string.
+ * @brief FileTask A file to search, and whether the trigram index has to learn its contents.
  */
-std::vector<int> getLinePositions(const QString &data)
-{
-    const int dataSize = data.size();
-    std::vector<int> linePosition;
+struct FileTask {
+    QString path;
+    bool reindex;
+};
 
-    linePosition.push_back(0);
+/**
+ * @brief FileQueue Hands out the files to search to a number of workers, while they're still being
+ *                  discovered. Every worker has its own queue, and takes files from its front. A
+ *                  worker that runs out of files steals half of the files left at the back of the
+ *                  longest queue, so that all of them stay busy until the very end no matter how
+ *                  long each file takes.
+ *
+ *                  The queue holds at most 'capacity' files: push() waits for the workers to
+ *                  catch up, so that the traversal can't run away with the memory. Both ends give
+ *                  up waiting as soon as 'stop' is set.
+ */
+class FileQueue {
+public:
+    FileQueue(int workerCount, int capacity, const std::atomic<bool>& stop)
+        : m_queues(workerCount),
+          m_capacity(capacity),
+          m_stop(stop) {}
+
+    /**
+     * @brief push Adds a file. Neighbouring files go to the same worker in blocks, since they
+     *             are likely to be in the same directory.
+     * @return False if the search has been stopped while waiting for room in the queue.
+     */
+    bool push(FileTask&& file) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_size >= m_capacity) {
+                if (m_stop)
+                    return false;
+                m_space.wait_for(lock, WAIT_INTERVAL);
+            }
+            m_size++;
+        }
 
-    // Finds line-breaks in the string. Doesn't check the last char so the loop
-    // can be optimized.
-    for (int i = 0; i < dataSize-1; i++) {
-        if (data[i] == '\r' && data[i+1] == '\n') {
-            linePosition.push_back(i+2);
-            i++;
-        } else if (data[i] == '\r' || data[i] == '\n') {
-            linePosition.push_back(i+1);
+        Queue& q = m_queues[(m_pushed++ / BLOCK_SIZE) % m_queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.files.push_back(std::move(file));
         }
+        m_available.notify_one();
+        return true;
     }
-    
-    // Check the last char manually
-    if (dataSize > 0 && (*data.end() == '\r' || *data.end() == '\n'))
-        linePosition.push_back(dataSize);
-    
 
-    linePosition.push_back(dataSize);
-    return linePosition;
-}
+    /**
+     * @brief close Signals that no more files will be pushed.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_available.notify_all();
+    }
 
-/**
- * @brief trimEnd Returns the string with all whitespace trimmed from the end.
- *                Taken from the QString source code.
- */
-QString trimEnd(const QString& str) {
-    const QChar *begin = str.cbegin();
-    const QChar *end = str.cend();
+    /**
+     * @brief pop Takes the next file for the given worker, waiting for one if the
+     *            queue is still open.
+     * @return False when there are no files left, or the search has been stopped.
+     */
+    bool pop(int worker, FileTask& file) {
+        while (!m_stop) {
+            if (popOwn(worker, file) || steal(worker, file)) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_size--;
+                }
+                m_space.notify_one();
+                return true;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_closed && m_size == 0)
+                return false;
+            // Another worker may have just taken the last file, and is about to update m_size.
+            m_available.wait_for(lock, WAIT_INTERVAL);
+        }
+        return false;
+    }
 
-    while (begin < end && end[-1].isSpace())
-        end--;
+private:
+    static const int BLOCK_SIZE = 16;
+    static constexpr std::chrono::milliseconds WAIT_INTERVAL{10};
 
-    return QString(begin,end-begin);
-}
+    struct Queue {
+        std::mutex mutex;
+        std::deque<FileTask> files;
+    };
+
+    bool popOwn(int worker, FileTask& file) {
+        Queue& q = m_queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.files.empty())
+            return false;
+        file = std::move(q.files.front());
+        q.files.pop_front();
+        return true;
+    }
+
+    bool steal(int worker, FileTask& file) {
+        // Find the victim with the most work left. The sizes may change in the meantime,
+        // that's fine.
+        int victim = -1;
+        size_t victimSize = 0;
+        for (int i = 0; i < static_cast<int>(m_queues.size()); i++) {
+            if (i == worker) continue;
+            std::lock_guard<std::mutex> lock(m_queues[i].mutex);
+            if (m_queues[i].files.size() > victimSize) {
+                victim = i;
+                victimSize = m_queues[i].files.size();
+            }
+        }
+
+        if (victim == -1)
+            return false;
+
+        std::deque<FileTask> stolen;
+        {
+            std::lock_guard<std::mutex> lock(m_queues[victim].mutex);
+            std::deque<FileTask>& files = m_queues[victim].files;
+            const size_t count = (files.size() + 1) / 2;
+            stolen.assign(std::make_move_iterator(files.end() - count), std::make_move_iterator(files.end()));
+            files.erase(files.end() - count, files.end());
+        }
+
+        if (stolen.empty())
+            return false;
+
+        file = std::move(stolen.front());
+        stolen.pop_front();
+
+        Queue& q = m_queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.files.insert(q.files.end(), std::make_move_iterator(stolen.begin()), std::make_move_iterator(stolen.end()));
+        return true;
+    }
+
+    std::vector<Queue> m_queues;
+    const int m_capacity;
+    const std::atomic<bool>& m_stop;
+    size_t m_pushed = 0;
 
-const int MatchResult::CUTOFF_LENGTH = 60;
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::condition_variable m_space;
+    int m_size = 0;     // Files pushed and not popped yet
+    bool m_closed = false;
+};
+
+constexpr std::chrono::milliseconds FileQueue::WAIT_INTERVAL;
+
+const int FileSearcher::QUEUE_CAPACITY = 4096;
+const int FileSearcher::BATCH_INTERVAL = 50;
+const int FileSearcher::BATCH_MATCHES = 500;
+const int FileSearcher::REGEX_CACHE_SIZE = 16;
 
 FileSearcher::FileSearcher(const SearchConfig& config)
     : QThread(nullptr),
@@ -90,7 +218,8 @@ FileSearcher* FileSearcher::prepareAsyncSearch(const SearchConfig& config)
 
 QRegularExpression FileSearcher::createRegexFromConfig(const SearchConfig& config)
 {
-    QRegularExpression regex;
+    static std::mutex cacheMutex;
+    static QHash<QString, QRegularExpression> cache;
 
     const QFlags<QRegularExpression::PatternOption> options = config.matchCase ?
                 QRegularExpression::MultilineOption :
@@ -99,8 +228,20 @@ QRegularExpression FileSearcher::createRegexFromConfig(const SearchConfig& confi
     const QString regexString = config.matchWord ?
                 "\\b" + config.searchString + "\\b" : config.searchString;
 
-    regex.setPattern(regexString);
-    regex.setPatternOptions(options);
+    // Copies share the compiled pattern
+    const QString key = QString::number(static_cast<int>(options)) + ':' + regexString;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd())
+        return it.value();
+
+    if (cache.size() >= REGEX_CACHE_SIZE)
+        cache.clear();
+
+    QRegularExpression regex(regexString, options);
+    regex.optimize();
+    cache.insert(key, regex);
 
     return regex;
 }
@@ -110,29 +251,42 @@ DocResult FileSearcher::searchPlainText(const SearchConfig& config, const QStrin
     DocResult results;
 
     const Qt::CaseSensitivity caseSense = config.matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    const std::vector<int> linePosition = getLinePositions(content);
     const QString searchString = (config.searchMode == SearchConfig::ModePlainTextSpecialChars) ?
                 SearchString::unescape(config.searchString) : config.searchString;
 
     const int matchLength = searchString.length();
+
+    // LiteralMatcher only folds ASCII letters. That's enough when the needle is ASCII, unless the
+    // text has the Kelvin sign or the long s, which fold to 'k' and 's'.
+    bool useMatcher = config.matchCase;
+    if (!useMatcher) {
+        useMatcher = std::all_of(searchString.begin(), searchString.end(), [](QChar c) { return c.unicode() < 0x80; });
+
+        const QString lower = searchString.toLower();
+        if (useMatcher && (lower.contains('k') || lower.contains('s')))
+            useMatcher = !content.contains(QChar(0x212A)) && !content.contains(QChar(0x017F));
+    }
+
+    const LiteralMatcher matcher = useMatcher ? LiteralMatcher(searchString, config.matchCase) : LiteralMatcher();
+    auto find = [&](int from) {
+        return matcher.isEmpty() ? content.indexOf(searchString, from, caseSense) : matcher.indexIn(content, from);
+    };
+
+    LineCounter lines(content);
     int offset = 0;
 
-    while ((offset = content.indexOf(searchString, offset, caseSense)) != -1) {
+    while ((offset = find(offset)) != -1) {
         if (config.matchWord && !matchesWholeWord(offset, matchLength, content)) {
             offset += matchLength;
             continue;
         }
 
-        // std::upper_bound returns an iterator to the first item greater than 'offset'. This is the line after the match.
-        // Substract 1 to get the line the match is on.
-        const auto it = std::upper_bound(linePosition.begin(), linePosition.end(), offset);
-        const int line = std::distance(linePosition.begin(), it);
-        const int lineStart = linePosition[line-1];
-        const int lineEnd = linePosition[line];
+        lines.moveTo(offset);
+        const int lineStart = lines.lineStart();
 
         MatchResult result;
-        result.lineNumber = line;
-        result.matchLineString = trimEnd(content.mid(lineStart, lineEnd-lineStart));
+        result.lineNumber = lines.line();
+        results.addLine(result, content.midRef(lineStart, lines.lineEnd()-lineStart));
         result.positionInFile = offset;
         result.positionInLine = offset - lineStart;
         result.matchLength = matchLength;
@@ -144,33 +298,60 @@ DocResult FileSearcher::searchPlainText(const SearchConfig& config, const QStrin
     return results;
 }
 
-DocResult FileSearcher::searchRegExp(const QRegularExpression& regex, const QString& content)
+DocResult FileSearcher::searchRegExp(const QRegularExpression& regex, const QString& content, const RegexPrefilter& prefilter)
 {
     DocResult results;
 
+    // Skip the text if it lacks a string every match contains
+    const bool prefiltered = prefilter.appliesTo(content);
+    if (prefiltered && !prefilter.canMatch(content))
+        return results;
+
+    LineCounter lines(content);
     int offset = 0;
-    std::vector<int> linePosition = getLinePositions(content);
+    const int captureCount = regex.captureCount();
 
     QRegularExpressionMatch match;
     for (;;) {
-        match = regex.match(content, offset);
+        // Only run the regular expression where a match can be
+        int regionEnd = content.size();
+        if (prefiltered) {
+            offset = prefilter.nextRegion(content, offset, regionEnd);
+            if (offset == -1)
+                break;
+        }
 
-        if (!match.hasMatch())
-            break;
+        // The text before the region is still there for lookbehinds
+        match = (regionEnd == content.size()) ?
+                    regex.match(content, offset) :
+                    regex.match(content.leftRef(regionEnd), offset);
+
+        if (!match.hasMatch()) {
+            if (regionEnd == content.size())
+                break;
+            offset = regionEnd;
+            continue;
+        }
 
         offset = match.capturedStart();
-        const auto it = std::upper_bound(linePosition.begin(), linePosition.end(), offset);
-        const int line = std::distance(linePosition.begin(), it);
-        const int lineStart = linePosition[line-1];
-        const int lineEnd = linePosition[line];
+        lines.moveTo(offset);
+        const int lineStart = lines.lineStart();
 
         MatchResult result;
-        result.lineNumber = line;
-        result.matchLineString = trimEnd(content.mid(lineStart, lineEnd-lineStart));
+        result.lineNumber = lines.line();
+        results.addLine(result, content.midRef(lineStart, lines.lineEnd()-lineStart));
         result.positionInFile = offset;
         result.positionInLine = offset - lineStart;
         result.matchLength = match.capturedLength();
-        result.regexMatch = match;
+
+        if (captureCount > 0) {
+            result.captureOffset = results.captures.size();
+            for (int i = 1; i <= captureCount; i++) {
+                results.captures.push_back(match.capturedStart(i));
+                results.captures.push_back(match.capturedLength(i));
+            }
+        }
+
         results.results.push_back(result);
 
         // Advance at least by one to avoit infinite loops when capturing
@@ -178,17 +359,218 @@ DocResult FileSearcher::searchRegExp(const QRegularExpression& regex, const QStr
         offset += std::max(1, result.matchLength);
     }
 
-    results.regexCaptureGroupCount = regex.captureCount();
+    results.regexCaptureGroupCount = captureCount;
 
     return results;
 }
 
+DocResult FileSearcher::searchMultiTerm(const MultiTermMatcher& matcher, bool matchWord, const QString& content)
+{
+    DocResult results;
+
+    if (matcher.isEmpty())
+        return results;
+
+    LineCounter lines(content);
+    int offset = 0;
+
+    for (;;) {
+        MultiTermMatcher::Match match = matcher.indexIn(content, offset);
+
+        if (match.position == -1)
+            break;
+
+        if (matchWord && !matchesWholeWord(match.position, match.length, content)) {
+            // A shorter term that starts at the same position may still be a whole word
+            MultiTermMatcher::Match word = matcher.shorterMatch(content, match);
+            while (word.position != -1 && !matchesWholeWord(word.position, word.length, content))
+                word = matcher.shorterMatch(content, word);
+
+            // Otherwise, one that starts later inside this match may be
+            if (word.position == -1) {
+                offset = match.position + 1;
+                continue;
+            }
+            match = word;
+        }
+
+        offset = match.position;
+        lines.moveTo(offset);
+        const int lineStart = lines.lineStart();
+
+        MatchResult result;
+        result.lineNumber = lines.line();
+        results.addLine(result, content.midRef(lineStart, lines.lineEnd()-lineStart));
+        result.positionInFile = offset;
+        result.positionInLine = offset - lineStart;
+        result.matchLength = match.length;
+        result.termIndex = match.term;
+        results.results.push_back(result);
+
+        offset += match.length;
+    }
+
+    return results;
+}
+
+DocResult FileSearcher::searchFile(const QString& fileName, bool reindex) const {
+    // Taken before reading, so that a change made in the meantime is noticed next time
+    qint64 modified = 0;
+    qint64 fileSize = 0;
+    if (reindex) {
+        const QFileInfo info(fileName);
+        modified = info.lastModified().toMSecsSinceEpoch();
+        fileSize = info.size();
+    }
+
+    QFile f(fileName);
+    if (!f.open(QFile::ReadOnly)) {
+        // File could not be read. We'll ignore this error since it should never happen. QDirIterator only iterates over
+        // readable files. But if it happens we can skip the rest, just in case.
+        return DocResult();
+    }
+
+    // Map the file instead of copying it, if possible
+    const char* data = nullptr;
+    qint64 size = f.size();
+    QByteArray buffer;
+
+    if (size > 0 && size <= std::numeric_limits<int>::max()) {
+        data = reinterpret_cast<const char*>(f.map(0, size));
+    }
+    if (data == nullptr) {
+        buffer = f.readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+    if (size > std::numeric_limits<int>::max()) {
+        return DocResult();
+    }
+
+    DocResult res;
+    bool searched = false;
+    const int utf8Start = Utf8Search::utf8Payload(data, size);
+
+    if (utf8Start >= 0 && m_utf8Search.isValid()) {
+        // Plain text in a UTF-8 file: search the bytes, only decode the lines that match
+        searched = m_utf8Search.search(data + utf8Start, static_cast<int>(size) - utf8Start, res);
+    } else if (utf8Start >= 0 && m_searchConfig.searchMode == SearchConfig::ModeRegex) {
+        // No need to decode a UTF-8 file that can't match
+        searched = !m_regexPrefilter.canMatch(data + utf8Start, static_cast<int>(size) - utf8Start);
+    }
+
+    if (reindex && utf8Start >= 0)
+        m_index->update(fileName, modified, fileSize, data + utf8Start, static_cast<int>(size) - utf8Start);
+
+    if (!searched) {
+        QString text;
+        if (utf8Start >= 0) {
+            // No need for the encoding detection
+            text = QString::fromUtf8(data + utf8Start, static_cast<int>(size) - utf8Start);
+        } else {
+            text = DocEngine::decodeText(QByteArray::fromRawData(data, static_cast<int>(size))).text;
+
+            if (reindex) {
+                const QByteArray utf8 = text.toUtf8();
+                m_index->update(fileName, modified, fileSize, utf8.constData(), utf8.size());
+            }
+        }
+
+        switch (m_searchConfig.searchMode) {
+        case SearchConfig::ModePlainText:
+        case SearchConfig::ModePlainTextSpecialChars:
+            res = searchPlainText(m_searchConfig, text);
+            break;
+        case SearchConfig::ModeRegex:
+            res = searchRegExp(m_regex, text, m_regexPrefilter);
+            break;
+        case SearchConfig::ModeMultiTerm:
+            res = searchMultiTerm(m_multiTermMatcher, m_searchConfig.matchWord, text);
+            break;
+        }
+    }
+
+    if (!res.results.empty()) {
+        res.docType = DocResult::TypeFile;
+        res.fileName = fileName;
+
+        // Kept until the search is closed, so give back what the arrays grew by in advance
+        res.results.squeeze();
+        res.lines.squeeze();
+        res.captures.squeeze();
+    }
+
+    return res;
+}
+
+QVector<DocResult> FileSearcher::takeResultBatch() {
+    std::lock_guard<std::mutex> lock(m_batchMutex);
+
+    QVector<DocResult> batch;
+    batch.swap(m_batch);
+    m_batchMatches = 0;
+    m_batchSignaled = false;
+    return batch;
+}
+
+void FileSearcher::addResult(DocResult&& result) {
+    std::lock_guard<std::mutex> lock(m_batchMutex);
+
+    m_batchMatches += result.results.size();
+    m_batch.append(std::move(result));
+
+    if (m_batchMatches >= BATCH_MATCHES && !m_batchSignaled) {
+        m_batchSignaled = true;
+        emit resultBatchReady();
+    }
+}
+
+void FileSearcher::flushBatch() {
+    std::lock_guard<std::mutex> lock(m_batchMutex);
+
+    if (!m_batch.isEmpty() && !m_batchSignaled) {
+        m_batchSignaled = true;
+        emit resultBatchReady();
+    }
+}
+
 void FileSearcher::run() {
     if (m_searchConfig.searchMode == SearchConfig::ModeRegex) {
         m_regex = createRegexFromConfig(m_searchConfig);
-    } else if (m_searchConfig.searchMode == SearchConfig::ModePlainTextSpecialChars) {
-        m_searchConfig.searchString = SearchString::unescape(m_searchConfig.searchString);
+        m_regexPrefilter = RegexPrefilter(m_regex);
+    }
+
+    // searchPlainText() unescapes the string by itself
+    const QString searchString = (m_searchConfig.searchMode == SearchConfig::ModePlainTextSpecialChars) ?
+                SearchString::unescape(m_searchConfig.searchString) : m_searchConfig.searchString;
+
+    if (m_searchConfig.searchMode == SearchConfig::ModeMultiTerm) {
+        m_multiTermMatcher = MultiTermMatcher(m_searchConfig.getTerms(), m_searchConfig.matchCase);
+    } else if (m_searchConfig.searchMode != SearchConfig::ModeRegex) {
+        m_utf8Search = Utf8Search(searchString, m_searchConfig.matchCase, m_searchConfig.matchWord);
+    }
+
+    // Only the files that the index can't rule out are searched
+    TrigramIndex::Query query;
+    if (m_searchConfig.useIndex) {
+        switch (m_searchConfig.searchMode) {
+        case SearchConfig::ModePlainText:
+        case SearchConfig::ModePlainTextSpecialChars:
+            query = TrigramIndex::literalQuery(QStringList(searchString), m_searchConfig.matchCase);
+            break;
+        case SearchConfig::ModeRegex:
+            query = TrigramIndex::regexQuery(m_regex.pattern());
+            break;
+        case SearchConfig::ModeMultiTerm:
+            query = TrigramIndex::literalQuery(m_searchConfig.getTerms(), m_searchConfig.matchCase);
+            break;
+        }
+
+        if (!query.matchesAll())
+            m_index = TrigramIndex::forDirectory(m_searchConfig.directory);
     }
+    const QBitArray indexMatches = m_index ? m_index->match(query) : QBitArray();
+    QSet<QString> seen;     // The files found, relative to the directory
 
     const QFlags<QDirIterator::IteratorFlag> dirIteratorOptions = m_searchConfig.includeSubdirs ?
                 (QDirIterator::Subdirectories | QDirIterator::FollowSymlinks) :
@@ -199,53 +581,101 @@ void FileSearcher::run() {
     for (QString& item : filters)
         item = item.trimmed();
 
-    // Create a list of all files that will be read.
-    QDirIterator it(m_searchConfig.directory, filters, QDir::Files | QDir::Readable | QDir::Hidden, dirIteratorOptions);
-    QStringList fileList;
+    // The files are searched while the directory is still being walked: the workers start
+    // with the first file found.
+    const int workerCount = std::max(1, QThread::idealThreadCount());
+    FileQueue queue(workerCount, QUEUE_CAPACITY, m_wantToStop);
+
+    std::atomic<int> processed{0};
+    std::atomic<int> discovered{0};
+    std::atomic<bool> discoveryComplete{false};
+    std::vector<std::thread> workers;
+
+    // Lets this thread wait for the workers while it hands out the results found in the meantime
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    int runningWorkers = workerCount;
+
+    emit resultProgress(0, 0, false);
+
+    for (int w = 0; w < workerCount; w++) {
+        workers.emplace_back([&, w]() {
+            FileTask file;
+            while (queue.pop(w, file)) {
+                DocResult res = searchFile(file.path, file.reindex);
+                if (!res.results.empty())
+                    addResult(std::move(res));
+
+                const int count = ++processed;
+                if (count % 100 == 0)
+                    emit resultProgress(count, discovered, discoveryComplete);
+            }
+
+            std::lock_guard<std::mutex> lock(doneMutex);
+            runningWorkers--;
+            doneCondition.notify_one();
+        });
+    }
 
-    while (it.hasNext())
-        fileList << it.next();
+    QElapsedTimer batchTimer;
+    batchTimer.start();
 
-    const int listSize = fileList.size();
-    emit resultProgress(0, listSize);
+    QDirIterator it(m_searchConfig.directory, filters, QDir::Files | QDir::Readable | QDir::Hidden, dirIteratorOptions);
+    while (it.hasNext() && !m_wantToStop) {
+        FileTask task{it.next(), false};
 
-    // Start the actual search
-    int count = 0;
-    for (const auto& fileName : fileList) {
-        if (m_wantToStop)
-            break;
+        const int count = ++discovered;
+        if (count % 500 == 0)
+            emit resultProgress(processed, count, false);
 
-        if (++count % 100 == 0)
-            emit resultProgress(count, listSize);
+        if (batchTimer.hasExpired(BATCH_INTERVAL)) {
+            flushBatch();
+            batchTimer.restart();
+        }
 
-        QFile f(fileName);
-        DocEngine::DecodedText decodedText;
-        decodedText = DocEngine::readToString(&f);
-        f.close();
+        if (m_index) {
+            seen.insert(m_index->relativePath(task.path));
 
-        if (decodedText.error) {
-            // File could not be read. We'll ignore this error since it should never happen. QDirIterator only iterates over
-            // readable files and DocEngine only reads the file. But if it happens we can skip the rest, just in case.
-            continue;
+            const TrigramIndex::FileStatus status = m_index->check(task.path, it.fileInfo(), indexMatches);
+            if (status == TrigramIndex::FileStatus::Skip) {
+                ++processed;
+                continue;
+            }
+            task.reindex = (status == TrigramIndex::FileStatus::Reindex);
         }
 
-        DocResult res;
-        switch (m_searchConfig.searchMode) {
-        case SearchConfig::ModePlainText:
-        case SearchConfig::ModePlainTextSpecialChars:
-            res = searchPlainText(m_searchConfig, decodedText.text);
+        if (!queue.push(std::move(task)))
             break;
-        case SearchConfig::ModeRegex:
-            res = searchRegExp(m_regex, decodedText.text);
-            break;
-        }
+    }
+
+    // A complete walk tells which of the indexed files are gone
+    if (m_index && !m_wantToStop) {
+        const bool includeSubdirs = m_searchConfig.includeSubdirs;
+        m_index->removeMissing(seen, [&](const QString& path) {
+            if (!includeSubdirs && path.contains('/'))
+                return false;
+            return filters.isEmpty() || QDir::match(filters, path.mid(path.lastIndexOf('/') + 1));
+        });
+    }
+
+    discoveryComplete = true;
+    queue.close();
+    emit resultProgress(processed, discovered, true);
 
-        if (!res.results.empty()) {
-            res.docType = DocResult::TypeFile;
-            res.fileName = fileName;
-            m_searchResult.results.push_back(res);
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        while (runningWorkers > 0) {
+            doneCondition.wait_for(lock, std::chrono::milliseconds(BATCH_INTERVAL));
+            flushBatch();
         }
     }
 
+    for (std::thread& worker : workers)
+        worker.join();
+
+    // Whatever is left is collected after resultReady()
     emit resultReady();
+
+    if (m_index)
+        m_index->save();
 }
@@ -9,6 +9,7 @@
 #include <QFileDialog>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QThread>
 
 frmSearchReplace::frmSearchReplace(TopEditorContainer *topEditorContainer, QWidget *parent) :
@@ -56,6 +57,25 @@ frmSearchReplace::frmSearchReplace(TopEditorContainer *topEditorContainer, QWidg
 
     ui->chkShowAdvanced->toggled(ui->chkShowAdvanced->isChecked());
 
+    // Keep the number of matches up to date with the options and the current tab
+    const QList<QAbstractButton *> options {ui->chkMatchCase, ui->chkMatchWholeWord, ui->radSearchPlainText,
+                                           ui->radSearchWithRegex, ui->radSearchWithSpecialChars};
+    for (QAbstractButton *option : options) {
+        connect(option, &QAbstractButton::toggled, this, [this]() {
+            if (isVisible())
+                updatePattern();
+        });
+    }
+
+    connect(m_topEditorContainer, &TopEditorContainer::currentEditorChanged, this, [this]() {
+        if (isVisible()) {
+            updatePattern();
+        } else {
+            delete m_documentSearch;
+            m_documentSearch = nullptr;
+        }
+    });
+
     setCurrentTab(TabSearch);
 }
 
@@ -76,6 +96,16 @@ void frmSearchReplace::keyPressEvent(QKeyEvent *evt)
     }
 }
 
+void frmSearchReplace::hideEvent(QHideEvent *evt)
+{
+    // Stop following the document, and remove the highlights
+    delete m_documentSearch;
+    m_documentSearch = nullptr;
+    updateMatchCount();
+
+    QMainWindow::hideEvent(evt);
+}
+
 void frmSearchReplace::show(Tabs defaultTab)
 {
     setCurrentTab(defaultTab);
@@ -83,6 +113,7 @@ void frmSearchReplace::show(Tabs defaultTab)
     ui->cmbSearch->lineEdit()->selectAll();
     QMainWindow::show();
     manualSizeAdjust();
+    updatePattern();
 }
 
 void frmSearchReplace::setSearchText(QString string)
@@ -114,6 +145,64 @@ Editor *frmSearchReplace::currentEditor()
     return this->m_topEditorContainer->currentTabWidget()->currentEditor();
 }
 
+DocumentSearch *frmSearchReplace::documentSearch()
+{
+    Editor *editor = currentEditor();
+    if (m_documentSearch != nullptr && m_documentSearch->editor() == editor)
+        return m_documentSearch;
+
+    delete m_documentSearch;
+    m_documentSearch = nullptr;
+
+    if (editor != nullptr) {
+        m_documentSearch = new DocumentSearch(editor, this);
+        connect(m_documentSearch, &DocumentSearch::matchesChanged, this, &frmSearchReplace::updateMatchCount);
+    }
+
+    return m_documentSearch;
+}
+
+void frmSearchReplace::updatePattern()
+{
+    const QString string = ui->cmbSearch->currentText();
+
+    // Don't take a copy of the document until there's something to look for
+    if (string.isEmpty() && m_documentSearch == nullptr) {
+        updateMatchCount();
+        return;
+    }
+
+    DocumentSearch *documentSearch = this->documentSearch();
+    if (documentSearch == nullptr)
+        return;
+
+    SearchHelpers::SearchOptions searchOptions = searchOptionsFromUI();
+    QString rawSearch = string.isEmpty() ? QString() : SearchString::formatRegularExpression(string, searchModeFromUI(), searchOptions);
+    documentSearch->setPattern(rawSearch, searchOptions.MatchCase);
+    updateMatchCount();
+}
+
+void frmSearchReplace::updateMatchCount()
+{
+    if (m_documentSearch == nullptr || m_documentSearch->pattern().isEmpty()) {
+        ui->lblMatches->clear();
+    } else if (!m_documentSearch->isValid()) {
+        ui->lblMatches->setText(tr("Invalid regular expression"));
+    } else if (!m_documentSearch->isReady()) {
+        ui->lblMatches->setText(tr("Searching..."));
+    } else if (m_documentSearch->matchCount() == 0) {
+        ui->lblMatches->setText(tr("No matches"));
+    } else {
+        const int count = m_documentSearch->matchCount();
+        const int current = m_documentSearch->currentMatch();
+
+        if (current >= 0)
+            ui->lblMatches->setText(tr("Match %1 of %2").arg(current + 1).arg(count));
+        else
+            ui->lblMatches->setText(tr("%n match(es)", "", count));
+    }
+}
+
 QString frmSearchReplace::regexModifiersFromSearchOptions(SearchHelpers::SearchOptions searchOptions)
 {
     QString modifiers = "m";
@@ -125,19 +214,12 @@ QString frmSearchReplace::regexModifiersFromSearchOptions(SearchHelpers::SearchO
 
 void frmSearchReplace::search(QString string, SearchHelpers::SearchMode searchMode, bool forward, SearchHelpers::SearchOptions searchOptions) {
     if (!string.isEmpty()) {
-        QString rawSearch = SearchString::format(string, searchMode, searchOptions);
-
-        Editor *editor = currentEditor();
-
-        if (searchOptions.SearchFromStart) {
-            editor->setCursorPosition(0, 0);
-        }
+        QString rawSearch = SearchString::formatRegularExpression(string, searchMode, searchOptions);
 
-        QList<QVariant> data = QList<QVariant>();
-        data.append(rawSearch);
-        data.append(regexModifiersFromSearchOptions(searchOptions));
-        data.append(forward);
-        editor->sendMessage("C_FUN_SEARCH", QVariant::fromValue(data));
+        DocumentSearch *documentSearch = this->documentSearch();
+        documentSearch->setPattern(rawSearch, searchOptions.MatchCase);
+        documentSearch->findNext(forward, searchOptions.SearchFromStart ? DocumentSearch::DocumentStart
+                                                                        : DocumentSearch::AfterSelection);
     }
 }
 
@@ -175,18 +257,33 @@ int frmSearchReplace::replaceAll(QString string, QString replacement, SearchHelp
     data.append(regexModifiersFromSearchOptions(searchOptions));
     data.append(replacement);
 		data.append(QString::number(static_cast<int>(searchMode)));
-    QVariant count = currentEditor()->asyncSendMessageWithResult("C_FUN_REPLACE_ALL", QVariant::fromValue(data)).get();
+
+    Editor *editor = currentEditor();
+
+    // Only shows up if the replacement takes a while
+    QProgressDialog progress(tr("Replacing..."), QString(), 0, 100, this);
+    progress.setWindowTitle(tr("Replace all"));
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+
+    QMetaObject::Connection conn = connect(editor, &Editor::messageReceived, this, [&](QString msg, QVariant data) {
+        if (msg == "J_EVT_REPLACE_ALL_PROGRESS") {
+            progress.setValue(qRound(data.toDouble() * 100));
+        }
+    });
+
+    QVariant count = editor->asyncSendMessageWithResult("C_FUN_REPLACE_ALL", QVariant::fromValue(data)).get();
+
+    disconnect(conn);
     return count.toInt();
 }
 
 int frmSearchReplace::selectAll(QString string, SearchHelpers::SearchMode searchMode, SearchHelpers::SearchOptions searchOptions) {
-    QString rawSearch = SearchString::format(string, searchMode, searchOptions);
+    QString rawSearch = SearchString::formatRegularExpression(string, searchMode, searchOptions);
 
-    QList<QVariant> data = QList<QVariant>();
-    data.append(rawSearch);
-    data.append(regexModifiersFromSearchOptions(searchOptions));
-    QVariant count = currentEditor()->asyncSendMessageWithResult("C_FUN_SEARCH_SELECT_ALL", QVariant::fromValue(data)).get();
-    return count.toInt();
+    DocumentSearch *documentSearch = this->documentSearch();
+    documentSearch->setPattern(rawSearch, searchOptions.MatchCase);
+    return documentSearch->selectAll();
 }
 
 SearchHelpers::SearchMode frmSearchReplace::searchModeFromUI()
@@ -369,17 +466,13 @@ void frmSearchReplace::on_searchStringEdited(const QString &/*text*/)
 {
     NqqSettings& s = NqqSettings::getInstance();
 
-    if (s.Search.getSearchAsIType()) {
-        if (ui->actionFind->isChecked()) {
-            Editor *editor = currentEditor();
-
-            QList<Editor::Selection> selections = editor->selections();
-            if (selections.length() > 0) {
-                editor->setCursorPosition(
-                            std::min(selections[0].from, selections[0].to));
-            }
+    updatePattern();
 
-            findFromUI(true);
+    if (s.Search.getSearchAsIType()) {
+        if (ui->actionFind->isChecked() && m_documentSearch != nullptr && !m_documentSearch->pattern().isEmpty()) {
+            // Start from the beginning of the current match, so that it stays
+            // selected for as long as it keeps matching.
+            m_documentSearch->findNext(true, DocumentSearch::SelectionStart);
         }
     }
 
@@ -0,0 +1,73 @@
+#include "include/Search/linecounter.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define NQQ_LINECOUNTER_SSE2
+#include <emmintrin.h>
+#endif
+
+void LineCounter::moveTo(int position) {
+    if (position <= m_position)
+        return;
+
+    const ushort* s = m_text.utf16();
+    const int size = m_text.size();
+    const int startLine = m_line;
+    int i = m_position;
+
+#ifdef NQQ_LINECOUNTER_SSE2
+    const __m128i lf = _mm_set1_epi16('\n');
+    const __m128i cr = _mm_set1_epi16('\r');
+
+    for (; i + 16 <= position; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 8));
+
+        // One bit per character
+        const unsigned lfBits = static_cast<unsigned>(_mm_movemask_epi8(
+                                    _mm_packs_epi16(_mm_cmpeq_epi16(a, lf), _mm_cmpeq_epi16(b, lf))));
+        const unsigned crBits = static_cast<unsigned>(_mm_movemask_epi8(
+                                    _mm_packs_epi16(_mm_cmpeq_epi16(a, cr), _mm_cmpeq_epi16(b, cr))));
+        if ((lfBits | crBits) == 0)
+            continue;
+
+        // A '\r' followed by a '\n' doesn't end the line by itself: the '\n' does
+        const unsigned nextIsLf = (lfBits >> 1) | ((i + 16 < size && s[i + 16] == '\n') ? 0x8000u : 0u);
+        const unsigned breaks = lfBits | (crBits & ~nextIsLf);
+
+        if (breaks != 0) {
+            m_line += __builtin_popcount(breaks);
+            m_lineStart = i + (31 - __builtin_clz(breaks)) + 1;
+        }
+    }
+#endif
+
+    countScalar(i, position);
+    m_position = position;
+
+    if (m_line != startLine)
+        m_lineEnd = -1;
+}
+
+int LineCounter::lineEnd() {
+    if (m_lineEnd == -1) {
+        const ushort* s = m_text.utf16();
+        const int size = m_text.size();
+
+        m_lineEnd = m_lineStart;
+        while (m_lineEnd < size && s[m_lineEnd] != '\n' && s[m_lineEnd] != '\r')
+            m_lineEnd++;
+    }
+    return m_lineEnd;
+}
+
+void LineCounter::countScalar(int from, int to) {
+    const ushort* s = m_text.utf16();
+    const int size = m_text.size();
+
+    for (int i = from; i < to; i++) {
+        if (s[i] == '\n' || (s[i] == '\r' && (i + 1 == size || s[i + 1] != '\n'))) {
+            m_line++;
+            m_lineStart = i + 1;
+        }
+    }
+}
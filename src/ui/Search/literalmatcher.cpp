@@ -0,0 +1,286 @@
+#include "include/Search/literalmatcher.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NQQ_LITERALMATCHER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Needle What the kernels get from a LiteralMatcher.
+ */
+struct Needle {
+    const uchar* bytes;
+    const uchar* fold;  // nullptr if case-sensitive
+    int size;
+    int rare1;
+    int rare2;
+    int unitSize;
+};
+
+using Kernel = int (*)(const Needle& n, const uchar* data, int size, int from);
+
+/**
+ * @brief byteRank Roughly how common a byte is in source code and text, from 0 (rare) to 256.
+ */
+int byteRank(uchar c, int unitSize) {
+    // Most common first
+    static const char common[] = " etaoinsrlcdu\n()=;_,.pmfhgybv\t\"/xwk-*{}:0123456789>#<'[]jq&+z!|";
+
+    if (c == 0)
+        return unitSize == 2 ? 256 : 0; // In UTF-16 text, half the bytes are zero
+
+    const char* found = c < 0x80 ? static_cast<const char*>(memchr(common, c, sizeof(common) - 1)) : nullptr;
+    if (found)
+        return 255 - static_cast<int>(found - common);
+    if (c >= 'A' && c <= 'Z')
+        return 100;
+    if (c >= 0x80)
+        return 60;      // Non-ASCII text
+    if (c >= 0x20)
+        return 40;
+    return 10;          // Control characters
+}
+
+inline bool matchesAt(const Needle& n, const uchar* s) {
+    if (n.fold == nullptr)
+        return memcmp(s, n.bytes, n.size) == 0;
+
+    for (int j = 0; j < n.size; j++) {
+        if ((s[j] | n.fold[j]) != n.bytes[j])
+            return false;
+    }
+    return true;
+}
+
+inline bool isMatch(const Needle& n, const uchar* data, int candidate) {
+    return candidate % n.unitSize == 0 && matchesAt(n, data + candidate);
+}
+
+int findScalar(const Needle& n, const uchar* data, int size, int from) {
+    const int last = size - n.size;
+    const uchar byte1 = n.bytes[n.rare1];
+    const uchar mask1 = n.fold ? n.fold[n.rare1] : 0;
+
+    for (int c = from; c <= last; c++) {
+        if ((data[c + n.rare1] | mask1) == byte1 && isMatch(n, data, c))
+            return c;
+    }
+
+    return -1;
+}
+
+int findGeneric(const Needle& n, const uchar* data, int size, int from) {
+    if (n.fold != nullptr && n.fold[n.rare1] != 0)
+        return findScalar(n, data, size, from);
+
+    // The rare byte is the same in both cases: let memchr() find it
+    const uchar* p = data + from + n.rare1;
+    const uchar* end = data + size - n.size + n.rare1 + 1;
+
+    while (p < end) {
+        p = static_cast<const uchar*>(memchr(p, n.bytes[n.rare1], end - p));
+        if (p == nullptr)
+            break;
+
+        const int candidate = static_cast<int>(p - data) - n.rare1;
+        if (isMatch(n, data, candidate))
+            return candidate;
+        p++;
+    }
+
+    return -1;
+}
+
+#ifdef NQQ_LITERALMATCHER_X86
+
+__attribute__((target("sse2")))
+int findSse2(const Needle& n, const uchar* data, int size, int from) {
+    const int last = size - n.size;
+    const int reach = qMax(n.rare1, n.rare2);
+
+    const __m128i byte1 = _mm_set1_epi8(static_cast<char>(n.bytes[n.rare1]));
+    const __m128i byte2 = _mm_set1_epi8(static_cast<char>(n.bytes[n.rare2]));
+    const __m128i mask1 = _mm_set1_epi8(static_cast<char>(n.fold ? n.fold[n.rare1] : 0));
+    const __m128i mask2 = _mm_set1_epi8(static_cast<char>(n.fold ? n.fold[n.rare2] : 0));
+
+    int i = from;
+    for (; i + reach + 16 <= size; i += 16) {
+        const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n.rare1));
+        const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n.rare2));
+        const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(block1, mask1), byte1),
+                                         _mm_cmpeq_epi8(_mm_or_si128(block2, mask2), byte2));
+
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(eq));
+        while (bits != 0) {
+            const int candidate = i + __builtin_ctz(bits);
+            if (candidate > last)
+                return -1;
+            if (isMatch(n, data, candidate))
+                return candidate;
+            bits &= bits - 1;
+        }
+    }
+
+    return findScalar(n, data, size, i);
+}
+
+__attribute__((target("avx2")))
+int findAvx2(const Needle& n, const uchar* data, int size, int from) {
+    const int last = size - n.size;
+    const int reach = qMax(n.rare1, n.rare2);
+
+    const __m256i byte1 = _mm256_set1_epi8(static_cast<char>(n.bytes[n.rare1]));
+    const __m256i byte2 = _mm256_set1_epi8(static_cast<char>(n.bytes[n.rare2]));
+    const __m256i mask1 = _mm256_set1_epi8(static_cast<char>(n.fold ? n.fold[n.rare1] : 0));
+    const __m256i mask2 = _mm256_set1_epi8(static_cast<char>(n.fold ? n.fold[n.rare2] : 0));
+
+    int i = from;
+    for (; i + reach + 32 <= size; i += 32) {
+        const __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + n.rare1));
+        const __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + n.rare2));
+        const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(block1, mask1), byte1),
+                                            _mm256_cmpeq_epi8(_mm256_or_si256(block2, mask2), byte2));
+
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+        while (bits != 0) {
+            const int candidate = i + __builtin_ctz(bits);
+            if (candidate > last)
+                return -1;
+            if (isMatch(n, data, candidate))
+                return candidate;
+            bits &= bits - 1;
+        }
+    }
+
+    return findScalar(n, data, size, i);
+}
+
+#endif // NQQ_LITERALMATCHER_X86
+
+struct Implementation {
+    Kernel kernel;
+    const char* name;
+};
+
+const Implementation& implementation() {
+    static const Implementation impl = []() -> Implementation {
+#ifdef NQQ_LITERALMATCHER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {findAvx2, "avx2"};
+        if (__builtin_cpu_supports("sse2"))
+            return {findSse2, "sse2"};
+#endif
+        return {findGeneric, "generic"};
+    }();
+
+    return impl;
+}
+
+} // namespace
+
+LiteralMatcher::LiteralMatcher(const QByteArray& needle, bool matchCase) {
+    m_needle = needle;
+
+    if (!matchCase) {
+        m_foldMask.fill(0, needle.size());
+        for (int i = 0; i < needle.size(); i++) {
+            const char c = needle.at(i);
+            if (c >= 'A' && c <= 'Z') {
+                m_needle[i] = c + ('a' - 'A');
+                m_foldMask[i] = 0x20;
+            } else if (c >= 'a' && c <= 'z') {
+                m_foldMask[i] = 0x20;
+            }
+        }
+    }
+
+    init(1);
+}
+
+LiteralMatcher::LiteralMatcher(const QString& needle, bool matchCase) {
+    // Fold the code units, then take their bytes: that keeps the byte order of the platform
+    QString folded = needle;
+    QString mask;
+
+    if (!matchCase) {
+        mask.fill(QChar(0), needle.size());
+        for (int i = 0; i < needle.size(); i++) {
+            const ushort c = needle.at(i).unicode();
+            if (c >= 'A' && c <= 'Z') {
+                folded[i] = QChar(c + ('a' - 'A'));
+                mask[i] = QChar(0x20);
+            } else if (c >= 'a' && c <= 'z') {
+                mask[i] = QChar(0x20);
+            }
+        }
+    }
+
+    m_needle = QByteArray(reinterpret_cast<const char*>(folded.constData()), folded.size() * 2);
+    if (!matchCase)
+        m_foldMask = QByteArray(reinterpret_cast<const char*>(mask.constData()), mask.size() * 2);
+
+    init(2);
+}
+
+void LiteralMatcher::init(int unitSize) {
+    m_unitSize = unitSize;
+
+    // Look for the two rarest bytes, so that few positions get to the full comparison
+    const uchar* needle = reinterpret_cast<const uchar*>(m_needle.constData());
+    int bestRank = 257;
+    int secondRank = 257;
+
+    for (int i = 0; i < m_needle.size(); i++) {
+        const int rank = byteRank(needle[i], unitSize);
+        if (rank < bestRank) {
+            m_rare2 = m_rare1;
+            secondRank = bestRank;
+            m_rare1 = i;
+            bestRank = rank;
+        } else if (rank < secondRank) {
+            m_rare2 = i;
+            secondRank = rank;
+        }
+    }
+
+    if (m_needle.size() == 1)
+        m_rare2 = m_rare1;
+}
+
+int LiteralMatcher::find(const uchar* data, int size, int from) const {
+    if (from < 0)
+        from = 0;
+    if (m_needle.isEmpty() || from > size - m_needle.size())
+        return -1;
+
+    const Needle n = {
+        reinterpret_cast<const uchar*>(m_needle.constData()),
+        m_foldMask.isEmpty() ? nullptr : reinterpret_cast<const uchar*>(m_foldMask.constData()),
+        m_needle.size(),
+        m_rare1,
+        m_rare2,
+        m_unitSize
+    };
+
+    return implementation().kernel(n, data, size, from);
+}
+
+int LiteralMatcher::indexIn(const char* data, int size, int from) const {
+    Q_ASSERT(m_unitSize == 1);
+    return find(reinterpret_cast<const uchar*>(data), size, from);
+}
+
+int LiteralMatcher::indexIn(const QString& text, int from) const {
+    Q_ASSERT(m_unitSize == 2);
+    const int offset = find(reinterpret_cast<const uchar*>(text.constData()), text.size() * 2, from * 2);
+    return offset == -1 ? -1 : offset / 2;
+}
+
+const char* LiteralMatcher::implementationName() {
+    return implementation().name;
+}
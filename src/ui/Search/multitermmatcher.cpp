@@ -0,0 +1,163 @@
+#include "include/Search/multitermmatcher.h"
+
+#include <queue>
+#include <utility>
+
+const int MultiTermMatcher::ASCII_SIZE = 128;
+
+MultiTermMatcher::MultiTermMatcher(const QStringList& terms, bool matchCase)
+    : m_matchCase(matchCase)
+{
+    addState(0);
+
+    // Build the trie. Children are also kept in lists, to go through them breadth-first below.
+    std::vector<std::vector<std::pair<ushort, int>>> children(1);
+
+    for (int k = 0; k < terms.size(); k++) {
+        const QString term = matchCase ? terms[k] : terms[k].toCaseFolded();
+        if (term.isEmpty())
+            continue;
+
+        int state = 0;
+        for (const QChar c : term) {
+            const quint64 key = edgeKey(state, c.unicode());
+            auto it = m_edges.constFind(key);
+            if (it == m_edges.constEnd()) {
+                const int child = addState(m_depth[state] + 1);
+                children.emplace_back();
+                children[state].emplace_back(c.unicode(), child);
+                it = m_edges.insert(key, child);
+            }
+            state = it.value();
+        }
+
+        // Of the same terms, the first one is reported
+        if (m_term[state] == -1)
+            m_term[state] = k;
+    }
+
+    // Failure links, outputs and ASCII transitions. The failure link of a state always points to a
+    // shallower one, so it has been dealt with when the state is reached.
+    m_fail.assign(m_depth.size(), 0);
+    m_output.assign(m_depth.size(), 0);
+    m_asciiNext.assign(m_depth.size() * ASCII_SIZE, 0);
+
+    std::queue<int> queue;
+    queue.push(0);
+
+    while (!queue.empty()) {
+        const int state = queue.front();
+        queue.pop();
+
+        for (const auto& edge : children[state]) {
+            const ushort c = edge.first;
+            const int child = edge.second;
+
+            if (state != 0) {
+                int f = m_fail[state];
+                auto it = m_edges.constFind(edgeKey(f, c));
+                while (f != 0 && it == m_edges.constEnd()) {
+                    f = m_fail[f];
+                    it = m_edges.constFind(edgeKey(f, c));
+                }
+                m_fail[child] = (it != m_edges.constEnd()) ? it.value() : 0;
+            }
+
+            m_output[child] = (m_term[child] != -1) ? child : m_output[m_fail[child]];
+            queue.push(child);
+        }
+
+        int* row = &m_asciiNext[state * ASCII_SIZE];
+        const int* failRow = &m_asciiNext[m_fail[state] * ASCII_SIZE];
+        for (int c = 0; c < ASCII_SIZE; c++) {
+            auto it = m_edges.constFind(edgeKey(state, static_cast<ushort>(c)));
+            if (it != m_edges.constEnd())
+                row[c] = it.value();
+            else
+                row[c] = (state == 0) ? 0 : failRow[c];
+        }
+    }
+}
+
+MultiTermMatcher::Match MultiTermMatcher::indexIn(const QString& text, int from) const {
+    Match best;
+    if (isEmpty())
+        return best;
+
+    const ushort* data = text.utf16();
+    const int size = text.size();
+    int state = 0;
+
+    for (int i = qMax(from, 0); i < size; i++) {
+        state = next(state, fold(data[i]));
+
+        // Of the terms that end here, the deepest one starts first
+        const int out = m_output[state];
+        if (out != 0) {
+            const int start = i - m_depth[out] + 1;
+            if (best.term == -1 || start < best.position ||
+                    (start == best.position && m_depth[out] > best.length)) {
+                best.position = start;
+                best.length = m_depth[out];
+                best.term = m_term[out];
+            }
+        }
+
+        // Done once no partial match is left that starts where the best one does, or before
+        if (best.term != -1 && i - m_depth[state] + 1 > best.position)
+            return best;
+    }
+
+    return best;
+}
+
+MultiTermMatcher::Match MultiTermMatcher::shorterMatch(const QString& text, const Match& match) const {
+    Match shorter;
+    if (match.position < 0)
+        return shorter;
+
+    // Such a term is a prefix of the matched one, so it ends on the way down the trie to it
+    int state = 0;
+    for (int i = 0; i < match.length - 1; i++) {
+        auto it = m_edges.constFind(edgeKey(state, fold(text[match.position + i].unicode())));
+        if (it == m_edges.constEnd())
+            break;
+        state = it.value();
+
+        if (m_term[state] != -1) {
+            shorter.position = match.position;
+            shorter.length = m_depth[state];
+            shorter.term = m_term[state];
+        }
+    }
+
+    return shorter;
+}
+
+int MultiTermMatcher::addState(int depth) {
+    m_depth.push_back(depth);
+    m_term.push_back(-1);
+    return static_cast<int>(m_depth.size()) - 1;
+}
+
+int MultiTermMatcher::next(int state, ushort c) const {
+    if (c < ASCII_SIZE)
+        return m_asciiNext[state * ASCII_SIZE + c];
+
+    for (;;) {
+        auto it = m_edges.constFind(edgeKey(state, c));
+        if (it != m_edges.constEnd())
+            return it.value();
+        if (state == 0)
+            return 0;
+        state = m_fail[state];
+    }
+}
+
+ushort MultiTermMatcher::fold(ushort c) const {
+    if (m_matchCase)
+        return c;
+    if (c < ASCII_SIZE)
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    return static_cast<ushort>(QChar::toCaseFolded(static_cast<uint>(c)));
+}
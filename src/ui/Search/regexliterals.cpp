@@ -0,0 +1,371 @@
+#include "include/Search/regexliterals.h"
+
+#include <cctype>
+
+QStringList RegexLiterals::required(const QString& pattern) {
+    const int n = pattern.size();
+
+    // Extended syntax makes whitespace and comments meaningless. Not worth the trouble.
+    for (int i = pattern.indexOf("(?"); i != -1; i = pattern.indexOf("(?", i + 2)) {
+        int j = i + 2;
+        while (j < n && (pattern[j].isLetter() || pattern[j] == '^' || pattern[j] == '-')) {
+            if (pattern[j] == 'x')
+                return QStringList();
+            j++;
+        }
+    }
+
+    QStringList literals;
+    QString run;            // The literal characters read in a row
+    bool lastInRun = false; // Whether the last atom read is the last character of 'run'
+
+    auto endRun = [&]() {
+        if (!run.isEmpty())
+            literals.append(run);
+        run.clear();
+        lastInRun = false;
+    };
+
+    int i = 0;
+    while (i < n) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            if (i + 1 >= n)
+                return QStringList();
+
+            const QChar e = pattern[i + 1];
+            const ushort u = e.unicode();
+            QChar literal;
+
+            if (u >= 0x80 || (!e.isLetterOrNumber() && u != '_')) {
+                literal = e;
+            } else if (e == 'n') {
+                literal = '\n';
+            } else if (e == 't') {
+                literal = '\t';
+            } else if (e == 'r') {
+                literal = '\r';
+            } else if (e == 'f') {
+                literal = '\f';
+            } else if (e == 'e') {
+                literal = QChar(0x1B);
+            } else if (e == 'a') {
+                literal = QChar(0x07);
+            } else if (e == 'Q') {
+                // Everything up to \E is literal
+                const int end = pattern.indexOf("\\E", i + 2);
+                const QString quoted = pattern.mid(i + 2, end == -1 ? -1 : end - i - 2);
+                if (!quoted.isEmpty()) {
+                    run += quoted;
+                    lastInRun = true;
+                }
+                i = (end == -1) ? n : end + 2;
+                continue;
+            }
+
+            if (literal.isNull()) {
+                // A character class, an anchor, a back reference...
+                endRun();
+                i = skipEscape(pattern, i);
+                if (i == -1)
+                    return QStringList();
+            } else {
+                run += literal;
+                lastInRun = true;
+                i += 2;
+            }
+            continue;
+        }
+
+        int end;
+        int min;
+        const int q = quantifier(pattern, i, end, min);
+        if (q == -1)
+            return QStringList();
+
+        if (q == 1) {
+            if (lastInRun) {
+                // The last character may be missing, or repeated: either way the run stops there
+                if (min == 0)
+                    run.chop(1);
+                endRun();
+            }
+            lastInRun = false;
+
+            i = end;
+            if (i < n && (pattern[i] == '?' || pattern[i] == '+'))
+                i++;    // Lazy or possessive
+            continue;
+        }
+
+        if (c == '|' || c == ')') {
+            // An alternative at the top level, or an unbalanced parenthesis
+            return QStringList();
+        } else if (c == '(') {
+            endRun();
+            i = skipGroup(pattern, i);
+        } else if (c == '[') {
+            endRun();
+            i = skipClass(pattern, i);
+        } else if (c == '.' || c == '^' || c == '$') {
+            endRun();
+            i++;
+        } else {
+            run += c;
+            lastInRun = true;
+            i++;
+        }
+
+        if (i == -1)
+            return QStringList();
+    }
+
+    endRun();
+    return literals;
+}
+
+int RegexLiterals::skipGroup(const QString& pattern, int i) {
+    const int n = pattern.size();
+    int depth = 0;
+
+    while (i < n) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            if (i + 1 < n && pattern[i + 1] == 'Q')
+                return -1;
+            i += 2;
+        } else if (c == '[') {
+            i = skipClass(pattern, i);
+            if (i == -1)
+                return -1;
+        } else if (c == '(' && pattern.midRef(i, 3) == "(?#") {
+            // A comment: no nesting, no escapes
+            i = pattern.indexOf(')', i);
+            if (i == -1)
+                return -1;
+            i++;
+            if (depth == 0)
+                return i;
+        } else if (c == '(') {
+            depth++;
+            i++;
+        } else if (c == ')') {
+            depth--;
+            i++;
+            if (depth == 0)
+                return i;
+        } else {
+            i++;
+        }
+    }
+
+    return -1;
+}
+
+int RegexLiterals::skipClass(const QString& pattern, int i) {
+    const int n = pattern.size();
+
+    i++;
+    if (i < n && pattern[i] == '^')
+        i++;
+    if (i < n && pattern[i] == ']')
+        i++;    // A ']' right at the start is a character of the class
+
+    while (i < n) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            if (i + 1 < n && pattern[i + 1] == 'Q')
+                return -1;
+            i += 2;
+        } else if (c == '[' && i + 1 < n && pattern[i + 1] == ':') {
+            // POSIX class, like [:alpha:]
+            const int end = pattern.indexOf(":]", i + 2);
+            i = (end == -1) ? i + 1 : end + 2;
+        } else if (c == ']') {
+            return i + 1;
+        } else {
+            i++;
+        }
+    }
+
+    return -1;
+}
+
+int RegexLiterals::skipEscape(const QString& pattern, int i) {
+    const int n = pattern.size();
+    const QChar e = pattern[i + 1];
+    i += 2;
+
+    auto skipTo = [&](QChar closer) {
+        const int end = pattern.indexOf(closer, i);
+        return end == -1 ? -1 : end + 1;
+    };
+
+    if (e == 'x' || e == 'o' || e == 'p' || e == 'P' || e == 'N') {
+        // \x{263a}, \o{17}, \p{Lu}, \N{U+263a}, or short forms like \x41 and \pL
+        if (i < n && pattern[i] == '{')
+            return skipTo('}');
+        if (e == 'x') {
+            for (int k = 0; k < 2 && i < n && isxdigit(pattern[i].toLatin1()); k++)
+                i++;
+        } else if (e == 'p' || e == 'P') {
+            i++;
+        }
+    } else if (e == 'c') {
+        i++;
+    } else if (e == 'g' || e == 'k') {
+        // \g{name}, \k<name>, \k'name', \g-1, \g2
+        if (i < n && pattern[i] == '{')
+            return skipTo('}');
+        if (i < n && pattern[i] == '<')
+            return skipTo('>');
+        if (i < n && pattern[i] == '\'')
+            return skipTo('\'');
+        if (i < n && (pattern[i] == '-' || pattern[i] == '+'))
+            i++;
+        while (i < n && pattern[i].isDigit())
+            i++;
+    } else if (e.isDigit()) {
+        // Back reference or octal code
+        while (i < n && pattern[i].isDigit())
+            i++;
+    }
+
+    return qMin(i, n);
+}
+
+int RegexLiterals::quantifier(const QString& pattern, int i, int& end, int& min) {
+    const QChar c = pattern[i];
+
+    if (c == '*' || c == '?') {
+        min = 0;
+        end = i + 1;
+        return 1;
+    }
+    if (c == '+') {
+        min = 1;
+        end = i + 1;
+        return 1;
+    }
+    if (c != '{')
+        return 0;
+
+    // {n}, {n,} or {n,m}. Anything else is a literal '{', though some versions of PCRE also
+    // take {,m}: give up on what looks like it.
+    const int n = pattern.size();
+    int j = i + 1;
+    int value = 0;
+    bool digits = false;
+
+    while (j < n && pattern[j].isDigit()) {
+        value = qMin(value * 10 + pattern[j].digitValue(), 65535);
+        digits = true;
+        j++;
+    }
+    if (j < n && pattern[j] == ',') {
+        j++;
+        while (j < n && pattern[j].isDigit())
+            j++;
+    }
+
+    if (digits && j < n && pattern[j] == '}') {
+        min = value;
+        end = j + 1;
+        return 1;
+    }
+
+    const QChar next = (i + 1 < n) ? pattern[i + 1] : QChar();
+    if (next.isDigit() || next == ',' || next == ' ')
+        return -1;
+
+    return 0;
+}
+
+bool RegexLiterals::singleLine(const QString& pattern) {
+    const int n = pattern.size();
+
+    if (pattern.contains('\n') || pattern.contains("(*"))
+        return false;
+
+    int i = 0;
+    while (i < n) {
+        const QChar c = pattern[i];
+
+        if (c == '\\') {
+            if (i + 1 >= n || !safeEscape(pattern, i))
+                return false;
+            i += 2;
+        } else if (c == '(' && i + 1 < n && pattern[i + 1] == '?') {
+            // Groups like (?:...), (?=...), (?<name>...) are fine, and so is (?i). Other options, like (?s)
+            // or (?-m), change what '.', '^' and '$' match.
+            int j = i + 2;
+            if (j < n && pattern[j] == 'P')
+                j++;    // (?P<name>...)
+            while (j < n && (pattern[j] == 'i' || pattern[j] == '-'))
+                j++;
+            if (j < n && (pattern[j].isLetter() || pattern[j] == '^' || pattern[j] == '#'))
+                return false;
+            i = j;
+        } else if (c == '[') {
+            i++;
+            if (i < n && pattern[i] == '^')
+                return false;   // A negated class matches line feeds
+
+            bool first = true;
+            bool lastEscaped = false;
+            while (i < n && (first || pattern[i] != ']')) {
+                const QChar k = pattern[i];
+
+                if (k == '\\') {
+                    if (i + 1 >= n || !safeEscape(pattern, i))
+                        return false;
+                    lastEscaped = true;
+                    i += 2;
+                } else if (k == '[' && i + 1 < n && pattern[i + 1] == ':') {
+                    static const QStringList safeClasses = {
+                        "alpha", "digit", "alnum", "upper", "lower", "punct", "xdigit", "word", "blank", "graph", "print"
+                    };
+                    const int end = pattern.indexOf(":]", i + 2);
+                    if (end == -1 || !safeClasses.contains(pattern.mid(i + 2, end - i - 2)))
+                        return false;
+                    lastEscaped = false;
+                    i = end + 2;
+                } else if (k == '-' && !first && i + 1 < n && pattern[i + 1] != ']') {
+                    // A range: the line feed could be within it if it starts below
+                    if (lastEscaped || pattern[i - 1].unicode() < '\n')
+                        return false;
+                    i++;
+                } else {
+                    lastEscaped = false;
+                    i++;
+                }
+                first = false;
+            }
+            if (i >= n)
+                return false;
+            i++;
+        } else {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+bool RegexLiterals::safeEscape(const QString& pattern, int i) {
+    const QChar e = pattern[i + 1];
+    const ushort u = e.unicode();
+
+    // Escaped symbols stand for themselves
+    if (u >= 0x80 || (!e.isLetterOrNumber() && u != '_'))
+        return true;
+
+    // Word and digit classes, horizontal space, a few control characters, and assertions that only
+    // look at the characters around them. \z, \Z and \G also depend on where the text ends or the
+    // search starts.
+    static const QString safe = "wdhtfearbBAK";
+    return safe.contains(e);
+}
@@ -0,0 +1,113 @@
+#include "include/Search/regexprefilter.h"
+
+#include "include/Search/regexliterals.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief hasInlineCaseOption True if the pattern may turn case-insensitive matching on by itself, e.g. with (?i).
+ */
+bool hasInlineCaseOption(const QString& pattern) {
+    for (int i = pattern.indexOf("(?"); i != -1; i = pattern.indexOf("(?", i + 2)) {
+        for (int j = i + 2; j < pattern.size() && (pattern[j].isLetter() || pattern[j] == '-' || pattern[j] == '^'); j++) {
+            if (pattern[j] == 'i')
+                return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+RegexPrefilter::RegexPrefilter(const QRegularExpression& regex)
+{
+    const QRegularExpression::PatternOptions options = regex.patternOptions();
+    const QString pattern = regex.pattern();
+
+    if (!regex.isValid() || (options & QRegularExpression::ExtendedPatternSyntaxOption))
+        return;
+
+    const bool matchCase = !(options & QRegularExpression::CaseInsensitiveOption) && !hasInlineCaseOption(pattern);
+
+    // Case-insensitive matchers only fold ASCII letters, so the other characters are left out. Replacement
+    // characters are too: invalid UTF-8 decodes to them, but they aren't in the bytes.
+    QStringList literals;
+    for (const QString& literal : RegexLiterals::required(pattern)) {
+        int start = 0;
+        for (int i = 0; i <= literal.size(); i++) {
+            if (i < literal.size() && literal[i] != QChar::ReplacementCharacter && (matchCase || literal[i].unicode() < 0x80))
+                continue;
+            if (i > start)
+                literals.append(literal.mid(start, i - start));
+            start = i + 1;
+        }
+    }
+
+    std::stable_sort(literals.begin(), literals.end(),
+                     [](const QString& a, const QString& b) { return a.size() > b.size(); });
+
+    for (const QString& literal : literals) {
+        m_literals.push_back(Literal{LiteralMatcher(literal.toUtf8(), matchCase), LiteralMatcher(literal, matchCase)});
+
+        const QString lower = literal.toLower();
+        if (!matchCase && (lower.contains('k') || lower.contains('s')))
+            m_foldsFromNonAscii = true;
+    }
+
+    m_singleLine = (options & QRegularExpression::MultilineOption) &&
+                   !(options & QRegularExpression::DotMatchesEverythingOption) &&
+                   RegexLiterals::singleLine(pattern);
+}
+
+bool RegexPrefilter::canMatch(const char* utf8, int size) const {
+    if (isEmpty())
+        return true;
+
+    if (m_foldsFromNonAscii) {
+        const QByteArray text = QByteArray::fromRawData(utf8, size);
+        if (text.contains("\xE2\x84\xAA") || text.contains("\xC5\xBF"))
+            return true;
+    }
+
+    for (const Literal& literal : m_literals) {
+        if (literal.bytes.indexIn(utf8, size) == -1)
+            return false;
+    }
+    return true;
+}
+
+bool RegexPrefilter::appliesTo(const QString& text) const {
+    if (isEmpty())
+        return false;
+    return !m_foldsFromNonAscii || (!text.contains(QChar(0x212A)) && !text.contains(QChar(0x017F)));
+}
+
+bool RegexPrefilter::canMatch(const QString& text) const {
+    for (const Literal& literal : m_literals) {
+        if (literal.units.indexIn(text) == -1)
+            return false;
+    }
+    return true;
+}
+
+int RegexPrefilter::nextRegion(const QString& text, int from, int& end) const {
+    end = text.size();
+    if (!m_singleLine)
+        return from;
+
+    const int position = m_literals.front().units.indexIn(text, from);
+    if (position == -1)
+        return -1;
+
+    // Regular expressions only break lines at line feeds: a lone '\r' can be matched like any character
+    const int lineStart = (position == 0) ? 0 : text.lastIndexOf('\n', position - 1) + 1;
+    const int lineEnd = text.indexOf('\n', position);
+    if (lineEnd != -1)
+        end = lineEnd + 1;
+
+    return std::max(lineStart, from);
+}
@@ -32,11 +32,12 @@ QString getFormattedLocationText(const DocResult& docResult, const QString& sear
 
 /**
  * @brief getFormattedLocationText Creates a html-formatted string to use as the text of a sublevel QTreeWidget item.
+ * @param docResult The DocResult the match belongs to, which holds its text
  * @param result The MatchResult to grab the information from
  * @param showFullText True if the match's full text line should be down. When false, long lines will be shortened.
  * @return The html-formatted string
  */
-QString getFormattedResultText(const MatchResult& result, bool showFullText=false) {
+QString getFormattedResultText(const DocResult& docResult, const MatchResult& result, bool showFullText=false) {
     // If, at some point, we want to use different color schemes for the text highlighting, these are ways to grab
     // Colors from specific palettes from Qt.
     //const static QString highlightColor = QApplication::palette().alternateBase().color().name(); /*#ffef0b*/
@@ -49,9 +50,9 @@ QString getFormattedResultText(const MatchResult& result, bool showFullText=fals
                 "%4</span>")
             .arg(result.lineNumber)
             // Natural tabs are way too large; just replace them.
-            .arg(result.getPreMatchString(showFullText).replace('\t', "    ").toHtmlEscaped(),
-                result.getMatchString().replace('\t', "    ").toHtmlEscaped(),
-                result.getPostMatchString(showFullText).replace('\t', "    ").toHtmlEscaped());
+            .arg(docResult.getPreMatchString(result, showFullText).replace('\t', "    ").toHtmlEscaped(),
+                docResult.getMatchString(result).replace('\t', "    ").toHtmlEscaped(),
+                docResult.getPostMatchString(result, showFullText).replace('\t', "    ").toHtmlEscaped());
 }
 
 /**
@@ -125,27 +126,19 @@ SearchInstance::SearchInstance(const SearchConfig& config)
     m_actionCopyLine = new QAction(tr("Copy Line to Clipboard"), m_contextMenu);
     connect(m_actionCopyLine, &QAction::triggered, this, [this, treeWidget](){
         auto* item = treeWidget->currentItem();
-        auto it = m_resultMap.find(item);
-        if (it != m_resultMap.end())
-            QApplication::clipboard()->setText( m_resultMap.at(it->first)->matchLineString );
+        auto* resultItem = matchResult(item);
+        if (resultItem)
+            QApplication::clipboard()->setText( docResult(item->parent())->getLineString(*resultItem) );
     });
 
     m_actionOpenDocument = new QAction(tr("Open Document"), m_contextMenu);
     connect(m_actionOpenDocument, &QAction::triggered, this, [this, treeWidget](){
-        auto* item = treeWidget->currentItem();
-        auto it = m_resultMap.find(item);
-        auto* resultItem = it != m_resultMap.end() ? it->second : nullptr;
-        auto* docItem = m_docMap.at(resultItem ? item->parent() : item);
-        emit itemInteracted( *docItem, resultItem, SearchUserInteraction::OpenDocument );
+        interact(treeWidget->currentItem(), SearchUserInteraction::OpenDocument);
     });
 
     m_actionOpenFolder = new QAction(tr("Open Folder in File Browser"), m_contextMenu);
     connect(m_actionOpenFolder, &QAction::triggered, this, [this, treeWidget](){
-        auto* item = treeWidget->currentItem();
-        auto it = m_resultMap.find(item);
-        auto* resultItem = it != m_resultMap.end() ? it->second : nullptr;
-        auto* docItem = m_docMap.at(resultItem ? item->parent() : item);
-        emit itemInteracted( *docItem, resultItem, SearchUserInteraction::OpenContainingFolder );
+        interact(treeWidget->currentItem(), SearchUserInteraction::OpenContainingFolder);
     });
 
     m_contextMenu->addAction(m_actionCopyLine);
@@ -166,10 +159,11 @@ SearchInstance::SearchInstance(const SearchConfig& config)
         }
     });
 
+    connect(treeWidget, &QTreeWidget::itemExpanded, this, &SearchInstance::populate);
+
     connect(treeWidget, &QTreeWidget::itemDoubleClicked, [this](QTreeWidgetItem *item) {
-        auto it = m_resultMap.find(item);
-        if (it != m_resultMap.end()) // Don't emit the interaction if no ResultItem was clicked
-            emit itemInteracted( *m_docMap.at(item->parent()), (it->second), SearchUserInteraction::OpenDocument );
+        if (matchResult(item)) // Don't emit the interaction if no ResultItem was clicked
+            interact(item, SearchUserInteraction::OpenDocument);
     });
 
     connect(treeWidget, &QTreeWidget::customContextMenuRequested, [this, treeWidget](const QPoint &pos){
@@ -178,7 +172,7 @@ SearchInstance::SearchInstance(const SearchConfig& config)
 
         // Disable to CopyLines action if a DocResult was clicked. Doesn't make sense since no single line
         // was selected in this case.
-        bool isTopLevelItem = treeWidget->currentItem()->childCount() > 0;
+        bool isTopLevelItem = !treeWidget->currentItem()->parent();
         m_actionCopyLine->setEnabled(!isTopLevelItem);
 
         auto localPos = treeWidget->mapToGlobal(pos);
@@ -214,10 +208,21 @@ SearchInstance::SearchInstance(const SearchConfig& config)
                 if (!dr.results.empty())
                     m_searchResult.results.push_back(dr);
             }
+        } else if (config.searchMode == SearchConfig::ModeMultiTerm) {
+            const MultiTermMatcher matcher(config.getTerms(), config.matchCase);
+            for(Editor* ed : editorsToSearch) {
+                DocResult dr = FileSearcher::searchMultiTerm(matcher, config.matchWord, ed->value());
+                dr.docType = DocResult::TypeDocument;
+                dr.fileName = tec->tabWidgetFromEditor(ed)->tabTextFromEditor(ed);
+                dr.editor = ed;
+                if (!dr.results.empty())
+                    m_searchResult.results.push_back(dr);
+            }
         } else if (config.searchMode == SearchConfig::ModeRegex) {
             QRegularExpression regex = FileSearcher::createRegexFromConfig(config);
+            const RegexPrefilter prefilter(regex);
             for(Editor* ed : editorsToSearch) {
-                DocResult dr = FileSearcher::searchRegExp(regex, ed->value());
+                DocResult dr = FileSearcher::searchRegExp(regex, ed->value(), prefilter);
                 dr.docType = DocResult::TypeDocument;
                 dr.fileName = tec->tabWidgetFromEditor(ed)->tabTextFromEditor(ed);
                 dr.editor = ed;
@@ -227,11 +232,12 @@ SearchInstance::SearchInstance(const SearchConfig& config)
         }
         onSearchCompleted();
     } else if (config.searchScope == SearchConfig::ScopeFileSystem) {
-        QTreeWidgetItem* toplevelitem = new QTreeWidgetItem(treeWidget);
-        toplevelitem->setText(0, tr("Calculating..."));
+        m_progressItem = new QTreeWidgetItem(treeWidget);
+        m_progressItem->setText(0, tr("Calculating..."));
 
         m_fileSearcher = FileSearcher::prepareAsyncSearch(config);
         connect(m_fileSearcher, &FileSearcher::resultProgress, this, &SearchInstance::onSearchProgress);
+        connect(m_fileSearcher, &FileSearcher::resultBatchReady, this, &SearchInstance::onResultBatchReady);
         connect(m_fileSearcher, &FileSearcher::resultReady, this, &SearchInstance::onSearchCompleted);
         connect(m_fileSearcher, &FileSearcher::finished, m_fileSearcher, &FileSearcher::deleteLater);
         connect(m_fileSearcher, &FileSearcher::finished, this, [this]() {
@@ -256,14 +262,25 @@ SearchResult SearchInstance::getFilteredSearchResult() const
     const QTreeWidget* tree = getResultTreeWidget();
     for (int i=0; i<tree->topLevelItemCount(); i++) {
         QTreeWidgetItem* docWidget = tree->topLevelItem(i);
-        const DocResult* fullResult = m_docMap.at(docWidget);
+        const DocResult* fullResult = docResult(docWidget);
+        if (!fullResult) // The progress item
+            continue;
+
         DocResult r = *fullResult;
+
+        // Until its items are created, all the results of a file are as checked as the file
+        if (docWidget->childCount() == 0) {
+            if (docWidget->checkState(0) == Qt::Checked)
+                result.results.push_back(r);
+            continue;
+        }
+
         r.results.clear();
 
         for (int c=0; c<docWidget->childCount(); c++) {
             QTreeWidgetItem* it = tree->topLevelItem(i)->child(c);
             if (it->checkState(0) == Qt::Checked)
-                r.results.push_back( *m_resultMap.at(it) );
+                r.results.push_back( *matchResult(it) );
         }
         if (!r.results.empty()) result.results.push_back(r);
     }
@@ -278,13 +295,10 @@ void SearchInstance::showFullLines(bool showFullLines)
 
     m_showFullLines = showFullLines;
 
-    if (m_isSearchInProgress)
-        return;
-
     for (auto& item : m_resultMap) {
         QTreeWidgetItem* treeItem = item.first;
-        const MatchResult& res = *item.second;
-        treeItem->setText(0, getFormattedResultText(res, showFullLines));
+        const MatchResult& res = *matchResult(treeItem);
+        treeItem->setText(0, getFormattedResultText(*docResult(treeItem->parent()), res, showFullLines));
     }
     // TODO: This doesn't actually resize the widget view area.
     //m_treeWidget->resizeColumnToContents(0);
@@ -292,6 +306,10 @@ void SearchInstance::showFullLines(bool showFullLines)
 
 void SearchInstance::expandAllResults()
 {
+    // expandAll() doesn't signal which items it expands
+    for (int i=0; i<m_treeWidget->topLevelItemCount(); i++)
+        populate(m_treeWidget->topLevelItem(i));
+
     m_treeWidget->expandAll();
     m_resultsAreExpanded = true;
 }
@@ -309,9 +327,16 @@ void SearchInstance::selectNextResult()
     QTreeWidgetItem* curr = treeWidget->currentItem();
     QTreeWidgetItem* next = nullptr;
 
-    if (!curr)
-        next = treeWidget->topLevelItem(0)->child(0);
-    else if (!curr->parent()) {
+    // The progress item has no results
+    const int firstTop = m_progressItem ? 1 : 0;
+    if (treeWidget->topLevelItemCount() <= firstTop)
+        return;
+
+    if (!curr || curr == m_progressItem) {
+        populate(treeWidget->topLevelItem(firstTop));
+        next = treeWidget->topLevelItem(firstTop)->child(0);
+    } else if (!curr->parent()) {
+        populate(curr);
         next = curr->child(0);
     } else {
         QTreeWidgetItem* top = curr->parent();
@@ -322,7 +347,8 @@ void SearchInstance::selectNextResult()
         else {
             int nextTop = treeWidget->indexOfTopLevelItem(top) + 1;
             if (nextTop >= treeWidget->topLevelItemCount())
-                nextTop = 0;
+                nextTop = firstTop;
+            populate(treeWidget->topLevelItem(nextTop));
             next = treeWidget->topLevelItem(nextTop)->child(0);
         }
     }
@@ -338,10 +364,17 @@ void SearchInstance::selectPreviousResult()
     QTreeWidgetItem* curr = treeWidget->currentItem();
     QTreeWidgetItem* prev = nullptr;
 
-    if (!curr) {
+    // The progress item has no results
+    const int firstTop = m_progressItem ? 1 : 0;
+    if (treeWidget->topLevelItemCount() <= firstTop)
+        return;
+
+    if (!curr || curr == m_progressItem) {
         QTreeWidgetItem* lastTop = treeWidget->topLevelItem(treeWidget->topLevelItemCount()-1);
+        populate(lastTop);
         prev = lastTop->child(lastTop->childCount()-1);
     } else if (!curr->parent()) {
+        populate(curr);
         prev = curr->child(curr->childCount()-1);
     } else {
         QTreeWidgetItem* top = curr->parent();
@@ -351,8 +384,9 @@ void SearchInstance::selectPreviousResult()
             prev = top->child(prevIndex);
         else {
             int prevTop = treeWidget->indexOfTopLevelItem(top) - 1;
-            if (prevTop < 0)
+            if (prevTop < firstTop)
                 prevTop = treeWidget->topLevelItemCount() - 1;
+            populate(treeWidget->topLevelItem(prevTop));
             prev = treeWidget->topLevelItem(prevTop)->child(treeWidget->topLevelItem(prevTop)->childCount()-1);
         }
     }
@@ -369,11 +403,25 @@ void SearchInstance::copySelectedLinesToClipboard() const
     //contents if they are checked. This way proper item order is preserved.
     const QTreeWidget* tree = getResultTreeWidget();
     for (int i=0; i<tree->topLevelItemCount(); i++) {
-        for (int c=0; c<tree->topLevelItem(i)->childCount(); c++) {
-            QTreeWidgetItem* it = tree->topLevelItem(i)->child(c);
+        QTreeWidgetItem* docWidget = tree->topLevelItem(i);
+        const DocResult* doc = docResult(docWidget);
+        if (!doc) // The progress item
+            continue;
+
+        // Until its items are created, all the results of a file are as checked as the file
+        if (docWidget->childCount() == 0) {
+            if (docWidget->checkState(0) == Qt::Checked) {
+                for (const MatchResult& result : doc->results)
+                    cp += doc->getLineString(result) + '\n';
+            }
+            continue;
+        }
+
+        for (int c=0; c<docWidget->childCount(); c++) {
+            QTreeWidgetItem* it = docWidget->child(c);
 
             if (it->checkState(0) == Qt::Checked)
-                cp += m_resultMap.at(it)->matchLineString + '\n';
+                cp += doc->getLineString(*matchResult(it)) + '\n';
         }
     }
 
@@ -383,38 +431,131 @@ void SearchInstance::copySelectedLinesToClipboard() const
     QApplication::clipboard()->setText(cp);
 }
 
-void SearchInstance::onSearchProgress(int processed, int total)
+void SearchInstance::onSearchProgress(int processed, int discovered, bool discoveryComplete)
+{
+    const QString text = discoveryComplete ?
+                tr("Search in progress [%1/%2 finished]") :
+                tr("Search in progress [%1 searched / %2 discovered so far]");
+
+    m_progressItem->setText(0, text.arg(processed).arg(discovered));
+}
+
+void SearchInstance::onResultBatchReady()
 {
-    m_treeWidget->topLevelItem(0)->setText(0,QString(tr("Search in progress [%1/%2 finished]")).arg(processed).arg(total));
+    if (m_fileSearcher)
+        addResults(m_fileSearcher->takeResultBatch());
 }
 
 void SearchInstance::onSearchCompleted()
 {
     m_isSearchInProgress = false;
 
-    // m_fileSearcher is only instantiated when we've done a filesystem search. If so, get the results
-    // from there. Otherwise all search results were already added to m_searchResult
+    // m_fileSearcher is only instantiated when we've done a filesystem search. If so, collect the results
+    // it hasn't handed out yet. Otherwise all search results were already added to m_searchResult
     if (m_fileSearcher) {
-        m_searchResult = std::move(m_fileSearcher->getResult());
+        delete m_progressItem;
+        m_progressItem = nullptr;
+        addResults(m_fileSearcher->takeResultBatch());
+    } else {
+        QVector<DocResult> results;
+        results.swap(m_searchResult.results);
+        addResults(std::move(results));
     }
 
-    m_treeWidget->clear();
-    for (const auto& doc : m_searchResult.results) {
-        QTreeWidgetItem* toplevelitem = new QTreeWidgetItem(getResultTreeWidget());
-        toplevelitem->setText(0, getFormattedLocationText(doc, m_searchConfig.directory));
+    if (m_searchResult.results.size() == 1)
+        expandAllResults();
+
+    emit searchCompleted();
+}
+
+void SearchInstance::addResults(QVector<DocResult> results)
+{
+    QTreeWidget* treeWidget = getResultTreeWidget();
+
+    for (DocResult& doc : results) {
+        const int docIndex = m_searchResult.results.size();
+        m_searchResult.results.push_back(std::move(doc));
+        const DocResult& added = m_searchResult.results.last();
+
+        // Files are kept sorted by name, after the progress item, whatever order they're found in
+        int first = m_progressItem ? 1 : 0;
+        int last = treeWidget->topLevelItemCount();
+        if (m_searchConfig.searchScope != SearchConfig::ScopeFileSystem)
+            first = last;
+
+        while (first < last) {
+            const int middle = (first + last) / 2;
+            if (docResult(treeWidget->topLevelItem(middle))->fileName < added.fileName)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        QTreeWidgetItem* toplevelitem = new QTreeWidgetItem();
+        toplevelitem->setText(0, getFormattedLocationText(added, m_searchConfig.directory));
         toplevelitem->setCheckState(0, Qt::Checked);
-        m_docMap[toplevelitem] = &doc;
+        toplevelitem->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        m_docMap[toplevelitem] = docIndex;
 
-        for (const auto& res : doc.results) {
-            QTreeWidgetItem* it = new QTreeWidgetItem(toplevelitem);
-            it->setText(0, getFormattedResultText(res, m_showFullLines));
-            it->setCheckState(0, Qt::Checked);
-            m_resultMap[it] = &res;
+        treeWidget->insertTopLevelItem(first, toplevelitem);
+        if (m_resultsAreExpanded) {
+            populate(toplevelitem);
+            toplevelitem->setExpanded(true);
         }
     }
+}
 
-    if (m_searchResult.results.size() == 1)
-        m_treeWidget->expandAll();
+void SearchInstance::populate(QTreeWidgetItem* item)
+{
+    auto docIt = m_docMap.find(item);
+    if (docIt == m_docMap.end() || item->childCount() > 0)
+        return;
 
-    emit searchCompleted();
+    const int docIndex = docIt->second;
+    const DocResult& doc = m_searchResult.results[docIndex];
+    const QStringList terms = m_searchConfig.getTerms();
+    const Qt::CheckState checkState = item->checkState(0);
+
+    for (int i = 0; i < doc.results.size(); i++) {
+        QTreeWidgetItem* it = new QTreeWidgetItem(item);
+        it->setText(0, getFormattedResultText(doc, doc.results[i], m_showFullLines));
+        it->setCheckState(0, checkState);
+        const int termIndex = doc.results[i].termIndex;
+        if (termIndex >= 0 && termIndex < terms.size())
+            it->setToolTip(0, tr("Matches \"%1\"").arg(terms.at(termIndex)));
+        m_resultMap[it] = std::make_pair(docIndex, i);
+    }
+}
+
+void SearchInstance::interact(QTreeWidgetItem* item, SearchUserInteraction type)
+{
+    const MatchResult* resultItem = matchResult(item);
+    const DocResult* docItem = docResult(resultItem ? item->parent() : item);
+    if (!docItem)
+        return;
+
+    // Handling the interaction may run an event loop, in which new results can reallocate
+    // m_searchResult: hand out copies instead of references into it.
+    const DocResult doc = *docItem;
+    const MatchResult result = resultItem ? *resultItem : MatchResult();
+
+    emit itemInteracted(doc, resultItem ? &result : nullptr, type);
+}
+
+const DocResult* SearchInstance::docResult(QTreeWidgetItem* item) const
+{
+    auto it = m_docMap.find(item);
+    if (it == m_docMap.end())
+        return nullptr;
+
+    return &m_searchResult.results[it->second];
+}
+
+const MatchResult* SearchInstance::matchResult(QTreeWidgetItem* item) const
+{
+    auto it = m_resultMap.find(item);
+    if (it == m_resultMap.end())
+        return nullptr;
+
+    return &m_searchResult.results[it->second.first].results[it->second.second];
 }
@@ -1,5 +1,9 @@
 #include "include/Search/searchobjects.h"
 
+#include <algorithm>
+
+const int DocResult::CUTOFF_LENGTH = 60;
+
 void SearchConfig::setScopeFromInt(int scopeAsInt) {
     if (scopeAsInt>0 && scopeAsInt<3)
         searchScope = static_cast<SearchScope>(scopeAsInt);
@@ -14,28 +18,73 @@ QString SearchConfig::getScopeAsString() const {
     }
 }
 
-QString MatchResult::getMatchString() const {
-    return matchLineString.mid(positionInLine, matchLength);
+QStringList SearchConfig::getTerms() const {
+    QStringList terms = searchString.split('\n', QString::SkipEmptyParts);
+    for (QString& term : terms) {
+        if (term.endsWith('\r'))
+            term.chop(1);
+    }
+    terms.removeAll(QString());
+    return terms;
+}
+
+void DocResult::addLine(MatchResult& result, const QStringRef& line) {
+    if (!results.isEmpty() && results.last().lineNumber == result.lineNumber) {
+        result.lineOffset = results.last().lineOffset;
+        result.lineLength = results.last().lineLength;
+        return;
+    }
+
+    // Trim whitespace from the end
+    int length = line.length();
+    while (length > 0 && line.at(length-1).isSpace())
+        length--;
+
+    result.lineOffset = lines.length();
+    result.lineLength = length;
+    lines.append(line.left(length));
+}
+
+QString DocResult::getLineString(const MatchResult& result) const {
+    return lines.mid(result.lineOffset, result.lineLength);
+}
+
+QString DocResult::getMatchString(const MatchResult& result) const {
+    return lines.midRef(result.lineOffset, result.lineLength).mid(result.positionInLine, result.matchLength).toString();
 }
 
-QString MatchResult::getPreMatchString(bool fullText) const {
-    const int pos = positionInLine;
+QString DocResult::getPreMatchString(const MatchResult& result, bool fullText) const {
+    const QStringRef line = lines.midRef(result.lineOffset, result.lineLength);
+    const int pos = result.positionInLine;
 
     // Cut off part of the text if it is too long and the caller did not request full text
     if (!fullText && pos > CUTOFF_LENGTH)
-        return "..." + matchLineString.mid( std::max(0, pos-CUTOFF_LENGTH), std::min(CUTOFF_LENGTH, pos) );
+        return "..." + line.mid( std::max(0, pos-CUTOFF_LENGTH), std::min(CUTOFF_LENGTH, pos) ).toString();
     else
-        return matchLineString.left(pos);
+        return line.left(pos).toString();
 }
 
-QString MatchResult::getPostMatchString(bool fullText) const {
-    const int end = matchLineString.length();
-    const int pos = positionInLine + matchLength;
+QString DocResult::getPostMatchString(const MatchResult& result, bool fullText) const {
+    const QStringRef line = lines.midRef(result.lineOffset, result.lineLength);
+    const int end = line.length();
+    const int pos = result.positionInLine + result.matchLength;
 
     if (!fullText && end-pos > CUTOFF_LENGTH)
-        return matchLineString.mid(pos, CUTOFF_LENGTH) + "...";
+        return line.mid(pos, CUTOFF_LENGTH).toString() + "...";
     else
-        return matchLineString.right(end-pos);
+        return line.right(std::max(0, end-pos)).toString();
+}
+
+int DocResult::capturedStart(const MatchResult& result, int group) const {
+    if (result.captureOffset == -1 || group < 1 || group > regexCaptureGroupCount)
+        return -1;
+    return captures[result.captureOffset + 2*(group-1)];
+}
+
+int DocResult::capturedLength(const MatchResult& result, int group) const {
+    if (result.captureOffset == -1 || group < 1 || group > regexCaptureGroupCount)
+        return 0;
+    return captures[result.captureOffset + 2*(group-1) + 1];
 }
 
 int SearchResult::countResults() const {
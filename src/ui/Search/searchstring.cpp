@@ -21,6 +21,42 @@ QString SearchString::format(QString regex, SearchHelpers::SearchMode searchMode
     return regex;
 }
 
+QString SearchString::formatRegularExpression(QString regex, SearchHelpers::SearchMode searchMode, const SearchHelpers::SearchOptions& searchOptions)
+{
+    if (searchMode == SearchHelpers::SearchMode::SpecialChars) {
+        regex = QRegularExpression::escape(unescape(regex));
+    } else if (searchMode != SearchHelpers::SearchMode::Regex) {
+        regex = QRegularExpression::escape(regex);
+    } else {
+        // PCRE has no \uXXXX, and its \v is any vertical whitespace instead of a vertical tab
+        static const QRegularExpression hex4("^[0-9a-fA-F]{4}$");
+        QString translated;
+        translated.reserve(regex.size());
+
+        for (int i = 0; i < regex.size(); i++) {
+            if (regex[i] != '\\' || i + 1 == regex.size()) {
+                translated.append(regex[i]);
+            } else if (regex[i+1] == 'u' && hex4.match(regex.mid(i+2, 4)).hasMatch()) {
+                translated.append("\\x{" + regex.mid(i+2, 4) + "}");
+                i += 5;
+            } else if (regex[i+1] == 'v') {
+                translated.append("\\x{000B}");
+                i += 1;
+            } else {
+                translated.append(regex.midRef(i, 2));
+                i += 1;
+            }
+        }
+        regex = translated;
+    }
+
+    if (searchOptions.MatchWholeWord) {
+        regex = "\\b" + regex + "\\b";
+    }
+
+    return regex;
+}
+
 QString SearchString::unescape(const QString &data)
 { 
     const int dataLength = data.size();
@@ -0,0 +1,473 @@
+#include "include/Search/trigramindex.h"
+
+#include "include/Search/regexliterals.h"
+#include "include/Sessions/persistentcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+const quint32 TrigramIndex::FILE_MAGIC = 0x4e515449; // "NQTI"
+const quint32 TrigramIndex::FILE_VERSION = 1;
+const int TrigramIndex::MAX_FILE_SIZE = 64 * 1024 * 1024;
+const int TrigramIndex::MAX_LOADED_INDEXES = 8;
+
+namespace {
+
+std::mutex g_indexesMutex;
+QHash<QString, std::shared_ptr<TrigramIndex>> g_indexes;
+QStringList g_recentIndexes;    // The directories of g_indexes, most recently used first
+
+std::mutex g_invalidatedMutex;
+QSet<QString> g_invalidated;
+
+bool isWithin(const QString& path, const QString& directory) {
+    return path.startsWith(directory) && (directory.endsWith('/') || path.midRef(directory.size()).startsWith('/'));
+}
+
+inline uchar foldByte(uchar c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+inline quint32 trigramAt(const uchar* s) {
+    return (static_cast<quint32>(foldByte(s[0])) << 16) | (static_cast<quint32>(foldByte(s[1])) << 8) | foldByte(s[2]);
+}
+
+/**
+ * @brief extractTrigrams Returns the distinct trigrams of the text, in no particular order.
+ */
+std::vector<quint32> extractTrigrams(const uchar* data, int size) {
+    std::vector<quint32> trigrams;
+    if (size < 3)
+        return trigrams;
+
+    if (size < 64 * 1024) {
+        trigrams.reserve(size - 2);
+        for (int i = 0; i + 3 <= size; i++)
+            trigrams.push_back(trigramAt(data + i));
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+        return trigrams;
+    }
+
+    // For bigger texts, a bitmap of all the 2^24 trigrams is cheaper than sorting
+    std::vector<quint64> seen(1 << 18, 0);
+    quint32 t = (static_cast<quint32>(foldByte(data[0])) << 8) | foldByte(data[1]);
+    for (int i = 2; i < size; i++) {
+        t = ((t << 8) | foldByte(data[i])) & 0xFFFFFF;
+        quint64& word = seen[t >> 6];
+        const quint64 bit = quint64(1) << (t & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            trigrams.push_back(t);
+        }
+    }
+    return trigrams;
+}
+
+/**
+ * @brief foldsToAscii True if the text has characters that a case-insensitive search takes for ASCII
+ *        letters: the Kelvin sign and the long s. The trigrams of such a text can't be trusted.
+ */
+bool foldsToAscii(const char* utf8, int length) {
+    const QByteArray text = QByteArray::fromRawData(utf8, length);
+    return text.contains("\xE2\x84\xAA") || text.contains("\xC5\xBF");
+}
+
+/**
+ * @brief trigramsOf Returns the distinct trigrams of the strings, sorted.
+ * @param asciiOnly Leave out the trigrams with bytes of non-ASCII characters, which may be written in
+ *                  another case in the files.
+ */
+QVector<quint32> trigramsOf(const QStringList& strings, bool asciiOnly) {
+    QVector<quint32> trigrams;
+
+    for (const QString& string : strings) {
+        // Invalid text decodes to replacement characters that aren't in the files as such
+        int start = 0;
+        for (int i = 0; i <= string.size(); i++) {
+            if (i < string.size() && string[i] != QChar::ReplacementCharacter && !string[i].isSurrogate())
+                continue;
+
+            const QByteArray utf8 = string.midRef(start, i - start).toUtf8();
+            const uchar* bytes = reinterpret_cast<const uchar*>(utf8.constData());
+            for (int k = 0; k + 3 <= utf8.size(); k++) {
+                if (asciiOnly && ((bytes[k] | bytes[k + 1] | bytes[k + 2]) & 0x80))
+                    continue;
+                trigrams.append(trigramAt(bytes + k));
+            }
+            start = i + 1;
+        }
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+} // namespace
+
+bool TrigramIndex::Query::matchesAll() const {
+    if (alternatives.isEmpty())
+        return true;
+    for (const QVector<quint32>& trigrams : alternatives) {
+        if (trigrams.isEmpty())
+            return true;
+    }
+    return false;
+}
+
+TrigramIndex::Query TrigramIndex::literalQuery(const QStringList& strings, bool matchCase) {
+    Query query;
+    for (const QString& string : strings)
+        query.alternatives.append(trigramsOf(QStringList(string), !matchCase));
+    return query;
+}
+
+TrigramIndex::Query TrigramIndex::regexQuery(const QString& pattern) {
+    // Inline options can make any part of the pattern case-insensitive
+    Query query;
+    query.alternatives.append(trigramsOf(RegexLiterals::required(pattern), true));
+    return query;
+}
+
+std::shared_ptr<TrigramIndex> TrigramIndex::forDirectory(const QString& directory) {
+    const QString path = QDir::cleanPath(QDir(directory).absolutePath());
+
+    std::lock_guard<std::mutex> lock(g_indexesMutex);
+    std::shared_ptr<TrigramIndex> index = g_indexes.value(path);
+    if (!index) {
+        index.reset(new TrigramIndex(path));
+        index->load();
+        g_indexes.insert(path, index);
+    }
+
+    g_recentIndexes.removeOne(path);
+    g_recentIndexes.prepend(path);
+
+    // Searches save the indexes they update, so the ones no search holds can simply be dropped,
+    // along with the files they had to index again
+    for (int i = g_recentIndexes.size() - 1; i >= 0 && g_indexes.size() > MAX_LOADED_INDEXES; i--) {
+        const QString directory = g_recentIndexes[i];
+        if (g_indexes.value(directory).use_count() != 1)
+            continue;
+
+        g_indexes.remove(directory);
+        g_recentIndexes.removeAt(i);
+
+        std::lock_guard<std::mutex> invalidatedLock(g_invalidatedMutex);
+        for (auto it = g_invalidated.begin(); it != g_invalidated.end();) {
+            if (isWithin(*it, directory))
+                it = g_invalidated.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    return index;
+}
+
+void TrigramIndex::invalidate(const QString& filePath) {
+    const QString path = QDir::cleanPath(filePath);
+
+    // An index that isn't loaded notices most changes by the files' modification times anyway
+    std::lock_guard<std::mutex> lock(g_indexesMutex);
+    const bool indexed = std::any_of(g_recentIndexes.cbegin(), g_recentIndexes.cend(),
+                                     [&](const QString& directory) { return isWithin(path, directory); });
+    if (!indexed)
+        return;
+
+    std::lock_guard<std::mutex> invalidatedLock(g_invalidatedMutex);
+    g_invalidated.insert(path);
+}
+
+TrigramIndex::TrigramIndex(const QString& directory)
+    : m_directory(directory),
+      m_indexPath(PersistentCache::searchIndexDirPath() + "/" +
+                  QCryptographicHash::hash(directory.toUtf8(), QCryptographicHash::Sha1).toHex() + ".idx")
+{
+}
+
+QBitArray TrigramIndex::match(const Query& query) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int fileCount = static_cast<int>(m_files.size());
+    QBitArray result(fileCount);
+
+    for (const QVector<quint32>& trigrams : query.alternatives) {
+        if (trigrams.isEmpty()) {
+            result.fill(true);
+            return result;
+        }
+
+        QVector<const Posting*> postings;
+        for (quint32 trigram : trigrams) {
+            auto it = m_postings.constFind(trigram);
+            if (it == m_postings.constEnd()) {
+                postings.clear();   // No file has all the trigrams
+                break;
+            }
+            postings.append(&it.value());
+        }
+        if (postings.isEmpty())
+            continue;
+
+        // Intersect, starting from the shortest list
+        std::sort(postings.begin(), postings.end(),
+                  [](const Posting* a, const Posting* b) { return a->count < b->count; });
+
+        std::vector<int> ids = decode(*postings[0]);
+        for (int k = 1; k < postings.size() && !ids.empty(); k++) {
+            const std::vector<int> other = decode(*postings[k]);
+            std::vector<int> common;
+            std::set_intersection(ids.begin(), ids.end(), other.begin(), other.end(), std::back_inserter(common));
+            ids.swap(common);
+        }
+
+        for (int id : ids) {
+            if (id >= 0 && id < fileCount)
+                result.setBit(id);
+        }
+    }
+
+    return result;
+}
+
+TrigramIndex::FileStatus TrigramIndex::check(const QString& filePath, const QFileInfo& info, const QBitArray& matches) const {
+    {
+        std::lock_guard<std::mutex> lock(g_invalidatedMutex);
+        if (!g_invalidated.isEmpty() && g_invalidated.contains(QDir::cleanPath(filePath)))
+            return FileStatus::Reindex;
+    }
+
+    const QString path = relativePath(filePath);
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.constFind(path);
+    if (it == m_ids.constEnd())
+        return FileStatus::Reindex;
+
+    const int id = it.value();
+    const File& file = m_files[id];
+    if (file.modified != modified || file.size != size)
+        return FileStatus::Reindex;
+
+    // Files indexed after match() was called, by another search, aren't in 'matches'
+    if (!(file.flags & FileIndexed) || id >= matches.size())
+        return FileStatus::Search;
+
+    return matches.testBit(id) ? FileStatus::Search : FileStatus::Skip;
+}
+
+void TrigramIndex::update(const QString& filePath, qint64 modified, qint64 size, const char* utf8, int length) {
+    const bool indexed = utf8 != nullptr && length <= MAX_FILE_SIZE && !foldsToAscii(utf8, length);
+    const std::vector<quint32> trigrams = indexed ?
+                extractTrigrams(reinterpret_cast<const uchar*>(utf8), length) : std::vector<quint32>();
+    const QString path = relativePath(filePath);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The old entry stays in the posting lists until the index is compacted
+        auto it = m_ids.find(path);
+        if (it != m_ids.end()) {
+            m_files[it.value()].flags = 0;
+            m_deadFiles++;
+        }
+
+        const int id = static_cast<int>(m_files.size());
+        m_files.push_back(File{path, modified, size, static_cast<quint8>(FileLive | (indexed ? FileIndexed : 0))});
+        m_ids.insert(path, id);
+
+        for (quint32 trigram : trigrams)
+            append(m_postings[trigram], id);
+
+        m_modified = true;
+    }
+
+    std::lock_guard<std::mutex> lock(g_invalidatedMutex);
+    g_invalidated.remove(QDir::cleanPath(filePath));
+}
+
+void TrigramIndex::removeMissing(const QSet<QString>& seen, const std::function<bool(const QString&)>& inScope) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_ids.begin(); it != m_ids.end();) {
+        if (!seen.contains(it.key()) && inScope(it.key())) {
+            m_files[it.value()].flags = 0;
+            m_deadFiles++;
+            m_modified = true;
+            it = m_ids.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool TrigramIndex::save() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_modified)
+        return true;
+
+    if (!QDir().mkpath(PersistentCache::searchIndexDirPath()))
+        return false;
+
+    QSaveFile file(m_indexPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << FILE_MAGIC << FILE_VERSION << m_directory;
+
+    stream << static_cast<quint32>(m_files.size());
+    for (const File& f : m_files)
+        stream << f.path << f.modified << f.size << f.flags;
+
+    stream << static_cast<quint32>(m_postings.size());
+    for (auto it = m_postings.constBegin(); it != m_postings.constEnd(); ++it)
+        stream << it.key() << it.value().last << it.value().count << it.value().ids;
+
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    m_modified = false;
+    return true;
+}
+
+QString TrigramIndex::relativePath(const QString& filePath) const {
+    if (!filePath.startsWith(m_directory))
+        return filePath;
+
+    int start = m_directory.size();
+    while (start < filePath.size() && filePath[start] == '/')
+        start++;
+    return filePath.mid(start);
+}
+
+void TrigramIndex::load() {
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString directory;
+    stream >> magic >> version >> directory;
+    if (magic != FILE_MAGIC || version != FILE_VERSION || directory != m_directory)
+        return;
+
+    quint32 fileCount = 0;
+    stream >> fileCount;
+    for (quint32 i = 0; i < fileCount && stream.status() == QDataStream::Ok; i++) {
+        File f;
+        stream >> f.path >> f.modified >> f.size >> f.flags;
+        if (f.flags & FileLive)
+            m_ids.insert(f.path, static_cast<int>(m_files.size()));
+        else
+            m_deadFiles++;
+        m_files.push_back(f);
+    }
+
+    quint32 postingCount = 0;
+    stream >> postingCount;
+    for (quint32 i = 0; i < postingCount && stream.status() == QDataStream::Ok; i++) {
+        quint32 trigram;
+        Posting posting;
+        stream >> trigram >> posting.last >> posting.count >> posting.ids;
+        m_postings.insert(trigram, posting);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        // Start over
+        m_files.clear();
+        m_ids.clear();
+        m_postings.clear();
+        m_deadFiles = 0;
+        return;
+    }
+
+    // Ids have to stay the same while searches use the index, so dead entries are only dropped here
+    if (m_deadFiles > 1024 && m_deadFiles > static_cast<int>(m_files.size()) / 4) {
+        compact();
+        m_modified = true;
+    }
+}
+
+void TrigramIndex::compact() {
+    std::vector<int> newIds(m_files.size(), -1);
+    std::vector<File> files;
+
+    for (size_t i = 0; i < m_files.size(); i++) {
+        if (m_files[i].flags & FileLive) {
+            newIds[i] = static_cast<int>(files.size());
+            files.push_back(m_files[i]);
+        }
+    }
+
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        Posting posting;
+        for (int id : decode(it.value())) {
+            if (id >= 0 && id < static_cast<int>(newIds.size()) && newIds[id] > posting.last)
+                append(posting, newIds[id]);
+        }
+
+        if (posting.count == 0) {
+            it = m_postings.erase(it);
+        } else {
+            it.value() = posting;
+            ++it;
+        }
+    }
+
+    m_files.swap(files);
+    m_ids.clear();
+    for (size_t i = 0; i < m_files.size(); i++)
+        m_ids.insert(m_files[i].path, static_cast<int>(i));
+    m_deadFiles = 0;
+}
+
+void TrigramIndex::append(Posting& posting, int id) {
+    quint32 delta = static_cast<quint32>(id - posting.last);
+    while (delta >= 0x80) {
+        posting.ids.append(static_cast<char>((delta & 0x7F) | 0x80));
+        delta >>= 7;
+    }
+    posting.ids.append(static_cast<char>(delta));
+
+    posting.last = id;
+    posting.count++;
+}
+
+std::vector<int> TrigramIndex::decode(const Posting& posting) {
+    std::vector<int> ids;
+    ids.reserve(qMax(posting.count, 0));
+
+    const uchar* p = reinterpret_cast<const uchar*>(posting.ids.constData());
+    const uchar* end = p + posting.ids.size();
+    quint32 id = static_cast<quint32>(-1);
+
+    while (p < end) {
+        quint32 delta = 0;
+        for (int shift = 0; p < end && shift < 32; shift += 7) {
+            const uchar b = *p++;
+            delta |= static_cast<quint32>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        id += delta;
+        ids.push_back(static_cast<int>(id));
+    }
+
+    return ids;
+}
@@ -0,0 +1,243 @@
+#include "include/Search/utf8search.h"
+
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Position Where a scan of the text got to, in bytes and in UTF-16 code units, along with the line
+ *                 it's on.
+ */
+struct Position {
+    int byte = 0;
+    int utf16 = 0;
+    int line = 1;
+    int lineStartByte = 0;
+    int lineStartUtf16 = 0;
+};
+
+/**
+ * @brief advance Moves the position forward to the given byte offset. Any line break it goes over
+ *                starts a new line: "\r\n" counts as one.
+ */
+void advance(const uchar* data, int size, Position& pos, int to) {
+    for (; pos.byte < to; pos.byte++) {
+        const uchar c = data[pos.byte];
+
+        // Every character but the continuation bytes starts a code point. Those longer than
+        // 3 bytes take two UTF-16 code units.
+        if ((c & 0xC0) != 0x80)
+            pos.utf16 += (c >= 0xF0) ? 2 : 1;
+
+        if (c == '\n' || (c == '\r' && (pos.byte + 1 == size || data[pos.byte + 1] != '\n'))) {
+            pos.line++;
+            pos.lineStartByte = pos.byte + 1;
+            pos.lineStartUtf16 = pos.utf16;
+        }
+    }
+}
+
+/**
+ * @brief decodeLine Decodes the line that starts at the given offset, without the line break and the
+ *                   whitespace at its end.
+ */
+QString decodeLine(const char* data, int size, int lineStart) {
+    int lineEnd = lineStart;
+    while (lineEnd < size && data[lineEnd] != '\n' && data[lineEnd] != '\r')
+        lineEnd++;
+
+    QString line = QString::fromUtf8(data + lineStart, lineEnd - lineStart);
+
+    int length = line.length();
+    while (length > 0 && line.at(length - 1).isSpace())
+        length--;
+    line.truncate(length);
+
+    return line;
+}
+
+/**
+ * @brief isBoundary Same check as matchesWholeWord() in filesearcher.cpp. Characters out of the BMP are
+ *                   surrogate pairs in a QString, and never count as a boundary.
+ */
+bool isBoundary(uint ucs4) {
+    if (ucs4 > 0xFFFF)
+        return false;
+
+    const QChar c(static_cast<ushort>(ucs4));
+    return c.isPunct() || c.isSpace() || c.isSymbol();
+}
+
+/**
+ * @brief decodeAt Decodes the code point that starts at the given offset of valid UTF-8 text.
+ */
+uint decodeAt(const uchar* data, int offset) {
+    const uchar c = data[offset];
+    if (c < 0x80)
+        return c;
+    if (c < 0xE0)
+        return ((c & 0x1F) << 6) | (data[offset + 1] & 0x3F);
+    if (c < 0xF0)
+        return ((c & 0x0F) << 12) | ((data[offset + 1] & 0x3F) << 6) | (data[offset + 2] & 0x3F);
+    return ((c & 0x07) << 18) | ((data[offset + 1] & 0x3F) << 12) |
+            ((data[offset + 2] & 0x3F) << 6) | (data[offset + 3] & 0x3F);
+}
+
+} // namespace
+
+Utf8Search::Utf8Search(const QString& needle, bool matchCase, bool matchWord)
+    : m_matchCase(matchCase),
+      m_matchWord(matchWord)
+{
+    if (needle.isEmpty())
+        return;
+
+    if (matchCase) {
+        m_needle = needle.toUtf8();
+        m_matcher = LiteralMatcher(m_needle, true);
+        return;
+    }
+
+    for (const QChar c : needle) {
+        if (c.unicode() >= 0x80)
+            return;
+    }
+
+    m_needle = needle.toLower().toLatin1();
+    m_matcher = LiteralMatcher(m_needle, false);
+
+    // Case-insensitive searches also match the Kelvin sign with 'k' and the long s with 's'
+    m_foldsFromNonAscii = m_needle.contains('k') || m_needle.contains('s');
+}
+
+int Utf8Search::utf8Payload(const char* data, qint64 size) {
+    const uchar* s = reinterpret_cast<const uchar*>(data);
+    qint64 i = 0;
+
+    if (size >= 3 && s[0] == 0xEF && s[1] == 0xBB && s[2] == 0xBF) {
+        i = 3;
+    } else if (size >= 2 && ((s[0] == 0xFF && s[1] == 0xFE) || (s[0] == 0xFE && s[1] == 0xFF))) {
+        // UTF-16 or UTF-32
+        return -1;
+    } else if (size >= 4 && s[0] == 0 && s[1] == 0 && s[2] == 0xFE && s[3] == 0xFF) {
+        return -1;
+    }
+
+    const int bomLength = static_cast<int>(i);
+
+    while (i < size) {
+        // Go through plain ASCII 8 bytes at a time
+        if (i + 8 <= size) {
+            quint64 block;
+            memcpy(&block, s + i, sizeof(block));
+            if ((block & Q_UINT64_C(0x8080808080808080)) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
+        const uchar c = s[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+
+        int length;
+        uchar min = 0x80;
+        uchar max = 0xBF;
+
+        if (c >= 0xC2 && c <= 0xDF) {
+            length = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            length = 3;
+            if (c == 0xE0) min = 0xA0;      // Overlong
+            else if (c == 0xED) max = 0x9F; // Surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            length = 4;
+            if (c == 0xF0) min = 0x90;      // Overlong
+            else if (c == 0xF4) max = 0x8F; // Above U+10FFFF
+        } else {
+            return -1;
+        }
+
+        if (i + length > size || s[i + 1] < min || s[i + 1] > max)
+            return -1;
+
+        for (int k = 2; k < length; k++) {
+            if ((s[i + k] & 0xC0) != 0x80)
+                return -1;
+        }
+
+        i += length;
+    }
+
+    return bomLength;
+}
+
+bool Utf8Search::search(const char* data, int size, DocResult& results) const {
+    if (m_foldsFromNonAscii) {
+        const QByteArray text = QByteArray::fromRawData(data, size);
+        if (text.contains("\xE2\x84\xAA") || text.contains("\xC5\xBF"))
+            return false;
+    }
+
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    const int needleLength = m_needle.size();
+    const int matchLength = QString::fromUtf8(m_needle).length();
+
+    Position pos;
+    int decodedLineStart = -1;
+    QString decodedLine;
+
+    int offset = 0;
+    while ((offset = find(data, size, offset)) != -1) {
+        const int end = offset + needleLength;
+
+        if (m_matchWord && !isWholeWord(data, size, offset, end)) {
+            offset = end;
+            continue;
+        }
+
+        advance(bytes, size, pos, offset);
+
+        if (pos.lineStartByte != decodedLineStart) {
+            decodedLine = decodeLine(data, size, pos.lineStartByte);
+            decodedLineStart = pos.lineStartByte;
+        }
+
+        MatchResult result;
+        result.lineNumber = pos.line;
+        results.addLine(result, QStringRef(&decodedLine));
+        result.positionInFile = pos.utf16;
+        result.positionInLine = pos.utf16 - pos.lineStartUtf16;
+        result.matchLength = matchLength;
+        results.results.push_back(result);
+
+        offset = end;
+    }
+
+    return true;
+}
+
+int Utf8Search::find(const char* data, int size, int from) const {
+    return m_matcher.indexIn(data, size, from);
+}
+
+bool Utf8Search::isWholeWord(const char* data, int size, int start, int end) const {
+    const uchar* s = reinterpret_cast<const uchar*>(data);
+
+    if (start > 0) {
+        // Back to the first byte of the previous character
+        int prev = start - 1;
+        while (prev > 0 && (s[prev] & 0xC0) == 0x80)
+            prev--;
+
+        if (!isBoundary(decodeAt(s, prev)))
+            return false;
+    }
+
+    if (end < size && !isBoundary(decodeAt(s, end)))
+        return false;
+
+    return true;
+}
@@ -17,6 +17,11 @@ QString PersistentCache::backupDirPath() {
     return path;
 }
 
+QString PersistentCache::searchIndexDirPath() {
+    static QString path = QFileInfo(QSettings().fileName()).dir().absolutePath().append("/searchIndex");
+    return path;
+}
+
 QUrl PersistentCache::createValidCacheName(const QDir& parent, const QString &fileName)
 {
     QUrl cacheFile;
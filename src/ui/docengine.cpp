@@ -1,5 +1,6 @@
 #include "include/docengine.h"
 
+#include "include/Search/trigramindex.h"
 #include "include/Sessions/persistentcache.h"
 #include "include/globals.h"
 #include "include/iconprovider.h"
@@ -23,6 +24,7 @@ DocEngine::DocEngine(TopEditorContainer *topEditorContainer, QObject *parent) :
     m_fsWatcher(new QFileSystemWatcher(this))
 {
     connect(m_fsWatcher, &QFileSystemWatcher::fileChanged, this, &DocEngine::documentChanged);
+    connect(m_fsWatcher, &QFileSystemWatcher::fileChanged, &TrigramIndex::invalidate);
 }
 
 DocEngine::~DocEngine()
@@ -68,6 +70,98 @@ DocEngine::DecodedText DocEngine::readToString(QFile *file, QTextCodec *codec, b
     return decoded;
 }
 
+std::pair<Editor::IndentationMode, bool> DocEngine::detectIndentation(const QString &text)
+{
+    // Texts longer than this are sampled, in SAMPLE_COUNT evenly spaced
+    // windows of SAMPLE_SIZE characters each.
+    const int SAMPLE_COUNT = 16;
+    const int SAMPLE_SIZE = 64 * 1024;
+    // Deeper indentation says nothing more about the indentation unit
+    const int MAX_WIDTH = 64;
+
+    int tabLines = 0;
+    int spaceLines = 0;
+    int widths[MAX_WIDTH + 1] = {};
+
+    const QChar *data = text.constData();
+
+    auto scan = [&](int from, int to) {
+        int i = from;
+
+        // Start from the beginning of a line
+        if (i > 0) {
+            while (i < to && data[i - 1] != '\n' && data[i - 1] != '\r')
+                i++;
+        }
+
+        while (i < to) {
+            if (data[i] == '\t') {
+                tabLines++;
+            } else {
+                int n = 0;
+                while (i + n < to && data[i + n] == ' ')
+                    n++;
+
+                // Ignore blank lines, mixed indentation, and single spaces
+                // that usually just align the middle of a block comment.
+                const QChar next = i + n < to ? data[i + n] : QChar('\n');
+                if (n >= 2 && next != '\t' && next != '\n' && next != '\r') {
+                    spaceLines++;
+                    widths[qMin(n, MAX_WIDTH)]++;
+                }
+            }
+
+            while (i < to && data[i] != '\n' && data[i] != '\r')
+                i++;
+            while (i < to && (data[i] == '\n' || data[i] == '\r'))
+                i++;
+        }
+    };
+
+    const int length = text.length();
+    if (length <= SAMPLE_COUNT * SAMPLE_SIZE) {
+        scan(0, length);
+    } else {
+        const int step = length / SAMPLE_COUNT;
+        for (int i = 0; i < SAMPLE_COUNT; i++) {
+            scan(i * step, i * step + SAMPLE_SIZE);
+        }
+    }
+
+    Editor::IndentationMode mode;
+    mode.useTabs = true;
+    mode.size = 0;
+
+    if (tabLines == 0 && spaceLines == 0)
+        return std::make_pair(mode, false);
+
+    if (tabLines > spaceLines)
+        return std::make_pair(mode, true);
+
+    // Widths used by less than 5% of the lines are most likely alignment
+    // (e.g. of function arguments), and would bring the GCD down to 1.
+    int gcd = 0;
+    for (int w = 2; w <= MAX_WIDTH; w++) {
+        if (widths[w] * 20 >= spaceLines) {
+            int a = gcd, b = w;
+            while (b != 0) {
+                const int t = a % b;
+                a = b;
+                b = t;
+            }
+            gcd = a;
+        }
+    }
+
+    if (gcd == 2 || gcd == 4 || gcd == 8) {
+        mode.useTabs = false;
+        mode.size = gcd;
+        return std::make_pair(mode, true);
+    }
+
+    return std::make_pair(mode, false);
+}
+
 QPromise<void> DocEngine::read(QFile *file, Editor *editor)
 {
     return read(file, editor, nullptr, false);
@@ -93,7 +187,20 @@ QPromise<void> DocEngine::read(QFile *file, Editor* editor, QTextCodec *codec, b
     else if (decoded.text.indexOf("\r") != -1)
         editor->setEndOfLineSequence("\r");
 
+    // Must be set before the content, so that the expensive addons
+    // don't get a chance to run on the whole document.
+    NqqSettings& settings = NqqSettings::getInstance();
+    const qint64 largeSize = settings.General.getLargeDocumentSize() * 1024LL * 1024LL;
+    const int largeLineCount = settings.General.getLargeDocumentLineCount();
+    editor->setLargeDocumentMode(file->size() >= largeSize ||
+                                 decoded.text.count(editor->endOfLineSequence()) >= largeLineCount);
+
+    // Done here rather than in the page, so that the result is ready
+    // as soon as the document is, without another round trip.
+    const auto indentation = detectIndentation(decoded.text);
+
     return editor->setValue(decoded.text)
+            .then([=](){ editor->setDetectedIndentation(indentation); })
             .then([=](){ return editor->asyncSendMessageWithResultP("C_CMD_CLEAR_HISTORY"); })
             .then([=](){ return editor->markClean(); })
             .then([=](){});
@@ -743,6 +850,9 @@ int DocEngine::saveDocument(EditorTabWidget *tabWidget, int tab, QUrl outFileNam
 
         file.close();
 
+        // The size and modification time may look the same to the search indexes
+        TrigramIndex::invalidate(file.fileName());
+
 #ifdef Q_OS_MACX
         // On macOS we need to give it a little bit of time, otherwise we get the
         // "document changed" banner as soon as the document is saved.
@@ -1,6 +1,8 @@
 #include "include/editortabwidget.h"
 
+#include "include/EditorNS/editorhost.h"
 #include "include/iconprovider.h"
+#include "include/nqqsettings.h"
 
 #include <QApplication>
 #include <QFileInfo>
@@ -135,7 +137,15 @@ int EditorTabWidget::rawAddEditorTab(const bool setFocus, const QString &title,
     QString oldTooltip;
 
     if (create) {
-        editor = Editor::getNewEditor(this);
+        if (NqqSettings::getInstance().General.getShareEditorRenderer()) {
+            if (m_editorHost.isNull()) {
+                const QString themeName = NqqSettings::getInstance().Appearance.getColorScheme();
+                m_editorHost = QSharedPointer<EditorHost>::create(Editor::themeFromName(themeName));
+            }
+            editor = Editor::getNewEditor(m_editorHost, this);
+        } else {
+            editor = Editor::getNewEditor(this);
+        }
     } else {
         editor = source->editorSharedPtr(sourceTabIndex);
 
@@ -225,8 +235,11 @@ void EditorTabWidget::tabRemoved(int)
 
     for (QSharedPointer<Editor> editor : m_editorPointers) {
         if (!tabs.contains(editor.data())) {
-            // Editor is the one that has been removed!
-            if (editor.data() != nullptr && editor->parent() == this) {
+            // Editor is the one that has been removed! addTab() put it into
+            // our internal QStackedWidget; if it was moved to another tab widget
+            // instead of closed, it already belongs to that one's.
+            QObject* parent = editor.data() != nullptr ? editor->parent() : nullptr;
+            if (parent != nullptr && (parent == this || parent->parent() == this)) {
                 // Set no parent, so that QObject won't delete
                 // the editor: that's what QSharedPointer should do.
                 editor->setParent(nullptr);
@@ -0,0 +1,97 @@
+#ifndef BRIDGESTATISTICS_H
+#define BRIDGESTATISTICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+namespace EditorNS
+{
+
+    /**
+     * @brief Collects statistics about the messages exchanged between the
+     *        Editors and their pages: how many of them are sent, how big they
+     *        are and how long it takes to get a reply.
+     *
+     * Every message with a reply (asyncSendMessageWithResult() and
+     * asyncSendMessageWithResultP()) is recorded under its name, e.g. "C_FUN_GET_VALUE".
+     * For the blocking variant, the time spent spinning the event loop while
+     * waiting is recorded as well, together with the number of calls made
+     * from within such a loop ("nested" calls).
+     */
+    class BridgeStatistics
+    {
+    public:
+        /**
+         * @brief Number of latency buckets. Bucket 0 counts the replies
+         *        faster than 1 ms, bucket i those within [2^(i-1), 2^i) ms,
+         *        and the last one everything slower.
+         */
+        static const int HISTOGRAM_BUCKETS;
+
+        struct Entry {
+            int requests = 0;
+            int replies = 0;
+            int syncRequests = 0;   // Requests that blocked until the reply
+            int nestedRequests = 0; // Blocking requests made while another one was waiting
+            qint64 requestBytes = 0;
+            qint64 replyBytes = 0;
+            qint64 totalLatency = 0; // In microseconds
+            qint64 maxLatency = 0;   // In microseconds
+            qint64 blockedTime = 0;  // In microseconds
+            QVector<int> histogram = QVector<int>(HISTOGRAM_BUCKETS, 0);
+
+            qint64 averageLatency() const;
+
+            /**
+             * @brief Returns the latency (in milliseconds) within which the given
+             *        fraction of the replies arrived, rounded up to a bucket boundary.
+             * @param fraction Between 0 and 1.
+             */
+            qint64 latencyPercentile(double fraction) const;
+        };
+
+        static BridgeStatistics& getInstance();
+
+        /**
+         * @brief Monotonic clock, in microseconds, to be used for recordReply().
+         */
+        qint64 now() const;
+
+        void recordRequest(const QString &message, const QVariant &data, bool sync);
+        void recordReply(const QString &message, const QVariant &data, qint64 latency);
+
+        /**
+         * @brief Must surround the event loop that waits for the reply of
+         *        a blocking request.
+         */
+        void beginBlockingWait();
+        void endBlockingWait(const QString &message, qint64 blockedTime);
+
+        const QMap<QString, Entry> &entries() const;
+        void reset();
+
+        QJsonObject toJson() const;
+
+        /**
+         * @brief Rough size in bytes of the data, as it is before being
+         *        serialized for the web channel.
+         */
+        static qint64 estimateSize(const QVariant &data);
+
+    private:
+        BridgeStatistics();
+
+        static int bucketFor(qint64 latency);
+
+        QMap<QString, Entry> m_entries;
+        QElapsedTimer m_clock;
+        int m_blockingDepth = 0;
+    };
+
+}
+
+#endif // BRIDGESTATISTICS_H
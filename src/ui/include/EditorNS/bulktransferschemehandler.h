@@ -0,0 +1,60 @@
+#ifndef BULKTRANSFERSCHEMEHANDLER_H
+#define BULKTRANSFERSCHEMEHANDLER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QUrl>
+#include <QWebEngineUrlSchemeHandler>
+
+namespace EditorNS
+{
+
+    /**
+     * @brief Serves large payloads to the editor page through a custom url scheme.
+     *
+     * Sending a whole document through QWebChannel means serializing it into
+     * a JSON string, with several intermediate copies and escaping. Instead, the
+     * payload can be published here: the page only receives a handle (an url
+     * like nqq-bulk:42) and fetches the raw UTF-8 bytes by itself.
+     *
+     * Every published payload can be fetched exactly once.
+     */
+    class BulkTransferSchemeHandler : public QWebEngineUrlSchemeHandler
+    {
+        Q_OBJECT
+    public:
+        static const QByteArray SCHEME_NAME;
+
+        static BulkTransferSchemeHandler& getInstance();
+
+        /**
+         * @brief Registers the url scheme within QtWebEngine. Must be called
+         *        before the QApplication object gets created.
+         */
+        static void registerUrlScheme();
+
+        /**
+         * @brief Makes the payload available to the editor page.
+         * @param data UTF-8 encoded content
+         * @return The url that the page can use to retrieve the payload
+         */
+        QUrl publish(const QByteArray &data);
+
+        /**
+         * @brief Frees the payload identified by the given url, if it
+         *        hasn't been fetched yet.
+         */
+        void revoke(const QUrl &handle);
+
+        void requestStarted(QWebEngineUrlRequestJob *job) override;
+
+    private:
+        explicit BulkTransferSchemeHandler(QObject *parent = 0);
+
+        QHash<QString, QByteArray> m_payloads;
+        unsigned int m_lastId = 0;
+    };
+
+}
+
+#endif // BULKTRANSFERSCHEMEHANDLER_H
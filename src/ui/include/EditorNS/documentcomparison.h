@@ -0,0 +1,66 @@
+#ifndef DOCUMENTCOMPARISON_H
+#define DOCUMENTCOMPARISON_H
+
+#include "include/EditorNS/linediff.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+namespace EditorNS
+{
+
+    class Editor;
+
+    /**
+     * @brief Compares the documents of two Editors line by line, and marks
+     *        the lines that differ in both of them, with the look of
+     *        CodeMirror's merge view.
+     *
+     * The diff is computed by LineDiff on a worker thread, against a copy of
+     * the two documents: the pages only receive the hunks that have to be
+     * marked (see C_CMD_SET_DIFF_HUNKS in app.js).
+     *
+     * The object deletes itself after emitting finished().
+     */
+    class DocumentComparison : public QObject
+    {
+        Q_OBJECT
+    public:
+        DocumentComparison(Editor *editor, Editor *other, QObject *parent = 0);
+        ~DocumentComparison();
+
+        void start();
+
+        /**
+         * @brief Removes the marks left on the document of the editor by a
+         *        previous comparison.
+         */
+        static void clear(Editor *editor);
+
+    signals:
+        /**
+         * @param hunkCount Number of differences found. 0 if the documents
+         *        are the same.
+         */
+        void finished(bool success, int hunkCount);
+
+    private:
+        QPointer<Editor> m_editor;
+        QPointer<Editor> m_other;
+        QString m_text;
+        QString m_otherText;
+        int m_pendingTexts = 0;
+        QFutureWatcher<QVector<LineDiff::Hunk>> m_watcher;
+        bool m_finished = false;
+
+        void onTextReceived();
+        void onDiffFinished();
+        void finish(bool success, int hunkCount);
+    };
+
+}
+
+#endif // DOCUMENTCOMPARISON_H
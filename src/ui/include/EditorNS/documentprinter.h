@@ -0,0 +1,147 @@
+#ifndef DOCUMENTPRINTER_H
+#define DOCUMENTPRINTER_H
+
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QObject>
+#include <QPagedPaintDevice>
+#include <QPainter>
+#include <QPointer>
+#include <QString>
+#include <QThread>
+#include <QVariant>
+
+#include <memory>
+
+namespace EditorNS
+{
+
+    class Editor;
+
+    /**
+     * @brief Lays out lines of text, with their syntax highlighting, on the
+     *        pages of a QPagedPaintDevice. Used by DocumentPrinter from its
+     *        worker thread.
+     */
+    class PageWriter : public QObject
+    {
+        Q_OBJECT
+    public:
+        PageWriter(std::shared_ptr<QPagedPaintDevice> device, int tabSize);
+
+    public slots:
+        void begin();
+
+        /**
+         * @brief Paints a slice of the document, as returned by C_FUN_GET_PRINT_SLICE.
+         */
+        void writeSlice(const QVariantMap &slice);
+        void end();
+
+    signals:
+        void sliceWritten();
+        void finished(bool success, QString errorString);
+
+    private:
+        struct Style {
+            QFont font;
+            QColor color;
+        };
+
+        struct Span {
+            int start;
+            int end;
+            const Style *style;
+        };
+
+        std::shared_ptr<QPagedPaintDevice> m_device;
+        int m_tabSize;
+        QPainter m_painter;
+        bool m_ok = false;
+
+        QFont m_font;
+        qreal m_charWidth = 0;
+        qreal m_lineHeight = 0;
+        qreal m_ascent = 0;
+        int m_columns = 0;
+        int m_rowsPerPage = 0;
+        int m_row = 0;
+
+        Style m_defaultStyle;
+        QHash<QString, Style> m_styles;
+
+        void writeLine(const QString &text, const QVariantList &styles);
+        bool nextRow();
+        const Style *styleFor(const QString &style);
+        void fail(const QString &errorString);
+    };
+
+    /**
+     * @brief Prints the document of an Editor without going through the page's
+     *        renderer, on a QPrinter or a QPdfWriter.
+     *
+     * The page hands out the text and the syntax highlighting of a snapshot of
+     * the document one slice at a time (see Printer.js), and a PageWriter lays
+     * them out and paints them on a worker thread. The next slice is fetched
+     * while the current one is painted, and no more: since the pages are
+     * written out as soon as they're full, memory doesn't grow with the size of
+     * the document. The live editor is never touched, and the user can keep
+     * editing while the job runs.
+     *
+     * The object deletes itself after emitting finished().
+     */
+    class DocumentPrinter : public QObject
+    {
+        Q_OBJECT
+    public:
+        /**
+         * @param device Where to paint the pages. It's used from the worker
+         *        thread until finished() is emitted.
+         */
+        DocumentPrinter(Editor *editor, std::shared_ptr<QPagedPaintDevice> device, QObject *parent = 0);
+        ~DocumentPrinter();
+
+        void start();
+
+    public slots:
+        /**
+         * @brief Stops at the end of the slice being painted. finished() is
+         *        then emitted with success = false and no error.
+         */
+        void cancel();
+
+    signals:
+        /**
+         * @param fraction Between 0 and 1.
+         */
+        void progress(double fraction);
+        void finished(bool success, QString errorString);
+
+    private:
+        QPointer<Editor> m_editor;
+        std::shared_ptr<QPagedPaintDevice> m_device;
+        QThread m_thread;
+        PageWriter *m_writer = nullptr;
+
+        int m_job = -1;
+        int m_lineCount = 0;
+        bool m_lastSliceReceived = false;
+        bool m_writerBusy = false;
+        bool m_hasQueuedSlice = false;
+        QVariantMap m_queuedSlice;
+        bool m_canceled = false;
+        bool m_finished = false;
+
+        void onJobStarted(const QVariantMap &job);
+        void requestSlice();
+        void onSliceReceived(const QVariantMap &slice);
+        void writeSlice(const QVariantMap &slice);
+        void onSliceWritten();
+        void endWriter();
+        void finish(bool success, const QString &errorString);
+    };
+
+}
+
+#endif // DOCUMENTPRINTER_H
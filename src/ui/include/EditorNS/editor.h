@@ -3,18 +3,20 @@
 
 #include "include/EditorNS/customqwebview.h"
 #include "include/EditorNS/languageservice.h"
+#include "include/EditorNS/texttransform.h"
 
+#include <QElapsedTimer>
 #include <QObject>
-#include <QQueue>
+#include <QPagedPaintDevice>
 #include <QTextCodec>
 #include <QVBoxLayout>
 #include <QVariant>
 #include <QWheelEvent>
 #include <QtPromise>
-#include <QPrinter>
 
 #include <functional>
 #include <future>
+#include <memory>
 
 class EditorTabWidget;
 
@@ -23,6 +25,9 @@ using namespace QtPromise;
 namespace EditorNS
 {
 
+    class DocumentPrinter;
+    class EditorHost;
+
     /**
          * @brief An Object injectable into the javascript page, that allows
          *        the javascript code to send messages to an Editor object.
@@ -86,10 +91,20 @@ namespace EditorNS
         explicit Editor(QWidget *parent = 0);
 
         /**
-             * @brief Efficiently returns a new Editor object from an internal buffer.
+             * @brief Creates an Editor that doesn't own a page, but a document
+             *        within the page of the given host.
+             */
+        explicit Editor(const QSharedPointer<EditorHost> &host, QWidget *parent = 0);
+        ~Editor();
+
+        /**
+             * @brief Efficiently returns a new Editor object from the EditorPool.
+             *        When the last reference to it goes away, the Editor is
+             *        given back to the pool.
              * @return
              */
         static QSharedPointer<Editor> getNewEditor(QWidget *parent = 0);
+        static QSharedPointer<Editor> getNewEditor(const QSharedPointer<EditorHost> &host, QWidget *parent = 0);
         static Editor *getNewEditorUnmanagedPtr(QWidget *parent);
 
         static void invalidateEditorBuffer();
@@ -299,6 +314,22 @@ namespace EditorNS
         Q_INVOKABLE QPromise<QStringList> selectedTexts();
 
         void setOverwrite(bool overwrite);
+
+        /**
+         * @brief Applies a TextTransform operation to the whole document,
+         *        as a single undoable change.
+         * @return false if the document has been edited while the
+         *         transformation was running, and has been left untouched.
+         */
+        QPromise<bool> transformLines(TextTransform::Operation operation);
+
+        /**
+         * @brief Turns off the editor features that don't scale to big documents
+         *        (matches highlighting, bracket matching, folding, etc.) and limits
+         *        syntax highlighting. See DocEngine::read().
+         */
+        void setLargeDocumentMode(bool enabled);
+        bool isLargeDocumentMode() const;
         void setTabsVisible(bool visible);
 
         /**
@@ -307,6 +338,14 @@ namespace EditorNS
          *         significative only if the second element ("found") is true.
          */
         QPromise<std::pair<IndentationMode, bool>> detectDocumentIndentation();
+
+        /**
+         * @brief Sets the result that detectDocumentIndentation() gives for the
+         *        current content, e.g. because DocEngine already computed it
+         *        while loading the file. Forgotten as soon as the content
+         *        changes.
+         */
+        void setDetectedIndentation(const std::pair<IndentationMode, bool> &detected);
         Editor::IndentationMode indentationMode();
         QPromise<IndentationMode> indentationModeP();
 
@@ -314,16 +353,32 @@ namespace EditorNS
 
         void setSelection(int fromLine, int fromCol, int toLine, int toCol);
 
+        /**
+         * @brief Replaces all the selections. The "from" end of each Selection
+         *        is its anchor, and the "to" end its head.
+         */
+        void setSelections(const QList<Selection> &selections);
+
         QPromise<int> lineCount();
 
+        /**
+         * @brief Returns the time (in milliseconds) the page took to get from the
+         *        construction of this Editor to J_EVT_READY, or -1 if the
+         *        editor isn't ready yet.
+         */
+        qint64 loadTime() const;
+
     private:
         friend class ::EditorTabWidget;
+        friend class EditorPool;
+        friend class EditorHost;
 
         struct AsyncReply {
             unsigned int id;
             QString message;
             std::shared_ptr<std::promise<QVariant>> value;
             std::function<void (QVariant)> callback;
+            qint64 sentAt; // See BridgeStatistics::now()
         };
 
         std::list<AsyncReply> asyncReplies;
@@ -333,27 +388,56 @@ namespace EditorNS
         QString tabName() const;
         void setTabName(const QString& name);
 
-        static QQueue<Editor*> m_editorBuffer;
+        /**
+         * @brief Documents at least this long (in characters) are transferred
+         *        to the page through BulkTransferSchemeHandler.
+         */
+        static const int BULK_TRANSFER_THRESHOLD;
+
         QVBoxLayout *m_layout;
         CustomQWebView *m_webView;
         JsToCppProxy *m_jsToCppProxy;
+        QSharedPointer<EditorHost> m_host;
+        unsigned int m_docId = 0;
         QUrl m_filePath = QUrl();
         QString m_tabName;
         bool m_fileOnDiskChanged = false;
         bool m_loaded = false;
+        QElapsedTimer m_loadTimer;
+        qint64 m_loadTime = -1;
         QString m_endOfLineSequence = "\n";
         QTextCodec *m_codec = QTextCodec::codecForName("UTF-8");
         bool m_bom = false;
         bool m_customIndentationMode = false;
+        bool m_largeDocumentMode = false;
+        std::pair<IndentationMode, bool> m_detectedIndentation;
+        bool m_hasDetectedIndentation = false;
         const Language* m_currentLanguage = nullptr;
         inline void waitAsyncLoad();
         QString jsStringEscape(QString str) const;
 
         void fullConstructor(const Theme &theme);
+        static CustomQWebView *createWebView(const Theme &theme, JsToCppProxy *proxy);
+
+        /**
+         * @brief Tags the message with the id of our document, when
+         *        the page is shared with other Editors.
+         */
+        QString addressMessage(const QString &msg) const;
+
+        /**
+         * @brief Brings the Editor back to the state of a new one (empty document,
+         *        no history, plain text, no banners and no external connections),
+         *        so that EditorPool can hand it out again.
+         */
+        void resetForReuse();
 
         QPromise<void> setIndentationMode(const bool useTabs, const int size);
         QPromise<void> setIndentationMode(const Language*);
 
+    protected:
+        void showEvent(QShowEvent *event) override;
+
     private slots:
         void on_proxyMessageReceived(QString msg, QVariant data);
 
@@ -379,6 +463,7 @@ namespace EditorNS
         void editorReady();
 
         void currentLanguageChanged(QString id, QString name);
+        void largeDocumentModeChanged(bool enabled);
 
     public slots:
         void sendMessage(const QString &msg, const QVariant &data);
@@ -399,18 +484,15 @@ namespace EditorNS
         std::shared_future<QVariant> asyncSendMessageWithResult(const QString &msg, std::function<void(QVariant)> callback = 0);
 
         /**
-         * @brief Print the editor. As of Qt 5.11, it produces low-quality, non-vector graphics with big dimension.
-         * @param printer
-         */
-        void print(std::shared_ptr<QPrinter> printer);
-
-        /**
-         * @brief Returns the content of the editor layed out in a pdf file that can be directly saved to disk.
-         *        This method produces light, vector graphics.
-         * @param pageLayout
-         * @return
+         * @brief Prints the document, with its syntax highlighting, on a QPrinter
+         *        or a QPdfWriter. The output is made of vector graphics, and the
+         *        pages are written out as they're done. The editor isn't touched,
+         *        and can be used while the printing goes on in the background.
+         * @param device
+         * @return The print job, already started. It deletes itself once it has
+         *         emitted DocumentPrinter::finished().
          */
-        QPromise<QByteArray> printToPdf(const QPageLayout &pageLayout = QPageLayout(QPageSize(QPageSize::A4), QPageLayout::Portrait, QMarginsF()));
+        DocumentPrinter *print(std::shared_ptr<QPagedPaintDevice> device);
     };
 
 }
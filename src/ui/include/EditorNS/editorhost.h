@@ -0,0 +1,69 @@
+#ifndef EDITORHOST_H
+#define EDITORHOST_H
+
+#include "include/EditorNS/editor.h"
+
+#include <QHash>
+#include <QObject>
+
+namespace EditorNS
+{
+
+    /**
+     * @brief A single editor page shared by several Editors.
+     *
+     * Normally every Editor owns a whole web page, and so a whole renderer.
+     * When the ShareEditorRenderer setting is on, the Editors of an
+     * EditorTabWidget are attached to one EditorHost instead: each of them owns
+     * a CodeMirror document within the host's page, and the messages it sends
+     * are tagged with the id of that document. The web view is moved into
+     * whichever Editor is currently shown, so switching tab swaps the document
+     * displayed by CodeMirror.
+     */
+    class EditorHost : public QObject
+    {
+        Q_OBJECT
+    public:
+        explicit EditorHost(const Editor::Theme &theme, QObject *parent = 0);
+        ~EditorHost();
+
+        CustomQWebView *webView() const;
+        JsToCppProxy *proxy() const;
+
+        /**
+         * @brief Whether the page has finished loading.
+         */
+        bool isLoaded() const;
+
+        /**
+         * @brief Registers a new Editor within the page.
+         * @return The id of the document that belongs to the editor
+         */
+        unsigned int attach(Editor *editor);
+
+        /**
+         * @brief Closes the document of the editor. If the editor is the one
+         *        currently showing the web view, the view is taken away from it.
+         */
+        void detach(Editor *editor);
+
+        /**
+         * @brief Moves the web view into the editor, and displays its document.
+         */
+        void show(Editor *editor);
+
+    private:
+        CustomQWebView *m_webView;
+        JsToCppProxy *m_jsToCppProxy;
+        QHash<unsigned int, Editor *> m_editors;
+        Editor *m_currentEditor = nullptr;
+        unsigned int m_lastDocId = 0;
+        bool m_loaded = false;
+
+    private slots:
+        void on_proxyMessageReceived(QString msg, QVariant data);
+    };
+
+}
+
+#endif // EDITORHOST_H
@@ -0,0 +1,117 @@
+#ifndef EDITORPOOL_H
+#define EDITORPOOL_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+
+class QWidget;
+
+namespace EditorNS
+{
+
+    class Editor;
+
+    /**
+     * @brief Keeps a number of ready-to-use Editors, so that opening a new tab
+     *        doesn't have to wait for a web page to load.
+     *
+     * The pool is refilled one Editor at a time while the application is idle,
+     * up to a target size that follows the rate at which Editors have been
+     * requested recently. Editors released by their owners are reset and put
+     * back into the pool instead of being destroyed, as long as the pool stays
+     * within the memory limit set in NqqSettings.
+     */
+    class EditorPool : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct Statistics {
+            int hits = 0;      // Requests served by a pooled Editor
+            int misses = 0;    // Requests that had to wait for a new Editor
+            int recycled = 0;  // Released Editors that went back into the pool
+            int discarded = 0; // Released Editors that have been destroyed
+
+            /**
+             * @brief Fraction of the requests served by a pooled Editor,
+             *        between 0 and 1.
+             */
+            double hitRate() const;
+        };
+
+        static EditorPool& getInstance();
+
+        /**
+         * @brief Returns an Editor from the pool, or a new one if the pool is empty.
+         */
+        Editor *acquire(QWidget *parent);
+
+        /**
+         * @brief Gives back an Editor that is no longer used. The Editor is
+         *        either reset and kept for a later acquire(), or destroyed.
+         */
+        void release(Editor *editor);
+
+        /**
+         * @brief Immediately adds new Editors to the pool, regardless of
+         *        its target size.
+         */
+        void add(const int howMany);
+
+        /**
+         * @brief Destroys all the pooled Editors, e.g. because they
+         *        have been built with an outdated theme.
+         */
+        void invalidate();
+
+        int size() const;
+
+        /**
+         * @brief Number of Editors the pool tries to keep ready, based on
+         *        how many of them have been requested recently.
+         */
+        int targetSize() const;
+
+        /**
+         * @brief Maximum number of Editors the pool may hold without
+         *        exceeding the configured memory limit.
+         */
+        int maximumSize() const;
+
+        const Statistics &statistics() const;
+
+    private:
+        explicit EditorPool(QObject *parent = 0);
+
+        /**
+         * @brief Rough memory footprint of an idle Editor, in megabytes.
+         *        QtWebEngine doesn't report the memory used by each page, so the
+         *        pool uses this estimate to enforce the memory limit.
+         */
+        static const int ESTIMATED_EDITOR_MEMORY;
+
+        /**
+         * @brief Requests older than this (in milliseconds) no longer
+         *        contribute to the target size.
+         */
+        static const qint64 REQUEST_RATE_WINDOW;
+
+        static const int WARM_UP_INTERVAL;
+
+        QQueue<Editor *> m_editors;
+        QQueue<qint64> m_recentRequests;
+        QElapsedTimer m_clock;
+        QTimer m_warmUpTimer;
+        Statistics m_statistics;
+
+        void forgetOldRequests();
+        void scheduleWarmUp();
+
+    private slots:
+        void on_warmUpTimeout();
+    };
+
+}
+
+#endif // EDITORPOOL_H
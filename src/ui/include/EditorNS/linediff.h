@@ -0,0 +1,84 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+
+namespace EditorNS
+{
+
+    /**
+     * @brief Line-level diff of two texts.
+     *
+     * The lines both texts start and end with are skipped first, by comparing
+     * them directly. The remaining lines are hashed into integer ids, and
+     * diffed with the histogram algorithm (as in git and JGit): the region is
+     * split around the longest run of common lines that occur the least, and
+     * the two halves are diffed in the same way. Unlike Myers' algorithm, the
+     * cost doesn't explode with the number of differences, so two big files
+     * that have little in common are diffed as quickly as two that only
+     * differ by a line. A region whose lines all occur too often to split it
+     * around, as in logs, is diffed with Myers' algorithm instead.
+     */
+    class LineDiff
+    {
+    public:
+        /**
+         * @brief Lines [fromA, fromA + countA) of the first text are replaced
+         *        by lines [fromB, fromB + countB) of the second one. One of
+         *        the counts is 0 for lines that were only added or removed.
+         */
+        struct Hunk {
+            int fromA;
+            int countA;
+            int fromB;
+            int countB;
+        };
+
+        /**
+         * @param a, b Texts whose lines are separated by '\n'.
+         * @return The hunks, sorted and not adjacent to each other.
+         */
+        static QVector<Hunk> compute(const QString &a, const QString &b);
+
+        /**
+         * @brief Diffs two sequences of line ids: equal lines have the same id.
+         */
+        static QVector<Hunk> compute(const QVector<int> &a, const QVector<int> &b);
+
+    private:
+        /**
+         * @brief Lines that occur more than this many times within a region
+         *        aren't used to split it, as in JGit.
+         */
+        static const int MAX_OCCURRENCES;
+
+        /**
+         * @brief Regions that Myers' algorithm can't diff within this many
+         *        added or removed lines are reported as a single hunk.
+         */
+        static const int MAX_EDIT_COST;
+
+        struct Region {
+            int aBegin;
+            int aEnd;
+            int bBegin;
+            int bEnd;
+        };
+
+        static QVector<QStringRef> splitLines(const QString &text);
+
+        /**
+         * @brief Diffs a region with Myers' algorithm, appending its hunks.
+         * @return False, leaving the hunks alone, if it costs more than
+         *         MAX_EDIT_COST.
+         */
+        static bool myers(const QVector<int> &a, const QVector<int> &b, const Region &region, QVector<Hunk> &hunks);
+
+        static void appendHunk(QVector<Hunk> &hunks, const Region &region);
+    };
+
+}
+
+#endif // LINEDIFF_H
@@ -0,0 +1,69 @@
+#ifndef TEXTTRANSFORM_H
+#define TEXTTRANSFORM_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace EditorNS
+{
+
+    /**
+     * @brief Line-based transformations of a whole document (trimming,
+     *        tab/space conversion, ...).
+     *
+     * They run on a snapshot of the document, split into chunks of lines that
+     * are processed in parallel. The result is the list of the line ranges that
+     * actually changed, so that the editor only has to touch those.
+     */
+    class TextTransform
+    {
+    public:
+        enum Operation {
+            TrimTrailingSpace,
+            TrimLeadingSpace,
+            TrimLeadingTrailingSpace,
+            TabToSpace,
+            SpaceToTabAll,
+            SpaceToTabLeading,
+            EolToSpace
+        };
+
+        /**
+         * @brief Replaces the lines in [fromLine, toLine) with the given lines.
+         */
+        struct Patch {
+            int fromLine;
+            int toLine;
+            QStringList lines;
+        };
+
+        /**
+         * @brief Applies the operation to the given lines.
+         * @param lines The document, one string per line, without EOL characters.
+         * @param operation
+         * @param tabSize Width of a tab, used by the tab/space conversions.
+         * @return The patches that turn the document into the transformed one,
+         *         sorted by line and not overlapping.
+         */
+        static QList<Patch> apply(const QStringList &lines, Operation operation, int tabSize);
+
+        /**
+         * @brief Applies the operation to a single line.
+         */
+        static QString transformLine(const QString &line, Operation operation, int tabSize);
+
+    private:
+        /**
+         * @brief Lines processed by each parallel task. Smaller chunks
+         *        aren't worth the cost of scheduling them.
+         */
+        static const int CHUNK_SIZE;
+
+        static QString tabToSpace(const QString &line, int tabSize);
+        static QString spaceToTab(const QString &line, bool leadingOnly, int tabSize);
+    };
+
+}
+
+#endif // TEXTTRANSFORM_H
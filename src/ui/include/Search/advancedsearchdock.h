@@ -155,7 +155,9 @@ private:
     QCheckBox*   m_chkMatchWords;
     QCheckBox*   m_chkUseRegex;
     QCheckBox*   m_chkUseSpecialChars;
+    QCheckBox*   m_chkMultiTerm;
     QCheckBox*   m_chkIncludeSubdirs;
+    QCheckBox*   m_chkUseIndex;
 
     // Replace panel items
     QComboBox*   m_cmbReplaceText;
@@ -0,0 +1,148 @@
+#ifndef DOCUMENTSEARCH_H
+#define DOCUMENTSEARCH_H
+
+#include "include/EditorNS/editor.h"
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QString>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+/**
+ * @brief Keeps an index of all the matches of a regex within the document of an
+ *        Editor, so that the number of matches and the position of the selected
+ *        one are always known without going through the document again.
+ *
+ * The search runs against a copy of the text. Once the copy is taken, the page
+ * sends every change made to the document (see C_FUN_START_SEARCH_TRACKING in
+ * app.js) and the copy and the index are patched in place: only the lines
+ * touched by the change are searched again, unless the pattern is able to match
+ * across lines. Only the matches within the visible part of the document are
+ * sent back to be highlighted.
+ *
+ * The tracking stops, and the highlights are removed, when the object is destroyed.
+ */
+class DocumentSearch : public QObject
+{
+    Q_OBJECT
+public:
+    struct Match {
+        int start;
+        int length;
+    };
+
+    /**
+     * @brief Where findNext() starts looking from.
+     */
+    enum Origin {
+        AfterSelection, // Forward from the end of the selection, backwards from its start
+        SelectionStart, // From the start of the selection, so that it can match again
+        DocumentStart
+    };
+
+    explicit DocumentSearch(EditorNS::Editor *editor, QObject *parent = 0);
+    ~DocumentSearch();
+
+    EditorNS::Editor *editor() const;
+
+    /**
+     * @brief Sets the regex to look for, as returned by SearchString::format(),
+     *        and rebuilds the index. An empty regex matches nothing.
+     * @return false if the regex is not valid.
+     */
+    bool setPattern(const QString &regex, bool caseSensitive);
+    QString pattern() const;
+    bool isValid() const;
+    bool caseSensitive() const;
+
+    /**
+     * @brief Whether the copy of the document has been received. Until then,
+     *        there are no matches.
+     */
+    bool isReady() const;
+    void waitUntilReady();
+
+    int matchCount() const;
+
+    /**
+     * @brief Index of the match that is exactly the primary selection, or -1.
+     */
+    int currentMatch() const;
+
+    /**
+     * @brief Selects the first match after the primary selection, or the last
+     *        one before it, wrapping around the document.
+     * @return The index of the selected match, or -1 if there are no matches.
+     */
+    int findNext(bool forward, Origin origin = AfterSelection);
+
+    /**
+     * @brief Selects all the matches.
+     * @return The number of matches.
+     */
+    int selectAll();
+
+signals:
+    /**
+     * @brief Emitted when matchCount() or currentMatch() may have changed.
+     */
+    void matchesChanged();
+    void ready();
+
+private:
+    static const int MAX_HIGHLIGHTS;
+    static const int HIGHLIGHT_DELAY;
+
+    QPointer<EditorNS::Editor> m_editor;
+    QRegularExpression m_regex;
+    bool m_spansLines = false;
+
+    QString m_text;
+    QVector<int> m_lineStarts;
+    QVector<Match> m_matches;
+
+    bool m_ready = false;
+    bool m_snapshotPending = false;
+    qint64 m_seq = 0;
+    QList<QVariantMap> m_pendingChanges;
+
+    int m_viewportFrom = 0;
+    int m_viewportTo = 0;
+    EditorNS::Editor::Selection m_selection;
+    QTimer m_highlightTimer;
+
+    bool hasPattern() const;
+    void requestSnapshot();
+    void onSnapshotReceived(const QVariantMap &snapshot);
+    void onMessageReceived(QString msg, QVariant data);
+    void processChange(const QVariantMap &change);
+
+    /**
+     * @brief Applies a change received from the page to the copy of the text,
+     *        the line index and the match index.
+     * @return false if the change doesn't fit the copy, that must then be
+     *         taken again.
+     */
+    bool applyChange(const QVariantMap &change);
+
+    void rebuildLineStarts();
+    void rescan();
+    void scan(int from, int to, QVector<Match> &out) const;
+    void sendHighlights();
+
+    /**
+     * @brief Offset within the copy of the text of a position in the
+     *        document, or -1 if there's no such position.
+     */
+    int offsetOf(int line, int column) const;
+    int offsetOf(const EditorNS::Editor::Cursor &cursor) const;
+    EditorNS::Editor::Cursor cursorAt(int offset) const;
+
+    static EditorNS::Editor::Selection selectionFromData(const QVariantList &data);
+};
+
+#endif // DOCUMENTSEARCH_H
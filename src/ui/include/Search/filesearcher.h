@@ -1,17 +1,34 @@
 #ifndef FILESEARCHER_H
 #define FILESEARCHER_H
 
+#include "multitermmatcher.h"
+#include "regexprefilter.h"
 #include "searchhelpers.h"
 #include "searchobjects.h"
+#include "utf8search.h"
 
 #include <QObject>
 #include <QRegularExpression>
 #include <QThread>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+class TrigramIndex;
+
 /**
  * @brief The FileSearcher class contains the tools to search strings and files asynchronously and synchronously.
  *        Use prepareAsyncSearch() and run start() on the returned FileSearcher* object to search files
- *        asynchronously. Use searchPlainText() and searchRegExp() to search strings synchronously.
+ *        asynchronously. Use searchPlainText(), searchRegExp() and searchMultiTerm() to search strings
+ *        synchronously.
+ *
+ *        Files are searched in parallel by as many workers as there are cores. The results are handed out
+ *        in batches while the search is running: resultBatchReady() is emitted when there are results to
+ *        be collected with takeResultBatch().
+ *
+ *        If SearchConfig::useIndex is set, the files that the TrigramIndex of the directory rules out
+ *        aren't read at all, and the index learns about the others as they're searched.
  */
 class FileSearcher : public QThread {
     Q_OBJECT
@@ -26,7 +43,8 @@ public:
 
     /**
      * @brief createRegexFromConfig Creates a RegularExpression based on the given config that can be used
-     *                              in conjuncture with searchRegExp()
+     *                              in conjuncture with searchRegExp(). Recently used ones are kept, so that
+     *                              the same pattern isn't compiled again for every search.
      */
     static QRegularExpression createRegexFromConfig(const SearchConfig& config);
 
@@ -42,9 +60,20 @@ public:
      * @brief searchRegExp  Searches a given string via a RegularExpression (synchronously)
      * @param regex The RegExp to be used. Can be created  via createRegexFromString()
      * @param content The string to be searched
+     * @param prefilter Built from 'regex'. Lets the parts of the string that can't match be skipped.
      * @return A DocResult containing all found matches.
      */
-    static DocResult searchRegExp(const QRegularExpression& regex, const QString& content);
+    static DocResult searchRegExp(const QRegularExpression& regex, const QString& content,
+                                  const RegexPrefilter& prefilter = RegexPrefilter());
+
+    /**
+     * @brief searchMultiTerm Searches a given string for any of several terms at once (synchronously)
+     * @param matcher The terms to be searched for. Can be created from SearchConfig::getTerms()
+     * @param matchWord True if only whole words should match
+     * @param content The string to be searched
+     * @return A DocResult containing all found matches, tagged with the term that matched.
+     */
+    static DocResult searchMultiTerm(const MultiTermMatcher& matcher, bool matchWord, const QString& content);
 
     /**
      * @brief cancel Orders the FileSearcher to stop searching at the earliest convenience. Won't immediately stop.
@@ -52,17 +81,26 @@ public:
     void cancel() { m_wantToStop = true; }
 
     /**
-     * @brief getResult Returns a SearchResult item with all found results. Will be empty until the FileSearcher
-     *                  completely finished its search and emitted resultReady()
+     * @brief takeResultBatch Returns the results found since the last call, in no particular order.
+     *                        Thread-safe. Once resultReady() has been emitted, the last batch holds
+     *                        all the results that haven't been taken yet.
      */
-    const SearchResult& getResult() { return m_searchResult; }
+    QVector<DocResult> takeResultBatch();
 
 signals:
     /**
      * @brief resultProgress is emitted periodically. 'Processed' is the number of files already searched.
-     *                       'Total' is the total number of files to be searched.
+     *                       'Discovered' is the number of files found so far in the directory, which is
+     *                       the total number of files to be searched once 'discoveryComplete' is true.
      */
-    void resultProgress(int processed, int total);
+    void resultProgress(int processed, int discovered, bool discoveryComplete);
+
+    /**
+     * @brief resultBatchReady is emitted when new results can be collected with takeResultBatch(): at
+     *                         most every BATCH_INTERVAL milliseconds, or as soon as BATCH_MATCHES matches
+     *                         have been found. It's not emitted again until the batch has been taken.
+     */
+    void resultBatchReady();
     void resultReady();
 
 protected:
@@ -71,10 +109,48 @@ protected:
 private:
     FileSearcher(const SearchConfig& config);
 
+    /**
+     * @brief QUEUE_CAPACITY Maximum number of files found and not searched yet. The directory
+     *                       traversal waits for the workers when it gets that far ahead.
+     */
+    static const int QUEUE_CAPACITY;
+
+    static const int BATCH_INTERVAL;
+    static const int BATCH_MATCHES;
+
+    /**
+     * @brief REGEX_CACHE_SIZE Number of compiled regular expressions kept by createRegexFromConfig().
+     */
+    static const int REGEX_CACHE_SIZE;
+
+    /**
+     * @brief searchFile Reads and searches a single file. Called concurrently by the workers.
+     * @param reindex True if the contents of the file have to be added to the index.
+     */
+    DocResult searchFile(const QString& fileName, bool reindex) const;
+
+    /**
+     * @brief addResult Adds the result of a file to the current batch. Called concurrently by the workers.
+     */
+    void addResult(DocResult&& result);
+
+    /**
+     * @brief flushBatch Emits resultBatchReady() if there are results waiting.
+     */
+    void flushBatch();
+
     SearchConfig m_searchConfig;
     QRegularExpression m_regex;
-    bool m_wantToStop = false;
-    SearchResult m_searchResult;
+    RegexPrefilter m_regexPrefilter;
+    Utf8Search m_utf8Search;
+    MultiTermMatcher m_multiTermMatcher;
+    std::shared_ptr<TrigramIndex> m_index;  // Null if the search doesn't use one
+    std::atomic<bool> m_wantToStop{false};
+
+    std::mutex m_batchMutex;
+    QVector<DocResult> m_batch;
+    int m_batchMatches = 0;
+    bool m_batchSignaled = false;
 };
 
 #endif // FILESEARCHER_H
@@ -1,6 +1,7 @@
 #ifndef FRMSEARCHREPLACE_H
 #define FRMSEARCHREPLACE_H
 
+#include "include/Search/documentsearch.h"
 #include "include/Search/searchhelpers.h"
 #include "include/topeditorcontainer.h"
 
@@ -46,6 +47,7 @@ public:
     void replaceFromUI(bool forward, bool searchFromStart = false);
 protected:
     void keyPressEvent(QKeyEvent *evt);
+    void hideEvent(QHideEvent *evt);
 
 signals:
     void toggleAdvancedSearch();
@@ -64,17 +66,29 @@ private slots:
     void on_radSearchPlainText_toggled(bool checked);
     void on_radSearchWithSpecialChars_toggled(bool checked);
     void on_searchStringEdited(const QString &text);
+    void updateMatchCount();
 
 private:
     Ui::frmSearchReplace*  ui;
     TopEditorContainer*    m_topEditorContainer;
     QString                m_lastSearch;
+    DocumentSearch*        m_documentSearch = nullptr;
 
    /**
     * @brief Get the current editor.
     */
     Editor*                currentEditor();
 
+   /**
+    * @brief Get the match index of the current editor, creating it if needed.
+    */
+    DocumentSearch*        documentSearch();
+   /**
+    * @brief Give the search string and the options from the UI to the match
+    *        index, so that the number of matches is kept up to date.
+    */
+    void updatePattern();
+
    /**
     * @brief Perform a search within the current document.
     * @param `string`:        The string to search for.
@@ -0,0 +1,41 @@
+#ifndef LINECOUNTER_H
+#define LINECOUNTER_H
+
+#include <QString>
+
+/**
+ * @brief The LineCounter class tells which line a position of a text is on. It only counts the line breaks
+ *        between one position and the next, so a text is never read further than its last match, and a text
+ *        without matches isn't read at all. "\r\n", "\r" and "\n" all end a line.
+ *
+ *        Line breaks are looked for 16 characters at a time with SSE2, where available.
+ */
+class LineCounter {
+public:
+    explicit LineCounter(const QString& text) : m_text(text) {}
+
+    /**
+     * @brief moveTo Moves to the line of the given position. Positions have to be given in increasing order.
+     */
+    void moveTo(int position);
+
+    int line() const { return m_line; }             // Starting from 1
+    int lineStart() const { return m_lineStart; }
+
+    /**
+     * @brief lineEnd Returns where the line break of the current line is, or the length of the text if
+     *                it's the last line.
+     */
+    int lineEnd();
+
+private:
+    const QString& m_text;
+    int m_position = 0;     // Line breaks before this have been counted
+    int m_line = 1;
+    int m_lineStart = 0;
+    int m_lineEnd = -1;     // -1 until it's needed
+
+    void countScalar(int from, int to);
+};
+
+#endif // LINECOUNTER_H
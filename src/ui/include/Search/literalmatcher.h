@@ -0,0 +1,64 @@
+#ifndef LITERALMATCHER_H
+#define LITERALMATCHER_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief The LiteralMatcher class finds a fixed string in a block of text, faster than QByteArray::indexOf()
+ *        and QString::indexOf() do on large files.
+ *
+ *        The two rarest bytes of the needle are looked for together, 16 or 32 positions at a time with SSE2
+ *        or AVX2, and only the positions where both are in place are compared with the whole needle. The
+ *        best implementation is picked at runtime; other CPUs get a portable one built on memchr().
+ *
+ *        Case-insensitive matchers fold ASCII letters only. Whether that's enough for the needle and the
+ *        text is up to the caller.
+ */
+class LiteralMatcher {
+public:
+    LiteralMatcher() = default;
+
+    /**
+     * @brief LiteralMatcher Matcher for bytes, e.g. UTF-8 text.
+     */
+    LiteralMatcher(const QByteArray& needle, bool matchCase);
+
+    /**
+     * @brief LiteralMatcher Matcher for the UTF-16 code units of a QString.
+     */
+    LiteralMatcher(const QString& needle, bool matchCase);
+
+    bool isEmpty() const { return m_needle.isEmpty(); }
+
+    /**
+     * @brief indexIn Returns the byte offset of the first match at or after 'from', or -1.
+     *                Only for matchers built from a QByteArray.
+     */
+    int indexIn(const char* data, int size, int from = 0) const;
+
+    /**
+     * @brief indexIn Returns the position of the first match at or after 'from', or -1.
+     *                Only for matchers built from a QString.
+     */
+    int indexIn(const QString& text, int from = 0) const;
+
+    /**
+     * @brief implementationName The implementation picked for this CPU: "avx2", "sse2" or "generic".
+     */
+    static const char* implementationName();
+
+private:
+    // A byte of the text matches the byte of the needle at the same offset if (byte | mask) == needle byte.
+    // The mask is 0x20 for the letters of a case-insensitive needle, and 0 otherwise.
+    QByteArray m_needle;        // Lower case if case-insensitive
+    QByteArray m_foldMask;      // Empty if case-sensitive
+    int m_rare1 = 0;            // Offsets of the two rarest bytes of the needle
+    int m_rare2 = 0;
+    int m_unitSize = 1;         // Matches can only start at multiples of this
+
+    void init(int unitSize);
+    int find(const uchar* data, int size, int from) const;
+};
+
+#endif // LITERALMATCHER_H
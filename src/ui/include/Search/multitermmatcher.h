@@ -0,0 +1,61 @@
+#ifndef MULTITERMMATCHER_H
+#define MULTITERMMATCHER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * @brief The MultiTermMatcher class finds any of a list of terms in a text in a single pass, with an Aho-Corasick
+ *        automaton. Matches don't overlap: the one that starts first wins, and the longest term if several
+ *        start at the same position.
+ *
+ *        Case-insensitive matchers compare the case-folded characters, like QString::indexOf() does.
+ */
+class MultiTermMatcher {
+public:
+    struct Match {
+        int position = -1;
+        int length = 0;
+        int term = -1;      // Index of the term in the list given to the constructor
+    };
+
+    MultiTermMatcher() = default;
+    MultiTermMatcher(const QStringList& terms, bool matchCase);
+
+    bool isEmpty() const { return m_depth.size() <= 1; }
+
+    /**
+     * @brief indexIn Returns the first match at or after 'from'. Its position is -1 if there's none.
+     */
+    Match indexIn(const QString& text, int from = 0) const;
+
+    /**
+     * @brief shorterMatch Returns the longest term that starts where 'match' does in the text and is shorter
+     *                     than it. Its position is -1 if there's none.
+     */
+    Match shorterMatch(const QString& text, const Match& match) const;
+
+private:
+    static const int ASCII_SIZE;
+
+    bool m_matchCase = true;
+
+    // State 0 is the root. ASCII characters go through a full transition table; the others go through
+    // the edges of the trie, and fall back along the failure links.
+    std::vector<int> m_asciiNext;   // ASCII_SIZE transitions per state
+    QHash<quint64, int> m_edges;    // Keyed by state << 16 | character
+    std::vector<int> m_fail;
+    std::vector<int> m_depth;
+    std::vector<int> m_term;        // The term that ends at each state, or -1
+    std::vector<int> m_output;      // The deepest state down the failure links, this one included, where a term ends. 0 if none.
+
+    int addState(int depth);
+    int next(int state, ushort c) const;
+    ushort fold(ushort c) const;
+    static quint64 edgeKey(int state, ushort c) { return (static_cast<quint64>(state) << 16) | c; }
+};
+
+#endif // MULTITERMMATCHER_H
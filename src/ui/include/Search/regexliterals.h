@@ -0,0 +1,48 @@
+#ifndef REGEXLITERALS_H
+#define REGEXLITERALS_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The RegexLiterals class looks for the plain strings that any match of a regular expression has to
+ *        contain, e.g. "foo" and "bar" for "foo\w+bar". They let files that can't match be skipped without
+ *        running the regular expression on them.
+ *
+ *        The analysis is conservative: when in doubt, a part of the pattern is ignored, so the strings found
+ *        may be fewer or shorter than they could be, but never wrong.
+ */
+class RegexLiterals {
+public:
+    /**
+     * @brief required Returns strings that every match of the pattern contains, as they are written: a
+     *                 case-insensitive pattern matches them in any case. Empty if nothing is certain, e.g.
+     *                 if there's an alternation at the top level.
+     */
+    static QStringList required(const QString& pattern);
+
+    /**
+     * @brief singleLine True if no match of the pattern can contain a line feed, so that every match lies
+     *                   within a line. Only meaningful with QRegularExpression::MultilineOption; as above, a
+     *                   pattern that's too hard to tell about is taken to span lines.
+     */
+    static bool singleLine(const QString& pattern);
+
+private:
+    static int skipGroup(const QString& pattern, int i);
+    static int skipClass(const QString& pattern, int i);
+    static int skipEscape(const QString& pattern, int i);
+
+    /**
+     * @brief quantifier Returns 1 if there's a quantifier at 'i', setting where it ends and the least number of
+     *                   repetitions it allows; 0 if there's none; -1 if it's unclear.
+     */
+    static int quantifier(const QString& pattern, int i, int& end, int& min);
+
+    /**
+     * @brief safeEscape True if the escape sequence at 'i' can't match a line feed.
+     */
+    static bool safeEscape(const QString& pattern, int i);
+};
+
+#endif // REGEXLITERALS_H
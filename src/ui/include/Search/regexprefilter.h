@@ -0,0 +1,63 @@
+#ifndef REGEXPREFILTER_H
+#define REGEXPREFILTER_H
+
+#include "literalmatcher.h"
+
+#include <QRegularExpression>
+#include <QString>
+
+#include <vector>
+
+/**
+ * @brief The RegexPrefilter class rules out text that a regular expression can't match, by looking for the
+ *        plain strings that every match contains (see RegexLiterals). That's much faster than running the
+ *        regular expression, and needs no decoding when the text is UTF-8.
+ *
+ *        When no match can span lines, it also narrows the text down to the lines that contain the longest
+ *        of those strings, so that the regular expression only runs on them.
+ */
+class RegexPrefilter {
+public:
+    RegexPrefilter() = default;
+    explicit RegexPrefilter(const QRegularExpression& regex);
+
+    /**
+     * @brief isEmpty True if nothing can be ruled out.
+     */
+    bool isEmpty() const { return m_literals.empty(); }
+
+    /**
+     * @brief canMatch False if the UTF-8 text can't contain a match.
+     */
+    bool canMatch(const char* utf8, int size) const;
+
+    /**
+     * @brief appliesTo False if the functions below can't be used on the text.
+     */
+    bool appliesTo(const QString& text) const;
+
+    /**
+     * @brief canMatch False if the text can't contain a match.
+     */
+    bool canMatch(const QString& text) const;
+
+    /**
+     * @brief nextRegion Returns where the first match at or after 'from' can start at the earliest, or -1
+     *                   if there's none.
+     * @param end Set to where that match ends at the latest: the end of its line if matches can't span
+     *            lines, otherwise the end of the text.
+     */
+    int nextRegion(const QString& text, int from, int& end) const;
+
+private:
+    struct Literal {
+        LiteralMatcher bytes;
+        LiteralMatcher units;
+    };
+
+    std::vector<Literal> m_literals;    // Longest first
+    bool m_singleLine = false;
+    bool m_foldsFromNonAscii = false;   // Whether the Kelvin sign or the long s may match a literal
+};
+
+#endif // REGEXPREFILTER_H
@@ -71,6 +71,7 @@ signals:
 
     /**
      * @brief itemInteracted Emitted when an item in the current tree widget is interacted with.
+     *                       The arguments are copies, so they stay valid while results keep coming in.
      * @param doc The selected DocResult
      * @param result The selected MatchResult. If this is nullptr then the user only selected a DocResult
      * @param type The kind of interaction requested by the user
@@ -78,9 +79,37 @@ signals:
     void itemInteracted(const DocResult& doc, const MatchResult* result, SearchUserInteraction type);
 
 private:
-    void onSearchProgress(int processed, int total);
+    void onSearchProgress(int processed, int discovered, bool discoveryComplete);
+    void onResultBatchReady();
     void onSearchCompleted();
 
+    /**
+     * @brief addResults Appends the given DocResults to m_searchResult and adds their items to the
+     *                   tree widget, which is kept sorted by file name.
+     */
+    void addResults(QVector<DocResult> results);
+
+    /**
+     * @brief populate Creates the items of a toplevel item's MatchResults, if it doesn't have them yet.
+     *                 They're only created once the item is expanded, since most of them are never seen.
+     */
+    void populate(QTreeWidgetItem* item);
+
+    /**
+     * @brief interact Emits itemInteracted() for a toplevel or sublevel item, if it has a result.
+     */
+    void interact(QTreeWidgetItem* item, SearchUserInteraction type);
+
+    /**
+     * @brief docResult Returns the DocResult of a toplevel item, or nullptr if it isn't one.
+     */
+    const DocResult* docResult(QTreeWidgetItem* item) const;
+
+    /**
+     * @brief matchResult Returns the MatchResult of a sublevel item, or nullptr if it isn't one.
+     */
+    const MatchResult* matchResult(QTreeWidgetItem* item) const;
+
     bool m_isSearchInProgress = true; // Search is started in the constructor so it can default to true
     bool m_resultsAreExpanded = false;
     bool m_showFullLines = false;
@@ -96,9 +125,14 @@ private:
     QAction*                    m_actionOpenDocument;
     QAction*                    m_actionOpenFolder;
 
-    // These map each QTreeWidget item to their respective MatchResult or DocResult
-    std::map<QTreeWidgetItem*, const MatchResult*>  m_resultMap;
-    std::map<QTreeWidgetItem*, const DocResult*>    m_docMap;
+    // Shows the progress of a file search, on top of the results found so far
+    QTreeWidgetItem*            m_progressItem = nullptr;
+
+    // These map each QTreeWidget item to the index of their respective DocResult in m_searchResult,
+    // and to the index of their MatchResult within it. m_searchResult grows while the results come
+    // in, so pointers to its items wouldn't last.
+    std::map<QTreeWidgetItem*, std::pair<int, int>> m_resultMap;
+    std::map<QTreeWidgetItem*, int>                 m_docMap;
 };
 
 
@@ -4,8 +4,8 @@
 #include "include/Search/searchhelpers.h"
 
 #include <QObject>
-#include <QRegularExpressionMatch>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 
 class MainWindow;
@@ -22,6 +22,11 @@ struct SearchConfig {
      */
     QString getScopeAsString() const;
 
+    /**
+     * @brief getTerms Returns the terms to search for, one per line of searchString. Only used if
+     *                 searchMode==ModeMultiTerm.
+     */
+    QStringList getTerms() const;
 
     QString searchString;
     QString filePattern; // Only used if searchMode==ScopeFileSystem.
@@ -31,6 +36,7 @@ struct SearchConfig {
     bool matchCase      = false;
     bool matchWord      = false;
     bool includeSubdirs = false; // Only used if searchMode==ScopeFileSystem.
+    bool useIndex       = false; // Only used if searchMode==ScopeFileSystem. See TrigramIndex.
 
     enum SearchScope {
         ScopeCurrentDocument    = 0,
@@ -42,38 +48,25 @@ struct SearchConfig {
     enum SearchMode {
         ModePlainText               = 0,
         ModePlainTextSpecialChars   = 1,
-        ModeRegex                   = 2
+        ModeRegex                   = 2,
+        ModeMultiTerm               = 3
     };
     SearchMode searchMode = ModePlainText;
 };
 
+/**
+ * @brief The MatchResult struct A match, as a fixed-size record. Its text and that of its line are kept by
+ *        the DocResult it belongs to: use DocResult's functions to get them.
+ */
 struct MatchResult {
-    /**
-     * @brief getMatchString Returns the match as a string
-     */
-    QString getMatchString() const;
-
-    /**
-     * @brief getPreMatchString Returns the part of the line before the match.
-     * @param fullText If false, the text length is limited to CUTOFF_LENGTH characters
-     */
-    QString getPreMatchString(bool fullText=false) const;
-
-    /**
-     * @brief getPostMatchString Returns the part of the line after the match.
-     * @param fullText If false, the text length is limited to CUTOFF_LENGTH characters
-     */
-    QString getPostMatchString(bool fullText=false) const;
-
-    QString matchLineString; // The full text line where the match occured
     int lineNumber;          // The line number, starting at 1
     int positionInFile;      // The match's offset from the beginning of the file
     int positionInLine;      // The match's offset from the beginning of the line
     int matchLength;         // The match's length
-    QRegularExpressionMatch regexMatch; // Only valid if this MatchResult was created by a regex search
-
-private:
-    static const int CUTOFF_LENGTH; //Number of characters before/after match result that will be shown in preview
+    int termIndex = -1;      // Which of SearchConfig::getTerms() matched. Only used in ModeMultiTerm searches
+    int lineOffset = 0;      // Where the text of the line is in DocResult::lines
+    int lineLength = 0;
+    int captureOffset = -1;  // Where the capture groups are in DocResult::captures. Only used in regex searches
 };
 
 namespace EditorNS { class Editor; }
@@ -91,6 +84,48 @@ struct DocResult {
     QString fileName;                   // Is a file path when docType==TypeFile and a file name when TypeDocument
     QVector<MatchResult> results;
     int regexCaptureGroupCount = 0;     // Only used when DocResult was created by a regex search
+
+    // Shared by all the results. Copies of a DocResult, even with fewer results, share them too.
+    QString lines;                      // The text of every line with a match, once, without the trailing whitespace
+    QVector<int> captures;              // The offset and length of every capture group of every match, from group 1
+
+    /**
+     * @brief addLine Adds the text of the result's line to 'lines', or shares that of the previous result if
+     *                it's on the same line.
+     */
+    void addLine(MatchResult& result, const QStringRef& line);
+
+    /**
+     * @brief getLineString Returns the text line where the match occured
+     */
+    QString getLineString(const MatchResult& result) const;
+
+    /**
+     * @brief getMatchString Returns the match as a string
+     */
+    QString getMatchString(const MatchResult& result) const;
+
+    /**
+     * @brief getPreMatchString Returns the part of the line before the match.
+     * @param fullText If false, the text length is limited to CUTOFF_LENGTH characters
+     */
+    QString getPreMatchString(const MatchResult& result, bool fullText=false) const;
+
+    /**
+     * @brief getPostMatchString Returns the part of the line after the match.
+     * @param fullText If false, the text length is limited to CUTOFF_LENGTH characters
+     */
+    QString getPostMatchString(const MatchResult& result, bool fullText=false) const;
+
+    /**
+     * @brief capturedStart Returns the offset in the file of a capture group of the match, from 1 to
+     *                      regexCaptureGroupCount, or -1 if it didn't capture anything.
+     */
+    int capturedStart(const MatchResult& result, int group) const;
+    int capturedLength(const MatchResult& result, int group) const;
+
+private:
+    static const int CUTOFF_LENGTH; //Number of characters before/after match result that will be shown in preview
 };
 
 enum class SearchUserInteraction {
@@ -15,6 +15,17 @@ public:
     */
     static QString format(QString regex, SearchHelpers::SearchMode searchMode, const SearchHelpers::SearchOptions &searchOptions);
 
+   /**
+    * @brief Formats a search string for use in a QRegularExpression. Unlike format(), the special
+    *        characters are unescaped before the string is escaped, and the escapes of a regex that
+    *        only JavaScript knows, such as \uXXXX, are translated.
+    * @param regex          The string to be worked on, either regex or not.
+    * @param searchMode     If mode==regex, will return an escaped string
+    * @param searchOptions  Handles wholeWord search option
+    * @return QString       A regex string
+    */
+    static QString formatRegularExpression(QString regex, SearchHelpers::SearchMode searchMode, const SearchHelpers::SearchOptions &searchOptions);
+
    /**
     * @brief Unescape escape sequences in `data`
     * @param `data`:     The string to be worked on.
@@ -0,0 +1,163 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief The TrigramIndex class remembers which trigrams (runs of three bytes) the files of a directory tree
+ *        contain, so that a search only has to read the files that can match.
+ *
+ *        Files are indexed by the UTF-8 form of their text, with ASCII letters in lower case, whatever their
+ *        encoding. The index is kept up to date by the searches that use it: files that are new, that changed
+ *        size or modification time, or that the file watcher reported as changed (see invalidate()) are
+ *        indexed again as they're searched. The indexes used last stay in memory; they're saved under
+ *        PersistentCache::searchIndexDirPath().
+ *
+ *        All the functions are thread-safe.
+ */
+class TrigramIndex {
+public:
+    /**
+     * @brief The Query struct What a file needs to have for a search to match in it: all the trigrams of
+     *        at least one of the alternatives.
+     */
+    struct Query {
+        QVector<QVector<quint32>> alternatives;
+
+        /**
+         * @brief matchesAll True if the query can't rule out any file, e.g. because one of the strings
+         *                   searched for is shorter than a trigram.
+         */
+        bool matchesAll() const;
+    };
+
+    /**
+     * @brief literalQuery Query for a search for any of the given strings.
+     */
+    static Query literalQuery(const QStringList& strings, bool matchCase);
+
+    /**
+     * @brief regexQuery Query for a search with the given regular expression, made of the plain strings
+     *                   every match has to contain.
+     */
+    static Query regexQuery(const QString& pattern);
+
+    /**
+     * @brief forDirectory Returns the index of the directory, loading it if needed. It's empty if the
+     *                     directory has never been indexed.
+     */
+    static std::shared_ptr<TrigramIndex> forDirectory(const QString& directory);
+
+    /**
+     * @brief invalidate Makes the file be indexed again the next time it's searched, even if its size
+     *                   and modification time look the same. Only files within the directory of an index
+     *                   in memory are remembered.
+     */
+    static void invalidate(const QString& filePath);
+
+    enum class FileStatus {
+        Skip,       // Can't match
+        Search,     // May match
+        Reindex     // Not indexed yet, or out of date: has to be searched and indexed again
+    };
+
+    /**
+     * @brief match Returns, for every file id of the index, whether the file has the trigrams of the query.
+     */
+    QBitArray match(const Query& query) const;
+
+    /**
+     * @brief check Tells what to do with a file found while walking the directory.
+     * @param matches Returned by match().
+     */
+    FileStatus check(const QString& filePath, const QFileInfo& info, const QBitArray& matches) const;
+
+    /**
+     * @brief update Indexes a file again.
+     * @param utf8 The text of the file in UTF-8, or nullptr if it can't be indexed. Such a file
+     *             is searched every time.
+     */
+    void update(const QString& filePath, qint64 modified, qint64 size, const char* utf8, int length);
+
+    /**
+     * @brief removeMissing Forgets the files that the search would have found if they still existed.
+     * @param seen The files found by the search, as given by relativePath().
+     * @param inScope Returns whether the search would have found a file, given its relative path.
+     */
+    void removeMissing(const QSet<QString>& seen, const std::function<bool(const QString&)>& inScope);
+
+    /**
+     * @brief save Writes the index to disk, if it changed since it was loaded or last saved.
+     */
+    bool save();
+
+    QString relativePath(const QString& filePath) const;
+
+private:
+    explicit TrigramIndex(const QString& directory);
+
+    static const quint32 FILE_MAGIC;
+    static const quint32 FILE_VERSION;
+
+    /**
+     * @brief MAX_FILE_SIZE Bigger files aren't indexed, and are searched every time.
+     */
+    static const int MAX_FILE_SIZE;
+
+    /**
+     * @brief MAX_LOADED_INDEXES Indexes kept in memory once no search uses them. The ones used least
+     *                           recently are dropped first.
+     */
+    static const int MAX_LOADED_INDEXES;
+
+    enum FileFlag : quint8 {
+        FileLive    = 0x1,  // Not deleted, nor superseded by a newer entry
+        FileIndexed = 0x2   // Its trigrams are in the posting lists
+    };
+
+    struct File {
+        QString path;       // Relative to the directory
+        qint64 modified;    // Milliseconds since the epoch
+        qint64 size;
+        quint8 flags;
+    };
+
+    /**
+     * @brief The Posting struct The ids of the files that contain a trigram, in increasing order, each
+     *        stored as a variable-length difference from the previous one.
+     */
+    struct Posting {
+        QByteArray ids;
+        qint32 last = -1;
+        qint32 count = 0;
+    };
+
+    const QString m_directory;
+    const QString m_indexPath;
+
+    mutable std::mutex m_mutex;
+    std::vector<File> m_files;          // By id. Ids only grow while the index is in memory.
+    QHash<QString, int> m_ids;          // The ids of the live files, by path
+    QHash<quint32, Posting> m_postings;
+    int m_deadFiles = 0;
+    bool m_modified = false;
+
+    void load();
+    void compact();
+    static void append(Posting& posting, int id);
+    static std::vector<int> decode(const Posting& posting);
+};
+
+#endif // TRIGRAMINDEX_H
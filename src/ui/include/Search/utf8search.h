@@ -0,0 +1,58 @@
+#ifndef UTF8SEARCH_H
+#define UTF8SEARCH_H
+
+#include "literalmatcher.h"
+#include "searchobjects.h"
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief The Utf8Search class searches plain text directly in the bytes of UTF-8 files, without decoding
+ *        them. Only the lines that contain a match are decoded, to fill in DocResult::lines.
+ *        The results are the same as FileSearcher::searchPlainText() on the decoded text: offsets and
+ *        lengths are in UTF-16 code units, and "\r\n", "\r" and "\n" all end a line.
+ */
+class Utf8Search {
+public:
+    Utf8Search() = default;
+
+    /**
+     * @param needle The string to look for, with the special characters already unescaped.
+     */
+    Utf8Search(const QString& needle, bool matchCase, bool matchWord);
+
+    /**
+     * @brief isValid Returns false if the needle can't be searched as bytes. This is the case of an empty
+     *                needle, or a case-insensitive search for a needle that isn't all ASCII.
+     */
+    bool isValid() const { return !m_needle.isEmpty(); }
+
+    /**
+     * @brief utf8Payload Checks whether the data is UTF-8 (or plain ASCII) text.
+     * @return The number of bytes to skip before the text begins: 3 if there's a UTF-8 byte order mark,
+     *         0 if there's none, or -1 if the data isn't valid UTF-8 or has a different byte order mark.
+     */
+    static int utf8Payload(const char* data, qint64 size);
+
+    /**
+     * @brief search Searches UTF-8 text.
+     * @param data The text, after the byte order mark.
+     * @param results Receives the matches.
+     * @return False if the text contains characters whose case folding can't be checked as bytes
+     *         (e.g. the Kelvin sign, that folds to 'k'). It must then be decoded and searched as a QString.
+     */
+    bool search(const char* data, int size, DocResult& results) const;
+
+private:
+    QByteArray m_needle;        // UTF-8, lower case if !m_matchCase
+    bool m_matchCase = false;
+    bool m_matchWord = false;
+    bool m_foldsFromNonAscii = false; // The needle has letters that non-ASCII characters fold to
+    LiteralMatcher m_matcher;
+
+    int find(const char* data, int size, int from) const;
+    bool isWholeWord(const char* data, int size, int start, int end) const;
+};
+
+#endif // UTF8SEARCH_H
@@ -22,6 +22,11 @@ public:
     */
     static QString backupDirPath();
 
+    /**
+     * @brief Returns the path to the directory that contains the search indexes.
+     */
+    static QString searchIndexDirPath();
+
     /**
      * @brief Generates a QUrl to a file within the a directory.
      * @param parent The parent directory for the file.
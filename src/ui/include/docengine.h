@@ -136,6 +136,34 @@ public:
     static DocEngine::DecodedText readToString(QFile *file, QTextCodec *codec, bool bom);
     static bool writeFromString(QIODevice *io, const DecodedText &write);
 
+    /**
+     * @brief Decodes a byte array into a string, trying to guess the best
+     *        codec.
+     * @param contents
+     * @return
+     */
+    static DecodedText decodeText(const QByteArray &contents);
+    /**
+     * @brief Decodes a byte array into a string, using the specified codec.
+     * @param contents
+     * @param codec
+     * @param contentHasBOM Simply copied to the result struct.
+     * @return
+     */
+    static DecodedText decodeText(const QByteArray &contents, QTextCodec *codec, bool contentHasBOM);
+
+    /**
+     * @brief Guesses the indentation used by a text, from a histogram of its
+     *        leading whitespace: tabs win if more lines start with a tab than
+     *        with spaces, otherwise the size is the GCD of the most common
+     *        space widths. Very large texts are only sampled.
+     *        This doesn't touch any Editor, so it can run on any thread.
+     * @param text
+     * @return a pair whose first element is the indentation, that is
+     *         significative only if the second element ("found") is true.
+     */
+    static std::pair<Editor::IndentationMode, bool> detectIndentation(const QString &text);
+
     /**
      * @brief Write the provided Editor content to the specified IO device, using
      *        the encoding and the BOM settings specified in the Editor.
@@ -177,22 +205,6 @@ private:
     void monitorDocument(const QString &fileName);
     void unmonitorDocument(const QString &fileName);
 
-    /**
-     * @brief Decodes a byte array into a string, trying to guess the best
-     *        codec.
-     * @param contents
-     * @return
-     */
-    static DecodedText decodeText(const QByteArray &contents);
-    /**
-     * @brief Decodes a byte array into a string, using the specified codec.
-     * @param contents
-     * @param codec
-     * @param contentHasBOM Simply copied to the result struct.
-     * @return
-     */
-    static DecodedText decodeText(const QByteArray &contents, QTextCodec *codec, bool contentHasBOM);
-
     static QByteArray getBomForCodec(QTextCodec *codec);
 
     /**
@@ -73,6 +73,11 @@ private:
     // Smart pointers to the editors within this TabWidget
     QHash<Editor*, QSharedPointer<Editor>> m_editorPointers;
 
+    // Page shared by the editors created within this TabWidget, when the
+    // ShareEditorRenderer setting is on. Editors moved here from another
+    // TabWidget keep using the page they were created with.
+    QSharedPointer<EditorHost> m_editorHost;
+
     qreal m_zoomFactor = 1;
 
     int m_formerTabIndex = 0;
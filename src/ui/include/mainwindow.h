@@ -6,6 +6,7 @@
 #include "include/Search/advancedsearchdock.h"
 #include "include/Search/frmsearchreplace.h"
 #include "include/nqqsettings.h"
+#include "include/performancedock.h"
 #include "include/topeditorcontainer.h"
 
 #include "QtPrintSupport/QPrinter"
@@ -169,6 +170,8 @@ private slots:
     void on_actionOpen_a_New_Window_triggered();
     void on_actionOpen_in_New_Window_triggered();
     void on_actionMove_to_New_Window_triggered();
+    void on_actionCompare_With_triggered();
+    void on_actionClear_Comparison_triggered();
     void on_actionOpen_file_triggered();
     void on_actionOpen_in_another_window_triggered();
     void on_tabBarDoubleClicked(EditorTabWidget *tabWidget, int tab);
@@ -213,6 +216,7 @@ private:
     QPushButton* m_sbEOLFormatBtn;
     QPushButton* m_sbTextFormatBtn;
     QPushButton* m_sbOvertypeBtn;
+    QPushButton* m_sbLargeDocumentBtn;
     NqqSettings&          m_settings;
     frmSearchReplace*     m_frmSearchReplace = 0;
     bool                  m_overwrite = false; // Overwrite mode vs Insert mode
@@ -222,6 +226,7 @@ private:
     bool                  beginSelectPositionSet = false;
 
     AdvancedSearchDock*  m_advSearchDock;
+    PerformanceDock*     m_performanceDock;
 
     /**
      * @brief saveTabsToCache Saves tabs to cache. Utilizes the saveSession function and
@@ -85,11 +85,15 @@ public:
         NQQ_SETTING(LastSelectedSessionDir,         QString,    QString())
         NQQ_SETTING(RecentDocuments,                QList<QVariant>, QList<QVariant>())
         NQQ_SETTING(WarnIfFileLargerThan,           int,        1)
+        NQQ_SETTING(LargeDocumentSize,              int,        10)      // In megabytes
+        NQQ_SETTING(LargeDocumentLineCount,         int,        200000)
 
         NQQ_SETTING(NotepadqqVersion,               QString,    QString())
         NQQ_SETTING(SmartIndentation,               bool,       true)
         NQQ_SETTING(MathRendering,                  bool,       false)
         NQQ_SETTING(UseNativeFilePicker,            bool,       true)
+        NQQ_SETTING(EditorPoolMemoryLimit,          int,        200)     // In megabytes
+        NQQ_SETTING(ShareEditorRenderer,            bool,       false)
     END_CATEGORY(General)
 
     BEGIN_CATEGORY(Appearance)
@@ -107,6 +111,7 @@ public:
         NQQ_SETTING(ReplaceHistory, QStringList,    QStringList())
         NQQ_SETTING(FileHistory,    QStringList,    QStringList())
         NQQ_SETTING(FilterHistory,  QStringList,    QStringList())
+        NQQ_SETTING(UseSearchIndex, bool,           false)
     END_CATEGORY(Search)
 
     BEGIN_CATEGORY(Extensions)
@@ -0,0 +1,55 @@
+#ifndef PERFORMANCEDOCK_H
+#define PERFORMANCEDOCK_H
+
+#include <QDockWidget>
+#include <QJsonObject>
+#include <QTimer>
+
+class QLabel;
+class QTreeWidget;
+
+/**
+ * @brief Diagnostics dock that shows the traffic between the Editors and their
+ *        pages (see EditorNS::BridgeStatistics) and the EditorPool statistics.
+ *        The data is refreshed while the dock is visible, and can be exported
+ *        as JSON.
+ */
+class PerformanceDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit PerformanceDock(QWidget *parent = 0);
+
+    /**
+     * @brief All the collected data, in the same format used by the export.
+     */
+    static QJsonObject toJson();
+
+public slots:
+    void refresh();
+    void exportJson();
+    void reset();
+
+private:
+    enum Column {
+        ColumnMessage,
+        ColumnRequests,
+        ColumnSync,
+        ColumnNested,
+        ColumnAverage,
+        ColumnP95,
+        ColumnMax,
+        ColumnBlocked,
+        ColumnSent,
+        ColumnReceived,
+        ColumnCount
+    };
+
+    static const int REFRESH_INTERVAL;
+
+    QTreeWidget *m_table;
+    QLabel *m_summary;
+    QTimer m_refreshTimer;
+};
+
+#endif // PERFORMANCEDOCK_H
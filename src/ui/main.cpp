@@ -1,3 +1,4 @@
+#include "include/EditorNS/bulktransferschemehandler.h"
 #include "include/EditorNS/editor.h"
 #include "include/Extensions/extensionsloader.h"
 #include "include/Sessions/backupservice.h"
@@ -44,6 +45,10 @@ int main(int argc, char *argv[])
     SingleApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     SingleApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 #endif
+
+    // Custom url schemes must be known to QtWebEngine before the application starts
+    EditorNS::BulkTransferSchemeHandler::registerUrlScheme();
+
     SingleApplication a(argc, argv);
 
     QCoreApplication::setOrganizationName("Notepadqq");
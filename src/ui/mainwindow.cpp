@@ -3,6 +3,8 @@
 #include "include/EditorNS/bannerfilechanged.h"
 #include "include/EditorNS/bannerfileremoved.h"
 #include "include/EditorNS/bannerindentationdetected.h"
+#include "include/EditorNS/documentcomparison.h"
+#include "include/EditorNS/documentprinter.h"
 #include "include/EditorNS/editor.h"
 #include "include/Extensions/Stubs/windowstub.h"
 #include "include/Extensions/extensionsloader.h"
@@ -30,6 +32,9 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QPageSetupDialog>
+#include <QPdfWriter>
+#include <QPointer>
+#include <QProgressDialog>
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QTemporaryFile>
@@ -51,7 +56,8 @@ MainWindow::MainWindow(const QString &workingDirectory, const QStringList &argum
     m_topEditorContainer(new TopEditorContainer(this)),
     m_settings(NqqSettings::getInstance()),
     m_workingDirectory(workingDirectory),
-    m_advSearchDock(new AdvancedSearchDock(this))
+    m_advSearchDock(new AdvancedSearchDock(this)),
+    m_performanceDock(new PerformanceDock(this))
 {
     ui->setupUi(this);
     setAttribute(Qt::WA_DeleteOnClose);
@@ -237,6 +243,12 @@ void MainWindow::configureUserInterface()
         ->hide(); // Hidden by default, user preference is applied via restoreWindowSettings()
     connect(m_advSearchDock, &AdvancedSearchDock::itemInteracted, this, &MainWindow::searchDockItemInteracted);
 
+    // The performance dock is only meant for diagnostics, so it's hidden by default
+    addDockWidget(Qt::BottomDockWidgetArea, m_performanceDock);
+    m_performanceDock->hide();
+    ui->menu_View->addSeparator();
+    ui->menu_View->addAction(m_performanceDock->toggleViewAction());
+
     // Restore smart indent
     ui->actionToggle_Smart_Indent->setChecked(m_settings.General.getSmartIndentation());
     on_actionToggle_Smart_Indent_toggled(m_settings.General.getSmartIndentation());
@@ -348,6 +360,12 @@ void MainWindow::configureStatusBar()
         statusBar()->addPermanentWidget(btn);
         return btn;
     };
+    m_sbLargeDocumentBtn = createStatusButton(tr("Large document"));
+    m_sbLargeDocumentBtn->setToolTip(tr("Some features are disabled to keep this document responsive. Click to enable them anyway."));
+    m_sbLargeDocumentBtn->setVisible(false);
+    connect(m_sbLargeDocumentBtn, &QPushButton::clicked, this, [=]() {
+        currentEditor()->setLargeDocumentMode(false);
+    });
     m_sbFileFormatBtn = createStatusButton("File Format", ui->menu_Language);
     m_sbEOLFormatBtn = createStatusButton("EOL", ui->menuEOL_Conversion);
     m_sbTextFormatBtn = createStatusButton("Encoding", ui->menu_Encoding);
@@ -1210,6 +1228,10 @@ void MainWindow::on_editorAdded(EditorTabWidget *tabWidget, int tab)
             refreshEditorUiInfo(editor);
     });
     connect(editor, &Editor::urlsDropped, this, &MainWindow::on_editorUrlsDropped);
+    connect(editor, &Editor::largeDocumentModeChanged, this, [=]() {
+        if (currentEditor() == editor)
+            refreshEditorUiInfo(editor);
+    });
 
     // Initialize editor with UI settings
     editor->setLineWrap(ui->actionWord_wrap->isChecked());
@@ -1407,6 +1429,8 @@ void MainWindow::refreshEditorUiInfo(Editor *editor)
         ui->actionIndentation_Default_Settings->setChecked(true);
     }
 
+    m_sbLargeDocumentBtn->setVisible(editor->isLargeDocumentMode());
+
 }
 
 void MainWindow::on_actionDelete_triggered()
@@ -2246,23 +2270,44 @@ void MainWindow::on_actionPrint_triggered()
 
     QPageSetupDialog dlg;
     if (dlg.exec() == QDialog::Accepted) {
-        currentEditor()->printToPdf(dlg.printer()->pageLayout()).then([this](QByteArray data) {
-            QFile file(QDir::tempPath() + "/notepadqq.print." +
-                       QString::number(QDateTime::currentMSecsSinceEpoch(), 16) + ".pdf");
-
-            if (file.open(QIODevice::WriteOnly)) { // FIXME: Delete the file when we're done
-                file.write(data);
-                file.close();
-
-                bool ok = QDesktopServices::openUrl(QUrl::fromLocalFile(file.fileName()));
-                if (!ok) {
-                    QMessageBox::warning(this,
-                        QCoreApplication::applicationName(),
-                        tr("%1 wasn't able to open the produced pdf file:\n%2")
-                            .arg(QCoreApplication::applicationName(), file.fileName()),
-                        QMessageBox::Ok,
-                        QMessageBox::Ok);
+        QString fileName = QDir::tempPath() + "/notepadqq.print." +
+                           QString::number(QDateTime::currentMSecsSinceEpoch(), 16) + ".pdf"; // FIXME: Delete the file when we're done
+
+        auto writer = std::make_shared<QPdfWriter>(fileName);
+        writer->setPageLayout(dlg.printer()->pageLayout());
+        writer->setCreator(QCoreApplication::applicationName());
+        EditorTabWidget *tabW = m_topEditorContainer->currentTabWidget();
+        writer->setTitle(tabW->tabText(tabW->currentIndex()));
+
+        DocumentPrinter *printer = currentEditor()->print(writer);
+
+        // The document is printed in the background: this only shows up if it takes a while
+        QProgressDialog *progress = new QProgressDialog(tr("Printing..."), tr("Cancel"), 0, 100, this);
+        progress->setWindowTitle(tr("Print"));
+        progress->setMinimumDuration(500);
+
+        connect(printer, &DocumentPrinter::progress, progress, [progress](double fraction) {
+            progress->setValue(qRound(fraction * 100));
+        });
+        connect(progress, &QProgressDialog::canceled, printer, &DocumentPrinter::cancel);
+        connect(printer, &DocumentPrinter::finished, this, [this, progress, fileName](bool success, QString errorString) {
+            progress->deleteLater();
+
+            if (!success) {
+                if (!errorString.isEmpty()) {
+                    QMessageBox::warning(this, QCoreApplication::applicationName(), errorString);
                 }
+                return;
+            }
+
+            bool ok = QDesktopServices::openUrl(QUrl::fromLocalFile(fileName));
+            if (!ok) {
+                QMessageBox::warning(this,
+                    QCoreApplication::applicationName(),
+                    tr("%1 wasn't able to open the produced pdf file:\n%2")
+                        .arg(QCoreApplication::applicationName(), fileName),
+                    QMessageBox::Ok,
+                    QMessageBox::Ok);
             }
         });
     }
@@ -2378,6 +2423,69 @@ void MainWindow::on_actionMove_to_New_Window_triggered()
     }
 }
 
+void MainWindow::on_actionCompare_With_triggered()
+{
+    QPointer<Editor> editor = currentEditor();
+
+    QUrl defaultUrl = editor->filePath();
+    if (defaultUrl.isEmpty())
+        defaultUrl = QUrl::fromLocalFile(m_settings.General.getLastSelectedDir());
+
+    // See https://github.com/notepadqq/notepadqq/issues/654
+    BackupServicePauser bsp; bsp.pause();
+
+    auto dialogOption =
+        m_settings.General.getUseNativeFilePicker() ? QFileDialog::Options() : QFileDialog::DontUseNativeDialog;
+
+    QUrl url = QFileDialog::getOpenFileUrl(this, tr("Compare With"), defaultUrl, tr("All files (*)"), nullptr, dialogOption);
+
+    if (url.isEmpty() || editor.isNull())
+        return;
+
+    if (url == editor->filePath()) {
+        QMessageBox::information(this, QCoreApplication::applicationName(),
+                                 tr("Choose a file other than the current document."));
+        return;
+    }
+
+    // Open the file in the other view, next to the current document. If it's
+    // already open, it's compared as it is in its editor.
+    m_docEngine->getDocumentLoader()
+            .setUrl(url)
+            .setTabWidget(m_topEditorContainer->inactiveTabWidget(true))
+            .setReloadAction(DocEngine::ReloadActionDont)
+            .execute()
+            .then([=]() {
+                const QPair<int, int> pos = m_docEngine->findOpenEditorByUrl(url);
+                if (editor.isNull() || pos.first < 0)
+                    return;
+
+                Editor *other = m_topEditorContainer->tabWidget(pos.first)->editor(pos.second);
+
+                DocumentComparison *comparison = new DocumentComparison(editor, other, this);
+                connect(comparison, &DocumentComparison::finished, this, [this](bool success, int hunkCount) {
+                    if (!success)
+                        return;
+
+                    if (hunkCount == 0) {
+                        QMessageBox::information(this, QCoreApplication::applicationName(),
+                                                 tr("The documents are identical."));
+                    } else {
+                        statusBar()->showMessage(tr("%n difference(s) found.", "", hunkCount), 5000);
+                    }
+                });
+                comparison->start();
+            });
+}
+
+void MainWindow::on_actionClear_Comparison_triggered()
+{
+    m_topEditorContainer->forEachEditor([&](const int /*tabWidgetId*/, const int /*editorId*/, EditorTabWidget */*tabWidget*/, Editor *editor) {
+        DocumentComparison::clear(editor);
+        return true;
+    });
+}
+
 void MainWindow::on_actionOpen_file_triggered()
 {
     currentWordOrSelections().then([=](QStringList terms){
@@ -2442,37 +2550,37 @@ void MainWindow::on_actionMove_Line_Down_triggered()
 
 void MainWindow::on_actionTrim_Trailing_Space_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_TRIM_TRAILING_SPACE");
+    currentEditor()->transformLines(TextTransform::TrimTrailingSpace);
 }
 
 void MainWindow::on_actionTrim_Leading_Space_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_TRIM_LEADING_SPACE");
+    currentEditor()->transformLines(TextTransform::TrimLeadingSpace);
 }
 
 void MainWindow::on_actionTrim_Leading_and_Trailing_Space_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_TRIM_LEADING_TRAILING_SPACE");
+    currentEditor()->transformLines(TextTransform::TrimLeadingTrailingSpace);
 }
 
 void MainWindow::on_actionEOL_to_Space_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_EOL_TO_SPACE");
+    currentEditor()->transformLines(TextTransform::EolToSpace);
 }
 
 void MainWindow::on_actionTAB_to_Space_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_TAB_TO_SPACE");
+    currentEditor()->transformLines(TextTransform::TabToSpace);
 }
 
 void MainWindow::on_actionSpace_to_TAB_All_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_SPACE_TO_TAB_ALL");
+    currentEditor()->transformLines(TextTransform::SpaceToTabAll);
 }
 
 void MainWindow::on_actionSpace_to_TAB_Leading_triggered()
 {
-    currentEditor()->sendMessage("C_CMD_SPACE_TO_TAB_LEADING");
+    currentEditor()->transformLines(TextTransform::SpaceToTabLeading);
 }
 
 void MainWindow::on_actionGo_to_Line_triggered()
@@ -0,0 +1,170 @@
+#include "include/performancedock.h"
+
+#include "include/EditorNS/bridgestatistics.h"
+#include "include/EditorNS/editorpool.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QHash>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+using EditorNS::BridgeStatistics;
+using EditorNS::EditorPool;
+
+const int PerformanceDock::REFRESH_INTERVAL = 1000;
+
+PerformanceDock::PerformanceDock(QWidget *parent) :
+    QDockWidget(tr("Performance"), parent),
+    m_table(new QTreeWidget()),
+    m_summary(new QLabel())
+{
+    setObjectName("performanceDock");
+
+    m_table->setRootIsDecorated(false);
+    m_table->setSortingEnabled(true);
+    m_table->setColumnCount(ColumnCount);
+    m_table->setHeaderLabels(QStringList()
+                             << tr("Message")
+                             << tr("Requests")
+                             << tr("Blocking")
+                             << tr("Nested")
+                             << tr("Avg (ms)")
+                             << tr("95% (ms)")
+                             << tr("Max (ms)")
+                             << tr("Blocked (ms)")
+                             << tr("Sent (KiB)")
+                             << tr("Received (KiB)"));
+    m_table->header()->setSectionResizeMode(ColumnMessage, QHeaderView::ResizeToContents);
+    m_table->sortByColumn(ColumnBlocked, Qt::DescendingOrder);
+
+    QPushButton *btnReset = new QPushButton(tr("Reset"));
+    QPushButton *btnExport = new QPushButton(tr("Export JSON..."));
+    connect(btnReset, &QPushButton::clicked, this, &PerformanceDock::reset);
+    connect(btnExport, &QPushButton::clicked, this, &PerformanceDock::exportJson);
+
+    QHBoxLayout *bottom = new QHBoxLayout();
+    bottom->addWidget(m_summary, 1);
+    bottom->addWidget(btnReset);
+    bottom->addWidget(btnExport);
+
+    QWidget *content = new QWidget();
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_table);
+    layout->addLayout(bottom);
+    setWidget(content);
+
+    // Don't spend time refreshing data that nobody is looking at
+    m_refreshTimer.setInterval(REFRESH_INTERVAL);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &PerformanceDock::refresh);
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            refresh();
+            m_refreshTimer.start();
+        } else {
+            m_refreshTimer.stop();
+        }
+    });
+}
+
+QJsonObject PerformanceDock::toJson()
+{
+    const EditorPool &pool = EditorPool::getInstance();
+    const EditorPool::Statistics &poolStats = pool.statistics();
+
+    QJsonObject editorPool;
+    editorPool["hits"] = poolStats.hits;
+    editorPool["misses"] = poolStats.misses;
+    editorPool["recycled"] = poolStats.recycled;
+    editorPool["discarded"] = poolStats.discarded;
+    editorPool["hitRate"] = poolStats.hitRate();
+    editorPool["size"] = pool.size();
+    editorPool["targetSize"] = pool.targetSize();
+
+    QJsonObject out;
+    out["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    out["bridge"] = BridgeStatistics::getInstance().toJson();
+    out["editorPool"] = editorPool;
+    return out;
+}
+
+void PerformanceDock::refresh()
+{
+    const auto &entries = BridgeStatistics::getInstance().entries();
+
+    // Updating the items in place keeps the selection and the scroll position
+    QHash<QString, QTreeWidgetItem *> items;
+    for (int i = 0; i < m_table->topLevelItemCount(); i++) {
+        QTreeWidgetItem *item = m_table->topLevelItem(i);
+        items.insert(item->text(ColumnMessage), item);
+    }
+
+    m_table->setSortingEnabled(false);
+
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const BridgeStatistics::Entry &e = it.value();
+
+        QTreeWidgetItem *item = items.value(it.key());
+        if (item == nullptr) {
+            item = new QTreeWidgetItem(m_table);
+            item->setText(ColumnMessage, it.key());
+            for (int c = ColumnRequests; c < ColumnCount; c++) {
+                item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+            }
+        }
+
+        // Numbers, not strings, so that the columns sort as expected
+        item->setData(ColumnRequests, Qt::DisplayRole, e.requests);
+        item->setData(ColumnSync, Qt::DisplayRole, e.syncRequests);
+        item->setData(ColumnNested, Qt::DisplayRole, e.nestedRequests);
+        item->setData(ColumnAverage, Qt::DisplayRole, e.averageLatency() / 1000.0);
+        item->setData(ColumnP95, Qt::DisplayRole, e.latencyPercentile(0.95));
+        item->setData(ColumnMax, Qt::DisplayRole, e.maxLatency / 1000.0);
+        item->setData(ColumnBlocked, Qt::DisplayRole, e.blockedTime / 1000);
+        item->setData(ColumnSent, Qt::DisplayRole, e.requestBytes / 1024);
+        item->setData(ColumnReceived, Qt::DisplayRole, e.replyBytes / 1024);
+    }
+
+    m_table->setSortingEnabled(true);
+
+    const EditorPool &pool = EditorPool::getInstance();
+    const EditorPool::Statistics &poolStats = pool.statistics();
+    m_summary->setText(tr("Editor pool: %1 ready (target %2), %3% hit rate, %4 recycled, %5 discarded")
+                       .arg(pool.size())
+                       .arg(pool.targetSize())
+                       .arg(qRound(poolStats.hitRate() * 100))
+                       .arg(poolStats.recycled)
+                       .arg(poolStats.discarded));
+}
+
+void PerformanceDock::exportJson()
+{
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Export Performance Data"),
+                                                    "notepadqq-performance.json",
+                                                    tr("JSON files (*.json);;Any file (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) ||
+            file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Indented)) == -1) {
+        QMessageBox::warning(this, tr("Export Performance Data"),
+                             tr("Error writing to \"%1\": %2").arg(fileName).arg(file.errorString()));
+    }
+}
+
+void PerformanceDock::reset()
+{
+    BridgeStatistics::getInstance().reset();
+    m_table->clear();
+    refresh();
+}
@@ -0,0 +1,155 @@
+# Everything that makes up the application, except main.cpp. Shared with
+# the targets that need to run the real UI code (e.g. ui-benchmarks).
+
+QT += core gui svg widgets printsupport network webenginewidgets webchannel websockets dbus concurrent
+CONFIG += c++14 link_pkgconfig
+PKGCONFIG += uchardet
+
+# Avoid automatic casts from QString to QUrl
+DEFINES += QT_NO_URL_CAST_FROM_STRING
+
+INCLUDEPATH += $$PWD
+
+include($$PWD/libs/qtpromise/qtpromise.pri)
+
+SOURCES += \
+    $$PWD/mainwindow.cpp \
+    $$PWD/topeditorcontainer.cpp \
+    $$PWD/editortabwidget.cpp \
+    $$PWD/docengine.cpp \
+    $$PWD/frmabout.cpp \
+    $$PWD/notepadqq.cpp \
+    $$PWD/frmpreferences.cpp \
+    $$PWD/iconprovider.cpp \
+    $$PWD/EditorNS/editor.cpp \
+    $$PWD/EditorNS/bannerfilechanged.cpp \
+    $$PWD/EditorNS/bannerbasicmessage.cpp \
+    $$PWD/EditorNS/bannerfileremoved.cpp \
+    $$PWD/EditorNS/customqwebview.cpp \
+    $$PWD/EditorNS/languageservice.cpp \
+    $$PWD/EditorNS/bulktransferschemehandler.cpp \
+    $$PWD/EditorNS/editorpool.cpp \
+    $$PWD/EditorNS/editorhost.cpp \
+    $$PWD/EditorNS/texttransform.cpp \
+    $$PWD/EditorNS/documentprinter.cpp \
+    $$PWD/EditorNS/linediff.cpp \
+    $$PWD/EditorNS/documentcomparison.cpp \
+    $$PWD/EditorNS/bridgestatistics.cpp \
+    $$PWD/clickablelabel.cpp \
+    $$PWD/frmencodingchooser.cpp \
+    $$PWD/EditorNS/bannerindentationdetected.cpp \
+    $$PWD/frmindentationmode.cpp \
+    $$PWD/singleapplication.cpp \
+    $$PWD/localcommunication.cpp \
+    $$PWD/Search/frmsearchreplace.cpp \
+    $$PWD/Search/searchstring.cpp \
+    $$PWD/Search/advancedsearchdock.cpp \
+    $$PWD/Extensions/extension.cpp \
+    $$PWD/frmlinenumberchooser.cpp \
+    $$PWD/Extensions/extensionsserver.cpp \
+    $$PWD/Extensions/Stubs/stub.cpp \
+    $$PWD/Extensions/runtimesupport.cpp \
+    $$PWD/Extensions/Stubs/windowstub.cpp \
+    $$PWD/Extensions/Stubs/notepadqqstub.cpp \
+    $$PWD/Extensions/Stubs/editorstub.cpp \
+    $$PWD/Extensions/extensionsloader.cpp \
+    $$PWD/globals.cpp \
+    $$PWD/Extensions/Stubs/menuitemstub.cpp \
+    $$PWD/Extensions/installextension.cpp \
+    $$PWD/keygrabber.cpp \
+    $$PWD/Sessions/sessions.cpp \
+    $$PWD/Sessions/persistentcache.cpp \
+    $$PWD/nqqsettings.cpp \
+    $$PWD/nqqrun.cpp \
+    $$PWD/Search/filesearcher.cpp \
+    $$PWD/Search/utf8search.cpp \
+    $$PWD/Search/literalmatcher.cpp \
+    $$PWD/Search/linecounter.cpp \
+    $$PWD/Search/multitermmatcher.cpp \
+    $$PWD/Search/regexliterals.cpp \
+    $$PWD/Search/regexprefilter.cpp \
+    $$PWD/Search/trigramindex.cpp \
+    $$PWD/Search/filereplacer.cpp \
+    $$PWD/Search/searchobjects.cpp \
+    $$PWD/Search/searchinstance.cpp \
+    $$PWD/Search/documentsearch.cpp \
+    $$PWD/stats.cpp \
+    $$PWD/performancedock.cpp \
+    $$PWD/Sessions/backupservice.cpp
+
+HEADERS += \
+    $$PWD/include/mainwindow.h \
+    $$PWD/include/topeditorcontainer.h \
+    $$PWD/include/editortabwidget.h \
+    $$PWD/include/docengine.h \
+    $$PWD/include/frmabout.h \
+    $$PWD/include/notepadqq.h \
+    $$PWD/include/frmpreferences.h \
+    $$PWD/include/iconprovider.h \
+    $$PWD/include/EditorNS/editor.h \
+    $$PWD/include/EditorNS/bannerfilechanged.h \
+    $$PWD/include/EditorNS/bannerbasicmessage.h \
+    $$PWD/include/EditorNS/bannerfileremoved.h \
+    $$PWD/include/EditorNS/customqwebview.h \
+    $$PWD/include/EditorNS/bulktransferschemehandler.h \
+    $$PWD/include/EditorNS/editorpool.h \
+    $$PWD/include/EditorNS/editorhost.h \
+    $$PWD/include/EditorNS/texttransform.h \
+    $$PWD/include/EditorNS/documentprinter.h \
+    $$PWD/include/EditorNS/linediff.h \
+    $$PWD/include/EditorNS/documentcomparison.h \
+    $$PWD/include/EditorNS/bridgestatistics.h \
+    $$PWD/include/clickablelabel.h \
+    $$PWD/include/frmencodingchooser.h \
+    $$PWD/include/EditorNS/bannerindentationdetected.h \
+    $$PWD/include/EditorNS/languageservice.h \
+    $$PWD/include/frmindentationmode.h \
+    $$PWD/include/singleapplication.h \
+    $$PWD/include/localcommunication.h \
+    $$PWD/include/Search/frmsearchreplace.h \
+    $$PWD/include/Search/advancedsearchdock.h \
+    $$PWD/include/Search/searchhelpers.h \
+    $$PWD/include/Search/searchstring.h \
+    $$PWD/include/Extensions/extension.h \
+    $$PWD/include/frmlinenumberchooser.h \
+    $$PWD/include/Extensions/extensionsserver.h \
+    $$PWD/include/Extensions/Stubs/stub.h \
+    $$PWD/include/Extensions/runtimesupport.h \
+    $$PWD/include/Extensions/Stubs/windowstub.h \
+    $$PWD/include/Extensions/Stubs/notepadqqstub.h \
+    $$PWD/include/Extensions/Stubs/editorstub.h \
+    $$PWD/include/Extensions/extensionsloader.h \
+    $$PWD/include/globals.h \
+    $$PWD/include/Extensions/Stubs/menuitemstub.h \
+    $$PWD/include/Extensions/installextension.h \
+    $$PWD/include/keygrabber.h \
+    $$PWD/include/Sessions/sessions.h \
+    $$PWD/include/Sessions/persistentcache.h \
+    $$PWD/include/nqqsettings.h \
+    $$PWD/include/nqqrun.h \
+    $$PWD/include/Search/filesearcher.h \
+    $$PWD/include/Search/utf8search.h \
+    $$PWD/include/Search/literalmatcher.h \
+    $$PWD/include/Search/linecounter.h \
+    $$PWD/include/Search/multitermmatcher.h \
+    $$PWD/include/Search/regexliterals.h \
+    $$PWD/include/Search/regexprefilter.h \
+    $$PWD/include/Search/trigramindex.h \
+    $$PWD/include/Search/searchobjects.h \
+    $$PWD/include/Search/filereplacer.h \
+    $$PWD/include/Search/searchinstance.h \
+    $$PWD/include/Search/documentsearch.h \
+    $$PWD/include/stats.h \
+    $$PWD/include/performancedock.h \
+    $$PWD/include/Sessions/backupservice.h
+
+FORMS += \
+    $$PWD/mainwindow.ui \
+    $$PWD/frmabout.ui \
+    $$PWD/frmpreferences.ui \
+    $$PWD/frmencodingchooser.ui \
+    $$PWD/frmindentationmode.ui \
+    $$PWD/Search/dlgsearching.ui \
+    $$PWD/Search/frmsearchreplace.ui \
+    $$PWD/frmlinenumberchooser.ui \
+    $$PWD/Extensions/installextension.ui